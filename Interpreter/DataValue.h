@@ -2,6 +2,7 @@
 #ifndef DATA_VALUE_H_
 #define DATA_VALUE_H_
 
+#include "SharedString.h"
 #include "Util/string_view.h"
 
 #include <gsl/span>
@@ -33,10 +34,16 @@ struct ArrayIterator {
 	Array::iterator it;
 };
 
+// view::string_view is a non-owning reference to text which lives elsewhere
+// (typically a document's text buffer). It exists so that built-ins can hand
+// large amounts of text to each other without copying it. Such values are
+// only valid for the duration of a single built-in call and must never be
+// stored in a macro variable or left on the macro stack.
 using Data = boost::variant<
 	boost::blank,
-	int32_t,
-	std::string,
+	int64_t,
+	SharedString,
+	view::string_view,
 	ArrayPtr,
 	ArrayIterator,
 	LibraryRoutine,
@@ -68,34 +75,51 @@ inline DataValue make_value() {
 
 inline DataValue make_value(int32_t n) {
 	DataValue DV;
-	DV.value = n;
+	DV.value = static_cast<int64_t>(n);
 	return DV;
 }
 
 inline DataValue make_value(int64_t n) {
 	DataValue DV;
-	if (n > std::numeric_limits<int32_t>::max() || n < std::numeric_limits<int32_t>::min()) {
-		qWarning("A value being stored in a macro variable will be truncated");
-	}
-	DV.value = static_cast<int32_t>(n);
+	DV.value = n;
 	return DV;
 }
 
 inline DataValue make_value(bool n) {
 	DataValue DV;
-	DV.value = n ? 1 : 0;
+	DV.value = static_cast<int64_t>(n ? 1 : 0);
 	return DV;
 }
 
 inline DataValue make_value(view::string_view str) {
 	DataValue DV;
-	DV.value = str.to_string();
+	DV.value = SharedString(str);
+	return DV;
+}
+
+inline DataValue make_value(std::string &&str) {
+	DataValue DV;
+	DV.value = SharedString(std::move(str));
+	return DV;
+}
+
+inline DataValue make_value(const SharedString &str) {
+	DataValue DV;
+	DV.value = str;
+	return DV;
+}
+
+/* creates a non-owning string value, see the note above about when it is
+ * safe to do so */
+inline DataValue make_view_value(view::string_view str) {
+	DataValue DV;
+	DV.value = str;
 	return DV;
 }
 
 inline DataValue make_value(const QString &str) {
 	DataValue DV;
-	DV.value = str.toStdString();
+	DV.value = SharedString(str.toStdString());
 	return DV;
 }
 
@@ -132,24 +156,52 @@ inline bool is_integer(const DataValue &dv) {
 }
 
 inline bool is_string(const DataValue &dv) {
-	return dv.value.which() == 2;
+	return dv.value.which() == 2 || dv.value.which() == 3;
 }
 
-inline bool is_array(const DataValue &dv) {
+inline bool is_string_view(const DataValue &dv) {
 	return dv.value.which() == 3;
 }
 
+inline bool is_array(const DataValue &dv) {
+	return dv.value.which() == 4;
+}
+
 inline std::string to_string(const DataValue &dv) {
 
-	if (auto n = boost::get<int>(&dv.value)) {
+	if (auto n = boost::get<int64_t>(&dv.value)) {
 		return std::to_string(*n);
+	} else if (auto v = boost::get<view::string_view>(&dv.value)) {
+		return v->to_string();
+	} else {
+		return boost::get<SharedString>(dv.value).to_string();
+	}
+}
+
+/* returns a view of a string value without copying it. The view is only
+ * valid for as long as the DataValue it came from is */
+inline view::string_view to_string_view(const DataValue &dv) {
+
+	if (auto v = boost::get<view::string_view>(&dv.value)) {
+		return *v;
+	} else {
+		return boost::get<SharedString>(dv.value).view();
+	}
+}
+
+/* returns the shared representation of a string value, taking a copy of the
+ * text only if the value is a non-owning view */
+inline SharedString to_shared_string(const DataValue &dv) {
+
+	if (auto v = boost::get<view::string_view>(&dv.value)) {
+		return SharedString(*v);
 	} else {
-		return boost::get<std::string>(dv.value);
+		return boost::get<SharedString>(dv.value);
 	}
 }
 
-inline int to_integer(const DataValue &dv) {
-	return boost::get<int>(dv.value);
+inline int64_t to_integer(const DataValue &dv) {
+	return boost::get<int64_t>(dv.value);
 }
 
 inline Program *to_program(const DataValue &dv) {
@@ -0,0 +1,99 @@
+#ifndef SHARED_STRING_H_
+#define SHARED_STRING_H_
+
+#include "Util/string_view.h"
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <string>
+
+/*
+** An immutable string value with shared storage, used for macro strings.
+**
+** Copies are cheap, they only share a reference to the storage. Each value
+** refers to a prefix of its storage, so appending to a value whose prefix
+** covers all of the storage can simply extend the storage in place; nobody
+** else can observe the new characters because every other value sharing the
+** storage refers to a prefix no longer than ours. This makes the typical
+** accumulate-in-a-loop macro (s = s "line\n") linear instead of quadratic.
+** If the storage has already been extended past our end by someone else, we
+** fall back to copying.
+*/
+class SharedString {
+public:
+	SharedString() = default;
+
+	explicit SharedString(view::string_view str)
+		: storage_(std::make_shared<std::string>(str.data(), str.size())), size_(str.size()) {
+	}
+
+	explicit SharedString(std::string &&str)
+		: size_(str.size()) {
+		storage_ = std::make_shared<std::string>(std::move(str));
+	}
+
+	SharedString(const SharedString &) = default;
+	SharedString(SharedString &&)      = default;
+	SharedString &operator=(const SharedString &) = default;
+	SharedString &operator=(SharedString &&) = default;
+	~SharedString()                          = default;
+
+public:
+	view::string_view view() const noexcept {
+		if (!storage_) {
+			return view::string_view();
+		}
+
+		return view::string_view(storage_->data(), size_);
+	}
+
+	std::string to_string() const {
+		return view().to_string();
+	}
+
+	size_t size() const noexcept { return size_; }
+	bool empty() const noexcept { return size_ == 0; }
+
+public:
+	void append(view::string_view str) {
+
+		if (str.empty()) {
+			return;
+		}
+
+		if (!storage_) {
+			*this = SharedString(str);
+			return;
+		}
+
+		if (storage_->size() == size_) {
+			// we own the tail of the storage, so extend it in place. If the
+			// text being appended lives in our own storage, we take a copy
+			// first since growing the storage may reallocate it
+			const char *const first = storage_->data();
+			const char *const last  = first + storage_->size();
+
+			if (std::greater_equal<const char *>()(str.data(), first) && std::less<const char *>()(str.data(), last)) {
+				const std::string copy = str.to_string();
+				storage_->append(copy);
+			} else {
+				storage_->append(str.data(), str.size());
+			}
+		} else {
+			auto storage = std::make_shared<std::string>();
+			storage->reserve(std::max(size_ + str.size(), size_ * 2));
+			storage->append(storage_->data(), size_);
+			storage->append(str.data(), str.size());
+			storage_ = std::move(storage);
+		}
+
+		size_ += str.size();
+	}
+
+private:
+	std::shared_ptr<std::string> storage_;
+	size_t size_ = 0;
+};
+
+#endif
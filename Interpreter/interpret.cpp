@@ -1,8 +1,11 @@
 
 #include "interpret.h"
 #include "Util/utils.h"
+#include <algorithm>
 #include <cassert>
+#include <cinttypes>
 #include <cmath>
+#include <map>
 
 // This enables preemption, useful to disable it for debugging things
 #define ENABLE_PREEMPTION
@@ -61,6 +64,15 @@ MacroContext Context;
 const char *ErrorMessage; // global for returning error messages from executing functions
 bool PreemptRequest;      // passes preemption requests from called routines back up to the interpreter
 
+// Global data for the profiler
+using ProfileClock = std::chrono::steady_clock;
+
+const auto TopLevelProfileName = "<top level>";
+
+bool ProfilingEnabled = false;
+uint64_t ProfileInstructions;                   // instructions executed while profiling
+std::map<std::string, ProfileEntry> ProfileData; // entries are never erased, frames point to them
+
 // Stack-> symN-sym0(FP), argArray, nArgs, oldFP, retPC, argN-arg1, next, ...
 constexpr int FP_ARG_ARRAY_CACHE_INDEX = -1;
 constexpr int FP_ARG_COUNT_INDEX       = -2;
@@ -73,7 +85,7 @@ DataValue &FP_GET_ARG_ARRAY_CACHE(DataValue *FrameP) {
 }
 
 int FP_GET_ARG_COUNT(const DataValue *FrameP) {
-	return to_integer(FrameP[FP_ARG_COUNT_INDEX]);
+	return static_cast<int>(to_integer(FrameP[FP_ARG_COUNT_INDEX]));
 }
 
 DataValue *FP_GET_OLD_FP(const DataValue *FrameP) {
@@ -97,7 +109,7 @@ DataValue &FP_GET_SYM_N(DataValue *FrameP, int n) {
 }
 
 DataValue &FP_GET_SYM_VAL(DataValue *FrameP, Symbol *sym) {
-	return FP_GET_SYM_N(FrameP, to_integer(sym->value));
+	return FP_GET_SYM_N(FrameP, static_cast<int>(to_integer(sym->value)));
 }
 
 /*
@@ -111,6 +123,7 @@ void saveContext(Pointer context) {
 	context->PC            = Context.PC;
 	context->RunDocument   = Context.RunDocument;
 	context->FocusDocument = Context.FocusDocument;
+	context->ProfileFrames = std::move(Context.ProfileFrames);
 }
 
 template <class Pointer>
@@ -121,6 +134,57 @@ void restoreContext(Pointer context) {
 	Context.PC            = context->PC;
 	Context.RunDocument   = context->RunDocument;
 	Context.FocusDocument = context->FocusDocument;
+	Context.ProfileFrames = std::move(context->ProfileFrames);
+}
+
+/*
+** Profiler bookkeeping. A frame is pushed for each macro function call (and
+** for each top level program) while profiling, and is popped by the matching
+** return, crediting the elapsed time to the function, and to its caller as
+** time spent in children.
+*/
+ProfileEntry *profileEntry(const std::string &name, bool builtin) {
+	ProfileEntry &entry = ProfileData[name];
+	entry.builtin       = builtin;
+	return &entry;
+}
+
+void profileCall(const std::string &name) {
+	if (ProfilingEnabled) {
+		ProfileEntry *entry = profileEntry(name, false);
+		++entry->calls;
+		Context.ProfileFrames.push_back({entry, Context.FrameP, ProfileClock::now(), ProfileClock::duration::zero()});
+	}
+}
+
+void profileReturn() {
+
+	// the frame may be missing if profiling was started during the call
+	if (Context.ProfileFrames.empty() || Context.ProfileFrames.back().FrameP != Context.FrameP) {
+		return;
+	}
+
+	const ProfileFrame frame = Context.ProfileFrames.back();
+	Context.ProfileFrames.pop_back();
+
+	const auto elapsed = ProfileClock::now() - frame.start;
+	frame.entry->inclusive += elapsed;
+	frame.entry->exclusive += elapsed - frame.children;
+
+	if (!Context.ProfileFrames.empty()) {
+		Context.ProfileFrames.back().children += elapsed;
+	}
+}
+
+void profileBuiltin(const std::string &name, ProfileClock::duration elapsed) {
+	ProfileEntry *entry = profileEntry(name, true);
+	++entry->calls;
+	entry->inclusive += elapsed;
+	entry->exclusive += elapsed;
+
+	if (!Context.ProfileFrames.empty()) {
+		Context.ProfileFrames.back().children += elapsed;
+	}
 }
 
 /*
@@ -536,6 +600,14 @@ int executeMacro(DocumentWidget *document, Program *prog, gsl::span<DataValue> a
 		context->StackP++;
 	}
 
+	if (ProfilingEnabled) {
+		ProfileEntry *entry = profileEntry(TopLevelProfileName, false);
+		++entry->calls;
+		context->ProfileFrames.push_back({entry, context->FrameP, ProfileClock::now(), ProfileClock::duration::zero()});
+	}
+
+	context->PausedAt = ProfileClock::now();
+
 	// Begin execution, return on error or preemption
 	return continueMacro(context, result, msg);
 }
@@ -562,17 +634,34 @@ ExecReturnCodes continueMacro(const std::shared_ptr<MacroContext> &continuation,
 	*/
 	restoreContext(continuation);
 	ErrorMessage = nullptr;
+
+	// don't charge the time spent preempted to the calls being profiled
+	if (!Context.ProfileFrames.empty()) {
+		const auto paused = ProfileClock::now() - continuation->PausedAt;
+		for (ProfileFrame &frame : Context.ProfileFrames) {
+			frame.start += paused;
+		}
+	}
+
 	Q_FOREVER {
 
 		// Execute an instruction
 		Inst *inst = Context.PC++;
 
+		if (ProfilingEnabled) {
+			++ProfileInstructions;
+			if (!Context.ProfileFrames.empty()) {
+				++Context.ProfileFrames.back().entry->instructions;
+			}
+		}
+
 		auto status = static_cast<OpStatusCodes>(inst->func());
 
 		// If error return was not STAT_OK, return to caller
 		switch (status) {
 		case STAT_PREEMPT:
 			saveContext(continuation);
+			continuation->PausedAt = ProfileClock::now();
 			restoreContext(&oldContext);
 			return MACRO_PREEMPT;
 		case STAT_ERROR:
@@ -595,6 +684,7 @@ ExecReturnCodes continueMacro(const std::shared_ptr<MacroContext> &continuation,
 #if defined(ENABLE_PREEMPTION)
 		if (instCount >= INSTRUCTION_LIMIT) {
 			saveContext(continuation);
+			continuation->PausedAt = ProfileClock::now();
 			restoreContext(&oldContext);
 			return MACRO_TIME_LIMIT;
 		}
@@ -625,6 +715,8 @@ void RunMacroAsSubrCall(Program *prog) {
 		FP_GET_SYM_VAL(Context.FrameP, s) = make_value();
 		Context.StackP++;
 	}
+
+	profileCall(TopLevelProfileName);
 }
 
 /*
@@ -690,7 +782,7 @@ Symbol *InstallIteratorSymbol() {
 Symbol *LookupStringConstSymbol(view::string_view value) {
 
 	auto it = std::find_if(GlobalSymList.begin(), GlobalSymList.end(), [value](Symbol *s) {
-		return (s->type == CONST_SYM && is_string(s->value) && to_string(s->value) == value);
+		return (s->type == CONST_SYM && is_string(s->value) && to_string_view(s->value) == value);
 	});
 
 	if (it != GlobalSymList.end()) {
@@ -881,8 +973,8 @@ Symbol *PromoteToGlobal(Symbol *sym) {
 
 #define BINARY_NUMERIC_OPERATION(op) \
 	do {                             \
-		int n1;                      \
-		int n2;                      \
+		int64_t n1;                  \
+		int64_t n2;                  \
 		DISASM_RT(PC - 1, 1);        \
 		STACKDUMP(2, 3);             \
 		POP_INT(n2);                 \
@@ -893,7 +985,7 @@ Symbol *PromoteToGlobal(Symbol *sym) {
 
 #define UNARY_NUMERIC_OPERATION(op) \
 	do {                            \
-		int n;                      \
+		int64_t n;                  \
 		DISASM_RT(PC - 1, 1);       \
 		STACKDUMP(1, 3);            \
 		POP_INT(n);                 \
@@ -923,7 +1015,7 @@ static int pushSymVal() {
 		symVal = s->value;
 	} else if (s->type == ARG_SYM) {
 		int nArgs  = FP_GET_ARG_COUNT(Context.FrameP);
-		int argNum = to_integer(s->value);
+		int argNum = static_cast<int>(to_integer(s->value));
 		if (argNum >= nArgs) {
 			return execError("referenced undefined argument: %s", s->name.c_str());
 		}
@@ -951,7 +1043,7 @@ static int pushSymVal() {
 }
 
 static int pushArgVal() {
-	int argNum;
+	int64_t argNum;
 
 	DISASM_RT(PC - 1, 1);
 	STACKDUMP(1, 3);
@@ -1170,8 +1262,8 @@ static int add() {
 			return execError("can't mix math with arrays and non-arrays");
 		}
 	} else {
-		int n1;
-		int n2;
+		int64_t n1;
+		int64_t n2;
 
 		POP_INT(n2);
 		POP_INT(n1);
@@ -1238,8 +1330,8 @@ static int subtract() {
 			return execError("can't mix math with arrays and non-arrays");
 		}
 	} else {
-		int n1;
-		int n2;
+		int64_t n1;
+		int64_t n2;
 
 		POP_INT(n2);
 		POP_INT(n1);
@@ -1262,7 +1354,7 @@ static int multiply() {
 }
 
 static int divide() {
-	int n1, n2;
+	int64_t n1, n2;
 
 	DISASM_RT(PC - 1, 1);
 	STACKDUMP(2, 3);
@@ -1277,7 +1369,7 @@ static int divide() {
 }
 
 static int modulo() {
-	int n1, n2;
+	int64_t n1, n2;
 
 	DISASM_RT(PC - 1, 1);
 	STACKDUMP(2, 3);
@@ -1340,18 +1432,18 @@ static int eq() {
 		auto n2 = to_integer(v2);
 		v1      = make_value(n1 == n2);
 	} else if (is_string(v1) && is_string(v2)) {
-		auto s1 = to_string(v1);
-		auto s2 = to_string(v2);
+		auto s1 = to_string_view(v1);
+		auto s2 = to_string_view(v2);
 		v1      = make_value(s1 == s2);
 	} else if (is_string(v1) && is_integer(v2)) {
-		int number;
+		int64_t number;
 		if (!StringToNum(to_string(v1), &number)) {
 			v1 = make_value(0);
 		} else {
 			v1 = make_value(number == to_integer(v2));
 		}
 	} else if (is_string(v2) && is_integer(v1)) {
-		int number;
+		int64_t number;
 		std::string s2 = to_string(v1);
 		if (!StringToNum(s2, &number)) {
 			v1 = make_value(0);
@@ -1425,8 +1517,8 @@ static int bitAnd() {
 			return execError("can't mix math with arrays and non-arrays");
 		}
 	} else {
-		int n1;
-		int n2;
+		int64_t n1;
+		int64_t n2;
 
 		POP_INT(n2);
 		POP_INT(n1);
@@ -1497,8 +1589,8 @@ static int bitOr() {
 			return execError("can't mix math with arrays and non-arrays");
 		}
 	} else {
-		int n1;
-		int n2;
+		int64_t n1;
+		int64_t n2;
 		POP_INT(n2);
 		POP_INT(n1);
 		PUSH_INT(n1 | n2);
@@ -1524,9 +1616,9 @@ static int logicalNot() {
 ** After:  TheStack-> result, next, ...
 */
 static int power() {
-	int n1;
-	int n2;
-	int n3;
+	int64_t n1;
+	int64_t n2;
+	int64_t n3;
 
 	DISASM_RT(PC - 1, 1);
 	STACKDUMP(2, 3);
@@ -1546,15 +1638,15 @@ static int power() {
 			n3 = 0;
 		} else {
 			// allow error to occur
-			n3 = static_cast<int>(pow(static_cast<double>(n1), static_cast<double>(n2)));
+			n3 = static_cast<int64_t>(pow(static_cast<double>(n1), static_cast<double>(n2)));
 		}
 	} else {
 		if ((n1 < 0) && (n2 & 1)) {
 			// round to nearest integer for negative values
-			n3 = static_cast<int>(pow(static_cast<double>(n1), static_cast<double>(n2)) - 0.5);
+			n3 = static_cast<int64_t>(pow(static_cast<double>(n1), static_cast<double>(n2)) - 0.5);
 		} else {
 			// round to nearest integer for positive values
-			n3 = static_cast<int>(pow(static_cast<double>(n1), static_cast<double>(n2)) + 0.5);
+			n3 = static_cast<int64_t>(pow(static_cast<double>(n1), static_cast<double>(n2)) + 0.5);
 		}
 	}
 	PUSH_INT(n3);
@@ -1567,16 +1659,34 @@ static int power() {
 ** After:  TheStack-> result, next, ...
 */
 static int concat() {
-	std::string s1;
-	std::string s2;
+	DataValue v1;
+	DataValue v2;
 
 	DISASM_RT(PC - 1, 1);
 	STACKDUMP(2, 3);
 
-	POP_STRING(s2);
-	POP_STRING(s1);
+	POP(v2);
+	POP(v1);
+
+	if (is_array(v1) || is_array(v2)) {
+		return execError(CantConvertArrayToString);
+	}
 
-	std::string out = s1 + s2;
+	/* The result shares storage with the left hand side where possible, so
+	 * that appending to a string which is being built up in a loop extends
+	 * it in place rather than copying it (see SharedString) */
+	SharedString out;
+	if (is_integer(v1)) {
+		out = SharedString(std::to_string(to_integer(v1)));
+	} else {
+		out = to_shared_string(v1);
+	}
+
+	if (is_integer(v2)) {
+		out.append(std::to_string(to_integer(v2)));
+	} else {
+		out.append(to_string_view(v2));
+	}
 
 	PUSH_STRING(out);
 	return STAT_OK;
@@ -1619,10 +1729,22 @@ static int callSubroutine() {
 		// Call the function and check for preemption
 		PreemptRequest = false;
 
-		if (std::error_code ec = to_subroutine(sym->value)(Context.FocusDocument, Arguments(Context.StackP, nArgs), &result)) {
+		const bool profiling      = ProfilingEnabled;
+		const auto profilingStart = profiling ? ProfileClock::now() : ProfileClock::time_point();
+
+		std::error_code ec = to_subroutine(sym->value)(Context.FocusDocument, Arguments(Context.StackP, nArgs), &result);
+
+		if (profiling) {
+			profileBuiltin(sym->name, ProfileClock::now() - profilingStart);
+		}
+
+		if (ec) {
 			return execError(ec, sym->name.c_str());
 		}
 
+		// built-ins may pass views of their text to each other, but never back to us
+		Q_ASSERT(!is_string_view(result));
+
 		if (Context.PC->func == fetchRetVal) {
 
 			if (is_unset(result)) {
@@ -1658,6 +1780,8 @@ static int callSubroutine() {
 			FP_GET_SYM_VAL(Context.FrameP, s) = make_value();
 			Context.StackP++;
 		}
+
+		profileCall(sym->name);
 		return STAT_OK;
 	}
 
@@ -1701,6 +1825,8 @@ static int returnValOrNone(bool valOnStack) {
 		POP(retVal);
 	}
 
+	profileReturn();
+
 	// get stored return information
 	int nArgs            = FP_GET_ARG_COUNT(Context.FrameP);
 	DataValue *newFrameP = FP_GET_OLD_FP(Context.FrameP);
@@ -1755,7 +1881,7 @@ static int branch() {
 ** After:  or:     Prog->  branchDest, next, ..., (branchdest)[next]
 */
 static int branchTrue() {
-	int value;
+	int64_t value;
 
 	DISASM_RT(PC - 1, 2);
 	STACKDUMP(1, 3);
@@ -1772,7 +1898,7 @@ static int branchTrue() {
 }
 
 static int branchFalse() {
-	int value;
+	int64_t value;
 
 	DISASM_RT(PC - 1, 2);
 	STACKDUMP(1, 3);
@@ -1833,7 +1959,7 @@ static int makeArrayKeyFromArgs(int64_t nArgs, std::string *keyString, bool leav
 		if (is_integer(tmpVal)) {
 			str.append(std::to_string(to_integer(tmpVal)));
 		} else if (is_string(tmpVal)) {
-			auto s = to_string(tmpVal);
+			auto s = to_string_view(tmpVal);
 			str.append(s.begin(), s.end());
 		} else {
 			return execError("can only index array with string or int.");
@@ -2270,7 +2396,75 @@ static int deleteArrayElement() {
 	return STAT_OK;
 }
 
-bool StringToNum(const std::string &string, int *number) {
+/*
+** Begin collecting execution statistics for macros, discarding any which
+** were previously collected
+*/
+void StartMacroProfiling() {
+
+	// entries are reset rather than erased, because the frames of macros which are
+	// currently executing may still refer to them
+	for (auto &pair : ProfileData) {
+		pair.second = ProfileEntry();
+	}
+
+	ProfileInstructions = 0;
+	ProfilingEnabled    = true;
+}
+
+void StopMacroProfiling() {
+	ProfilingEnabled = false;
+}
+
+bool MacroProfilingEnabled() {
+	return ProfilingEnabled;
+}
+
+/*
+** Produce a human readable report of the statistics collected by the
+** profiler, with the most expensive functions (by exclusive time) first.
+** Inclusive time includes time spent in functions called by the function,
+** exclusive time does not.
+*/
+std::string MacroProfileReport() {
+
+	std::vector<std::pair<std::string, ProfileEntry>> entries;
+	std::copy_if(ProfileData.begin(), ProfileData.end(), std::back_inserter(entries), [](const std::pair<const std::string, ProfileEntry> &pair) {
+		return pair.second.calls != 0;
+	});
+
+	std::sort(entries.begin(), entries.end(), [](const std::pair<std::string, ProfileEntry> &lhs, const std::pair<std::string, ProfileEntry> &rhs) {
+		return lhs.second.exclusive > rhs.second.exclusive;
+	});
+
+	auto toMilliseconds = [](ProfileClock::duration d) {
+		return std::chrono::duration<double, std::milli>(d).count();
+	};
+
+	std::string report;
+	char line[256];
+
+	qsnprintf(line, sizeof(line), "%-32s %-7s %10s %14s %14s %14s\n", "function", "type", "calls", "inclusive ms", "exclusive ms", "instructions");
+	report.append(line);
+
+	for (const auto &pair : entries) {
+		const ProfileEntry &entry = pair.second;
+		qsnprintf(line, sizeof(line), "%-32s %-7s %10" PRIu64 " %14.3f %14.3f %14" PRIu64 "\n",
+				  pair.first.c_str(),
+				  entry.builtin ? "builtin" : "macro",
+				  entry.calls,
+				  toMilliseconds(entry.inclusive),
+				  toMilliseconds(entry.exclusive),
+				  entry.instructions);
+		report.append(line);
+	}
+
+	qsnprintf(line, sizeof(line), "total instructions executed: %" PRIu64 "\n", ProfileInstructions);
+	report.append(line);
+	return report;
+}
+
+bool StringToNum(const std::string &string, int64_t *number) {
 	auto it = string.begin();
 
 	while (*it == ' ' || *it == '\t') {
@@ -2295,7 +2489,7 @@ bool StringToNum(const std::string &string, int *number) {
 	}
 
 	if (number) {
-		if (sscanf(string.c_str(), "%d", number) != 1) {
+		if (sscanf(string.c_str(), "%" SCNd64, number) != 1) {
 			// This case is here to support old behavior
 			*number = 0;
 		}
@@ -2330,7 +2524,7 @@ static void dumpVal(DataValue dv) {
 	};
 
 	if (is_integer(dv)) {
-		printf("i=%d", to_integer(dv));
+		printf("i=%" PRId64, to_integer(dv));
 	} else if (is_string(dv)) {
 		auto str = to_string(dv);
 		if (str.size() > 20) {
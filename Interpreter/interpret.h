@@ -7,6 +7,7 @@
 
 #include <gsl/span>
 
+#include <chrono>
 #include <deque>
 #include <memory>
 #include <vector>
@@ -110,6 +111,23 @@ struct Program {
 	std::vector<Inst> code;
 };
 
+/* Execution statistics collected by the profiler for a single function */
+struct ProfileEntry {
+	uint64_t calls                                = 0;
+	uint64_t instructions                         = 0; // instructions executed by the function itself
+	std::chrono::steady_clock::duration inclusive = {};
+	std::chrono::steady_clock::duration exclusive = {};
+	bool builtin                                  = false;
+};
+
+/* A macro function call which is being timed by the profiler */
+struct ProfileFrame {
+	ProfileEntry *entry;                          // statistics for the function being called
+	DataValue *FrameP;                            // frame pointer of the call, used to match up returns
+	std::chrono::steady_clock::time_point start;  // when the call started (adjusted for time spent preempted)
+	std::chrono::steady_clock::duration children; // time spent in calls made by this function
+};
+
 /* Information needed to re-start a preempted macro */
 struct MacroContext {
 
@@ -121,6 +139,8 @@ struct MacroContext {
 	Inst *PC                      = nullptr; // program counter during execution
 	DocumentWidget *RunDocument   = nullptr; // document from which macro was run
 	DocumentWidget *FocusDocument = nullptr; // document on which macro commands operate
+	std::vector<ProfileFrame> ProfileFrames;        // calls being timed by the profiler
+	std::chrono::steady_clock::time_point PausedAt; // when execution was last suspended
 };
 
 void InitMacroGlobals();
@@ -168,7 +188,13 @@ DocumentWidget *MacroRunDocument();
 DocumentWidget *MacroFocusDocument();
 void SetMacroFocusDocument(DocumentWidget *document);
 
+// Routines for profiling macro execution
+void StartMacroProfiling();
+void StopMacroProfiling();
+bool MacroProfilingEnabled();
+std::string MacroProfileReport();
+
 // function used for implicit conversion from string to number
-bool StringToNum(const std::string &string, int *number);
+bool StringToNum(const std::string &string, int64_t *number);
 
 #endif
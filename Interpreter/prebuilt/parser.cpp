@@ -78,6 +78,7 @@
 #include <cstring>
 #include <cstdio>
 #include <cctype>
+#include <cinttypes>
 #include <string>
 
 /* Macros to add error processing to AddOp and AddSym calls */
@@ -2807,10 +2808,10 @@ static int yylex(void) {
             *p++ = *InPtr++;
         }
 
-        int n = value.toInt();
+        int64_t n = value.toLongLong();
 
         char name[28];
-        snprintf(name, sizeof(name), "const %d", n);
+        snprintf(name, sizeof(name), "const %" PRId64, n);
 
         if ((yylval.sym = LookupSymbol(name)) == nullptr) {
             yylval.sym = InstallSymbol(name, CONST_SYM, make_value(n));
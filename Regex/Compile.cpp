@@ -118,11 +118,11 @@ bool isQuantifier(char ch) noexcept {
  *--------------------------------------------------------------------*/
 bool init_ansi_classes() noexcept {
 
-	static bool initialized = false;
-
-	if (!initialized) {
-		initialized = true; // Only need to generate character sets once.
-
+	// Only need to generate character sets once. The tables are built by
+	// whichever thread compiles an expression first, and the initialization of
+	// a function local static guarantees that no other thread sees them before
+	// they are complete.
+	static const bool initialized = []() noexcept {
 		constexpr char Underscore = '_';
 		constexpr char Newline    = '\n';
 
@@ -160,9 +160,10 @@ bool init_ansi_classes() noexcept {
 		Word_Char[word_count]     = '\0';
 		Letter_Char[letter_count] = '\0';
 		White_Space[space_count]  = '\0';
-	}
+		return true;
+	}();
 
-	return true;
+	return initialized;
 }
 
 /*----------------------------------------------------------------------*
@@ -26,6 +26,6 @@ struct ParseContext {
 	char Brace_Char;
 };
 
-extern ParseContext pContext;
+extern thread_local ParseContext pContext;
 
 #endif
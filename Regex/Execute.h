@@ -46,6 +46,6 @@ struct ExecuteContext {
 	std::bitset<256> Current_Delimiters; // Current delimiter table
 };
 
-extern ExecuteContext eContext;
+extern thread_local ExecuteContext eContext;
 
 #endif
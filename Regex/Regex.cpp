@@ -87,8 +87,10 @@
 // Default table for determining whether a character is a word delimiter.
 std::bitset<256> Regex::Default_Delimiters;
 
-ExecuteContext eContext;
-ParseContext pContext;
+// the contexts are per thread so that searches may run on worker threads
+// while the GUI thread is compiling or executing other expressions
+thread_local ExecuteContext eContext;
+thread_local ParseContext pContext;
 
 /* The "internal use only" fields in `Regex.h' are present to pass info from
  * `CompileRE' to `ExecRE' which permits the execute phase to run lots faster on
@@ -108,6 +108,7 @@ QString fontName;
 QString titleFormat;
 
 bool autoWrapPastedText;
+bool backgroundSave;
 bool colorizeHighlightedText;
 bool heavyCursor;
 bool alwaysCheckRelativeTagsSpecs;
@@ -119,9 +120,14 @@ bool stickyCaseSenseButton;
 bool typingHidesPointer;
 bool undoModifiesSelection;
 bool splitHorizontally;
+bool syncOnSave;
+bool recompressOnSave;
+bool deferredOpen;
+bool prefetchDeferred;
 int truncateLongNamesInTabs;
 int autoScrollVPadding;
 int maxPrevOpenFiles;
+int documentMemoryLimit;
 TruncSubstitution truncSubstitution;
 QString backlightCharTypes;
 QString tagFile;
@@ -322,6 +328,12 @@ void loadPreferences(bool isServer) {
 	focusOnRaise                 = settings.value(tr("nedit.focusOnRaise"), false).toBool();
 	forceOSConversion            = settings.value(tr("nedit.forceOSConversion"), true).toBool();
 	honorSymlinks                = settings.value(tr("nedit.honorSymlinks"), true).toBool();
+	backgroundSave               = settings.value(tr("nedit.backgroundSave"), false).toBool();
+	syncOnSave                   = settings.value(tr("nedit.syncOnSave"), true).toBool();
+	recompressOnSave             = settings.value(tr("nedit.recompressOnSave"), true).toBool();
+	deferredOpen                 = settings.value(tr("nedit.deferredOpen"), false).toBool();
+	prefetchDeferred             = settings.value(tr("nedit.prefetchDeferred"), false).toBool();
+	documentMemoryLimit          = settings.value(tr("nedit.documentMemoryLimit"), 0).toInt();
 
 	if (isServer && serverName.isEmpty()) {
 		serverName = randomString(8);
@@ -419,6 +431,12 @@ void importSettings(const QString &filename) {
 	focusOnRaise                 = settings.value(tr("nedit.focusOnRaise"), focusOnRaise).toBool();
 	forceOSConversion            = settings.value(tr("nedit.forceOSConversion"), forceOSConversion).toBool();
 	honorSymlinks                = settings.value(tr("nedit.honorSymlinks"), honorSymlinks).toBool();
+	backgroundSave               = settings.value(tr("nedit.backgroundSave"), backgroundSave).toBool();
+	syncOnSave                   = settings.value(tr("nedit.syncOnSave"), syncOnSave).toBool();
+	recompressOnSave             = settings.value(tr("nedit.recompressOnSave"), recompressOnSave).toBool();
+	deferredOpen                 = settings.value(tr("nedit.deferredOpen"), deferredOpen).toBool();
+	prefetchDeferred             = settings.value(tr("nedit.prefetchDeferred"), prefetchDeferred).toBool();
+	documentMemoryLimit          = settings.value(tr("nedit.documentMemoryLimit"), documentMemoryLimit).toInt();
 }
 
 /**
@@ -503,6 +521,12 @@ bool savePreferences() {
 	settings.setValue(tr("nedit.focusOnRaise"), focusOnRaise);
 	settings.setValue(tr("nedit.forceOSConversion"), forceOSConversion);
 	settings.setValue(tr("nedit.honorSymlinks"), honorSymlinks);
+	settings.setValue(tr("nedit.backgroundSave"), backgroundSave);
+	settings.setValue(tr("nedit.syncOnSave"), syncOnSave);
+	settings.setValue(tr("nedit.recompressOnSave"), recompressOnSave);
+	settings.setValue(tr("nedit.deferredOpen"), deferredOpen);
+	settings.setValue(tr("nedit.prefetchDeferred"), prefetchDeferred);
+	settings.setValue(tr("nedit.documentMemoryLimit"), documentMemoryLimit);
 
 	settings.sync();
 	return settings.status() == QSettings::NoError;
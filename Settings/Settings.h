@@ -103,6 +103,7 @@ extern QString titleFormat;
 
 // Advanced
 extern bool autoWrapPastedText;
+extern bool backgroundSave;
 extern bool colorizeHighlightedText;
 extern bool heavyCursor;
 extern bool alwaysCheckRelativeTagsSpecs;
@@ -114,9 +115,14 @@ extern bool stickyCaseSenseButton;
 extern bool typingHidesPointer;
 extern bool undoModifiesSelection;
 extern bool splitHorizontally;
+extern bool syncOnSave;
+extern bool recompressOnSave;
+extern bool deferredOpen;
+extern bool prefetchDeferred;
 extern int truncateLongNamesInTabs;
 extern int autoScrollVPadding;
 extern int maxPrevOpenFiles;
+extern int documentMemoryLimit;
 extern TruncSubstitution truncSubstitution;
 extern QString backlightCharTypes;
 extern QString tagFile;
@@ -0,0 +1,423 @@
+
+#include "Util/Codec.h"
+#include <QFile>
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#ifdef NEDIT_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef NEDIT_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace {
+
+// the output grows by this many characters at a time
+constexpr size_t OutputChunkSize = 256 * 1024;
+
+// the most that is handed to a library in one call, which keeps it within what an unsigned int can count
+constexpr size_t InputChunkSize = 64 * 1024 * 1024;
+
+// the longest magic number of any format
+constexpr qint64 MaxMagicLength = 4;
+
+#ifdef NEDIT_HAVE_ZLIB
+/*
+** gzip files, which may hold several gzip streams one after the other, as
+** some log rotators write them.
+*/
+class GzipDecompressor final : public Decompressor {
+public:
+	GzipDecompressor() {
+		// 32 lets zlib find out from the header whether the data is gzip or zlib
+		valid_ = inflateInit2(&stream_, 15 + 32) == Z_OK;
+	}
+
+	~GzipDecompressor() override {
+		if (valid_) {
+			inflateEnd(&stream_);
+		}
+	}
+
+public:
+	bool decompress(view::string_view input, std::string *output, QString *error) override {
+
+		if (!valid_) {
+			*error = QLatin1String("zlib could not be initialized");
+			return false;
+		}
+
+		for (size_t pos = 0; pos < input.size(); pos += InputChunkSize) {
+			const view::string_view piece = input.substr(pos, InputChunkSize);
+
+			stream_.next_in  = reinterpret_cast<Bytef *>(const_cast<char *>(piece.data()));
+			stream_.avail_in = static_cast<uInt>(piece.size());
+
+			do {
+				// the next stream starts straight after the end of the last one,
+				// if there is one. The loop also comes round again when a stream
+				// ends just as the output fills up, which mustn't forget that it
+				// ended
+				if (ended_ && stream_.avail_in != 0) {
+					inflateReset(&stream_);
+					ended_ = false;
+				}
+
+				const size_t used = output->size();
+				output->resize(used + OutputChunkSize);
+
+				stream_.next_out  = reinterpret_cast<Bytef *>(&(*output)[used]);
+				stream_.avail_out = static_cast<uInt>(OutputChunkSize);
+
+				const int rc = inflate(&stream_, Z_NO_FLUSH);
+				output->resize(used + OutputChunkSize - stream_.avail_out);
+
+				if (rc == Z_STREAM_END) {
+					ended_ = true;
+				} else if (rc == Z_BUF_ERROR) {
+					// nothing more can be done until there is more input
+					break;
+				} else if (rc != Z_OK) {
+					*error = QString::fromLatin1(stream_.msg ? stream_.msg : "the compressed data is damaged");
+					return false;
+				}
+			} while (stream_.avail_in != 0 || stream_.avail_out == 0);
+		}
+
+		return true;
+	}
+
+	bool finish(QString *error) override {
+		if (!ended_) {
+			*error = QLatin1String("the compressed data ends unexpectedly");
+			return false;
+		}
+
+		return true;
+	}
+
+private:
+	z_stream stream_ = {};
+	bool valid_      = false;
+	bool ended_      = false;
+};
+
+class GzipCompressor final : public Compressor {
+public:
+	GzipCompressor() {
+		// 16 makes it write a gzip header and trailer
+		valid_ = deflateInit2(&stream_, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) == Z_OK;
+	}
+
+	~GzipCompressor() override {
+		if (valid_) {
+			deflateEnd(&stream_);
+		}
+	}
+
+public:
+	bool compress(view::string_view input, std::string *output, QString *error) override {
+
+		for (size_t pos = 0; pos < input.size(); pos += InputChunkSize) {
+			const view::string_view piece = input.substr(pos, InputChunkSize);
+
+			stream_.next_in  = reinterpret_cast<Bytef *>(const_cast<char *>(piece.data()));
+			stream_.avail_in = static_cast<uInt>(piece.size());
+
+			if (!run(Z_NO_FLUSH, output, error)) {
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	bool finish(std::string *output, QString *error) override {
+		stream_.next_in  = nullptr;
+		stream_.avail_in = 0;
+		return run(Z_FINISH, output, error);
+	}
+
+private:
+	bool run(int flush, std::string *output, QString *error) {
+
+		if (!valid_) {
+			*error = QLatin1String("zlib could not be initialized");
+			return false;
+		}
+
+		int rc;
+		do {
+			const size_t used = output->size();
+			output->resize(used + OutputChunkSize);
+
+			stream_.next_out  = reinterpret_cast<Bytef *>(&(*output)[used]);
+			stream_.avail_out = static_cast<uInt>(OutputChunkSize);
+
+			rc = deflate(&stream_, flush);
+			output->resize(used + OutputChunkSize - stream_.avail_out);
+
+			if (rc == Z_STREAM_ERROR) {
+				*error = QString::fromLatin1(stream_.msg ? stream_.msg : "the text could not be compressed");
+				return false;
+			}
+		} while (stream_.avail_out == 0 || (flush == Z_FINISH && rc != Z_STREAM_END));
+
+		return true;
+	}
+
+private:
+	z_stream stream_ = {};
+	bool valid_      = false;
+};
+
+std::unique_ptr<Decompressor> createGzipDecompressor() {
+	return std::make_unique<GzipDecompressor>();
+}
+
+std::unique_ptr<Compressor> createGzipCompressor() {
+	return std::make_unique<GzipCompressor>();
+}
+#endif
+
+#ifdef NEDIT_HAVE_ZSTD
+/*
+** zstd files. Like gzip files, they may be several frames one after the other.
+*/
+class ZstdDecompressor final : public Decompressor {
+public:
+	ZstdDecompressor()
+		: stream_(ZSTD_createDStream()) {
+		if (stream_) {
+			ZSTD_initDStream(stream_);
+		}
+	}
+
+	~ZstdDecompressor() override {
+		ZSTD_freeDStream(stream_);
+	}
+
+public:
+	bool decompress(view::string_view input, std::string *output, QString *error) override {
+
+		if (!stream_) {
+			*error = QLatin1String("zstd could not be initialized");
+			return false;
+		}
+
+		ZSTD_inBuffer in = {input.data(), input.size(), 0};
+
+		ZSTD_outBuffer out;
+		do {
+			const size_t used = output->size();
+			output->resize(used + OutputChunkSize);
+
+			out = {&(*output)[used], OutputChunkSize, 0};
+
+			// non-zero until the end of a frame has been reached
+			remaining_ = ZSTD_decompressStream(stream_, &out, &in);
+			output->resize(used + out.pos);
+
+			if (ZSTD_isError(remaining_)) {
+				*error = QString::fromLatin1(ZSTD_getErrorName(remaining_));
+				return false;
+			}
+
+			// a frame which ends just as the output fills up has nothing more to
+			// flush, and asking again would start on a next frame which isn't there
+		} while (in.pos != in.size || (out.pos == out.size && remaining_ != 0));
+
+		return true;
+	}
+
+	bool finish(QString *error) override {
+		if (remaining_ != 0) {
+			*error = QLatin1String("the compressed data ends unexpectedly");
+			return false;
+		}
+
+		return true;
+	}
+
+private:
+	ZSTD_DStream *stream_;
+	size_t remaining_ = 1;
+};
+
+class ZstdCompressor final : public Compressor {
+public:
+	ZstdCompressor()
+		: stream_(ZSTD_createCStream()) {
+		if (stream_) {
+			ZSTD_initCStream(stream_, ZSTD_CLEVEL_DEFAULT);
+		}
+	}
+
+	~ZstdCompressor() override {
+		ZSTD_freeCStream(stream_);
+	}
+
+public:
+	bool compress(view::string_view input, std::string *output, QString *error) override {
+
+		if (!stream_) {
+			*error = QLatin1String("zstd could not be initialized");
+			return false;
+		}
+
+		ZSTD_inBuffer in = {input.data(), input.size(), 0};
+
+		while (in.pos != in.size) {
+			const size_t used = output->size();
+			output->resize(used + OutputChunkSize);
+
+			ZSTD_outBuffer out = {&(*output)[used], OutputChunkSize, 0};
+
+			const size_t rc = ZSTD_compressStream(stream_, &out, &in);
+			output->resize(used + out.pos);
+
+			if (ZSTD_isError(rc)) {
+				*error = QString::fromLatin1(ZSTD_getErrorName(rc));
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	bool finish(std::string *output, QString *error) override {
+
+		if (!stream_) {
+			*error = QLatin1String("zstd could not be initialized");
+			return false;
+		}
+
+		size_t remaining;
+		do {
+			const size_t used = output->size();
+			output->resize(used + OutputChunkSize);
+
+			ZSTD_outBuffer out = {&(*output)[used], OutputChunkSize, 0};
+
+			remaining = ZSTD_endStream(stream_, &out);
+			output->resize(used + out.pos);
+
+			if (ZSTD_isError(remaining)) {
+				*error = QString::fromLatin1(ZSTD_getErrorName(remaining));
+				return false;
+			}
+		} while (remaining != 0);
+
+		return true;
+	}
+
+private:
+	ZSTD_CStream *stream_;
+};
+
+std::unique_ptr<Decompressor> createZstdDecompressor() {
+	return std::make_unique<ZstdDecompressor>();
+}
+
+std::unique_ptr<Compressor> createZstdCompressor() {
+	return std::make_unique<ZstdCompressor>();
+}
+#endif
+
+/**
+ * @brief codecs
+ * @return all of the formats available in this build, fastest first
+ */
+const std::vector<Codec> &codecs() {
+	static const std::vector<Codec> list = {
+#ifdef NEDIT_HAVE_ZSTD
+		{"zstd", ".zst", "\x28\xb5\x2f\xfd", 4, createZstdDecompressor, createZstdCompressor},
+#endif
+#ifdef NEDIT_HAVE_ZLIB
+		{"gzip", ".gz", "\x1f\x8b", 2, createGzipDecompressor, createGzipCompressor},
+#endif
+	};
+
+	return list;
+}
+
+}
+
+/**
+ * @brief CodecForData
+ * @param header the start of the contents of a file
+ * @return the format the data is compressed in, or nullptr if it doesn't look
+ * compressed
+ */
+const Codec *CodecForData(view::string_view header) {
+
+	for (const Codec &codec : codecs()) {
+		if (header.size() >= codec.magicLength && std::memcmp(header.data(), codec.magic, codec.magicLength) == 0) {
+			return &codec;
+		}
+	}
+
+	return nullptr;
+}
+
+/**
+ * @brief CodecForFile
+ * @param fileName
+ * @return the format the file is compressed in, or nullptr if it doesn't look
+ * compressed or can't be read
+ */
+const Codec *CodecForFile(const QString &fileName) {
+
+	QFile file(fileName);
+	if (!file.open(QIODevice::ReadOnly)) {
+		return nullptr;
+	}
+
+	const QByteArray header = file.read(MaxMagicLength);
+	return CodecForData(view::string_view(header.data(), static_cast<size_t>(header.size())));
+}
+
+/**
+ * @brief CodecForFileName
+ * @param fileName
+ * @return the format a file of this name would be expected to be compressed
+ * in, going by its extension, or nullptr if none
+ */
+const Codec *CodecForFileName(const QString &fileName) {
+
+	for (const Codec &codec : codecs()) {
+		if (fileName.endsWith(QLatin1String(codec.suffix))) {
+			return &codec;
+		}
+	}
+
+	return nullptr;
+}
+
+/**
+ * @brief DefaultCodec
+ * @return the fastest format available, for data which only NEdit-ng itself
+ * reads back, or nullptr if there are none
+ */
+const Codec *DefaultCodec() {
+	return codecs().empty() ? nullptr : &codecs().front();
+}
+
+/**
+ * @brief Decompress
+ * @param codec
+ * @param input the whole of the compressed data
+ * @param output set to what it decompresses to
+ * @param error set to the reason when it can't be decompressed
+ * @return
+ */
+bool Decompress(const Codec *codec, view::string_view input, std::string *output, QString *error) {
+
+	std::unique_ptr<Decompressor> decompressor = codec->createDecompressor();
+
+	output->clear();
+	return decompressor->decompress(input, output, error) && decompressor->finish(error);
+}
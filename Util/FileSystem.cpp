@@ -1,14 +1,41 @@
 
 #include "Util/FileSystem.h"
 #include "Util/ClearCase.h"
+#include "Util/Codec.h"
 #include "Util/FileFormats.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
 #include <fstream>
+#include <initializer_list>
 #include <iostream>
 #include <iterator>
+#include <vector>
 
 #include <QDir>
+#include <QFile>
 #include <QFileInfo>
+#include <QTemporaryFile>
+#include <qplatformdefs.h>
+
+#ifdef Q_OS_UNIX
+#include <csignal>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FILE_SYSTEM_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
 
 namespace {
 
@@ -20,6 +47,300 @@ namespace {
 constexpr int FORMAT_SAMPLE_LINES = 5;
 constexpr int FORMAT_SAMPLE_CHARS = 2000;
 
+/* Text which has to be converted to DOS or Macintosh format on its way to the
+   disk is converted and written this many characters at a time, so that the
+   converted copy never takes more than twice this much memory */
+constexpr size_t WRITE_CHUNK_SIZE = 1024 * 1024;
+
+// files are hashed this many characters at a time
+constexpr size_t HASH_CHUNK_SIZE = 1024 * 1024;
+
+/*
+** Writes all of the given pieces of text to file, in order.
+*/
+bool writeSegments(QFile *file, std::initializer_list<view::string_view> segments, QString *error) {
+
+#ifdef Q_OS_UNIX
+	// hand all of the pieces to the kernel at once, straight from where they
+	// are, looping for as long as it takes them only partially
+	const int fd = file->handle();
+
+	std::vector<iovec> iov;
+	for (view::string_view segment : segments) {
+		if (!segment.empty()) {
+			iov.push_back({const_cast<char *>(segment.data()), segment.size()});
+		}
+	}
+
+	size_t next = 0;
+	while (next != iov.size()) {
+		const ssize_t n = ::writev(fd, &iov[next], static_cast<int>(iov.size() - next));
+		if (n < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+
+			*error = QString::fromLocal8Bit(strerror(errno));
+			return false;
+		}
+
+		auto written = static_cast<size_t>(n);
+		while (next != iov.size() && written >= iov[next].iov_len) {
+			written -= iov[next].iov_len;
+			++next;
+		}
+
+		if (written != 0) {
+			iov[next].iov_base = static_cast<char *>(iov[next].iov_base) + written;
+			iov[next].iov_len -= written;
+		}
+	}
+
+	return true;
+#else
+	for (view::string_view segment : segments) {
+		if (file->write(segment.data(), static_cast<qint64>(segment.size())) != static_cast<qint64>(segment.size())) {
+			*error = file->errorString();
+			return false;
+		}
+	}
+
+	return true;
+#endif
+}
+
+#if defined(FILE_SYSTEM_SSE2)
+constexpr size_t BlockSize = 16;
+
+// a block of 255 has as many matches as a byte counter can hold
+constexpr size_t MaxCountBlocks = 255;
+
+unsigned int lowestBit(unsigned int mask) {
+#if defined(_MSC_VER)
+	unsigned long index;
+	_BitScanForward(&index, mask);
+	return index;
+#else
+	return static_cast<unsigned int>(__builtin_ctz(mask));
+#endif
+}
+#endif
+
+/*
+** Counts the occurrences of ch in the first length characters of text. The
+** matches are counted 16 characters at a time in a vector of byte counters,
+** which are added up before any of them can overflow.
+*/
+size_t countCharacter(const char *text, size_t length, char ch) {
+
+	size_t count    = 0;
+	const char *end = text + length;
+
+#if defined(FILE_SYSTEM_SSE2)
+	const __m128i needle = _mm_set1_epi8(ch);
+	const __m128i zero   = _mm_setzero_si128();
+
+	while (static_cast<size_t>(end - text) >= BlockSize) {
+		const size_t blocks = std::min(static_cast<size_t>(end - text) / BlockSize, MaxCountBlocks);
+
+		__m128i counters = zero;
+		for (size_t i = 0; i < blocks; ++i, text += BlockSize) {
+			const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(text));
+
+			// a match is all ones, which is -1, so subtracting it counts it
+			counters = _mm_sub_epi8(counters, _mm_cmpeq_epi8(block, needle));
+		}
+
+		const __m128i sums = _mm_sad_epu8(counters, zero);
+		count += static_cast<size_t>(_mm_cvtsi128_si32(sums)) + static_cast<size_t>(_mm_cvtsi128_si32(_mm_srli_si128(sums, 8)));
+	}
+#endif
+
+	return count + static_cast<size_t>(std::count(text, end, ch));
+}
+
+/*
+** Copies length characters from in to out, which may be the same place,
+** replacing every from with to on the way.
+*/
+void copyReplacing(const char *in, char *out, size_t length, char from, char to) {
+
+	const char *end = in + length;
+
+#if defined(FILE_SYSTEM_SSE2)
+	const __m128i fromBlock = _mm_set1_epi8(from);
+	const __m128i toBlock   = _mm_set1_epi8(to);
+
+	for (; static_cast<size_t>(end - in) >= BlockSize; in += BlockSize, out += BlockSize) {
+		const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in));
+		const __m128i match = _mm_cmpeq_epi8(block, fromBlock);
+		const __m128i value = _mm_or_si128(_mm_and_si128(match, toBlock), _mm_andnot_si128(match, block));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(out), value);
+	}
+#endif
+
+	std::replace_copy(in, end, out, from, to);
+}
+
+/*
+** Returns the first carriage return or newline in [text, end), or end if
+** there is neither.
+*/
+const char *findLineBreak(const char *text, const char *end) {
+
+#if defined(FILE_SYSTEM_SSE2)
+	const __m128i newline = _mm_set1_epi8('\n');
+	const __m128i cr      = _mm_set1_epi8('\r');
+
+	for (; static_cast<size_t>(end - text) >= BlockSize; text += BlockSize) {
+		const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(text));
+		const auto mask     = static_cast<unsigned int>(_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(block, newline), _mm_cmpeq_epi8(block, cr))));
+		if (mask != 0) {
+			return text + lowestBit(mask);
+		}
+	}
+#endif
+
+	return std::find_if(text, end, [](char ch) {
+		return ch == '\n' || ch == '\r';
+	});
+}
+
+/*
+** Copies [in, end) to out, putting a carriage return in front of every
+** newline. The lines in between are copied whole, rather than a character at
+** a time. Returns the end of what was stored.
+*/
+char *insertReturns(const char *in, const char *end, char *out) {
+
+	while (in != end) {
+		const auto newline = static_cast<const char *>(std::memchr(in, '\n', static_cast<size_t>(end - in)));
+		if (!newline) {
+			return std::copy(in, end, out);
+		}
+
+		out    = std::copy(in, newline, out);
+		*out++ = '\r';
+		*out++ = '\n';
+		in     = newline + 1;
+	}
+
+	return out;
+}
+
+/*
+** Converts <text> from Unix to DOS or Macintosh format into <out>, which has
+** to have room for twice as many characters.
+** Returns the number of characters stored.
+*/
+size_t convertChunk(view::string_view text, FileFormats format, char *out) {
+
+	if (format == FileFormats::Dos) {
+		return static_cast<size_t>(insertReturns(text.data(), text.data() + text.size(), out) - out);
+	}
+
+	copyReplacing(text.data(), out, text.size(), '\n', '\r');
+	return text.size();
+}
+
+/*
+** Writes text to file compressed with codec, converting it to format on the
+** way. The text is converted and compressed a chunk at a time, so that the
+** whole of it is never held in memory in either form.
+*/
+bool writeCompressed(QFile *file, view::string_view first, view::string_view second, FileFormats format, const Codec *codec, QString *error, QCryptographicHash *hash) {
+
+	std::unique_ptr<Compressor> compressor = codec->createCompressor();
+
+	std::vector<char> buffer(2 * WRITE_CHUNK_SIZE);
+	std::string compressed;
+
+	auto write = [&]() {
+		if (hash) {
+			AddToHash(hash, compressed);
+		}
+
+		const bool written = writeSegments(file, {compressed}, error);
+		compressed.clear();
+		return written;
+	};
+
+	for (view::string_view segment : {first, second}) {
+		for (size_t pos = 0; pos < segment.size(); pos += WRITE_CHUNK_SIZE) {
+			view::string_view chunk = segment.substr(pos, WRITE_CHUNK_SIZE);
+			if (format != FileFormats::Unix) {
+				chunk = view::string_view(buffer.data(), convertChunk(chunk, format, buffer.data()));
+			}
+
+			if (!compressor->compress(chunk, &compressed, error) || !write()) {
+				return false;
+			}
+		}
+	}
+
+	return compressor->finish(&compressed, error) && write();
+}
+
+#ifdef Q_OS_UNIX
+/* Mapped files which may be cut short while they are in use. Reading a page of
+   one of these past the new end of the file raises SIGBUS, and busHandler puts
+   a page of zeros in its place, so that the read can carry on. The handler
+   can't take locks, so the mappings are kept in a fixed number of slots which
+   are claimed and given back atomically */
+constexpr int MAX_GUARDED_MAPPINGS = 64;
+
+struct GuardedMapping {
+	std::atomic<uintptr_t> begin;
+	std::atomic<uintptr_t> end;
+};
+
+GuardedMapping guardedMappings[MAX_GUARDED_MAPPINGS];
+struct sigaction previousBusAction;
+uintptr_t pageSize;
+
+/*
+** Replaces the page of a guarded mapping which couldn't be read, so that the
+** read is tried again on return. Faults anywhere else are left to whatever
+** would have handled them without us, once the read which caused them is.
+*/
+void busHandler(int signal, siginfo_t *info, void *context) {
+
+	Q_UNUSED(signal)
+	Q_UNUSED(context)
+
+	const auto address = reinterpret_cast<uintptr_t>(info->si_addr);
+
+	for (const GuardedMapping &mapping : guardedMappings) {
+		const uintptr_t begin = mapping.begin.load();
+		if (begin != 0 && address >= begin && address < mapping.end.load()) {
+			void *const page = reinterpret_cast<void *>(address & ~(pageSize - 1));
+			if (::mmap(page, pageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0) != MAP_FAILED) {
+				return;
+			}
+
+			break;
+		}
+	}
+
+	::sigaction(SIGBUS, &previousBusAction, nullptr);
+}
+
+/*
+** Installs busHandler, returns false if it can't be.
+*/
+bool installBusHandler() {
+
+	pageSize = static_cast<uintptr_t>(::sysconf(_SC_PAGESIZE));
+
+	struct sigaction action = {};
+	action.sa_sigaction     = busHandler;
+	action.sa_flags         = SA_SIGINFO;
+	sigemptyset(&action.sa_mask);
+
+	return ::sigaction(SIGBUS, &action, &previousBusAction) == 0;
+}
+#endif
+
 }
 
 /**
@@ -119,19 +440,21 @@ FileFormats FormatOfFile(view::string_view text) {
 	size_t nNewlines = 0;
 	size_t nReturns  = 0;
 
-	const auto end = std::min(text.end(), text.begin() + FORMAT_SAMPLE_CHARS);
+	const char *begin = text.data();
+	const char *end   = begin + std::min(text.size(), static_cast<size_t>(FORMAT_SAMPLE_CHARS));
 
-	for (auto it = text.begin(); it != end; ++it) {
+	// only the line breaks matter, so skip straight from one to the next
+	for (const char *it = findLineBreak(begin, end); it != end; it = findLineBreak(it + 1, end)) {
 		if (*it == '\n') {
 			nNewlines++;
-			if (it == text.begin() || *std::prev(it) != '\r') {
+			if (it == begin || it[-1] != '\r') {
 				return FileFormats::Unix;
 			}
 
 			if (nNewlines >= FORMAT_SAMPLE_LINES) {
 				return FileFormats::Dos;
 			}
-		} else if (*it == '\r') {
+		} else {
 			nReturns++;
 		}
 	}
@@ -147,31 +470,216 @@ FileFormats FormatOfFile(view::string_view text) {
 	return FileFormats::Unix;
 }
 
+/**
+ * Writes text to file in the given format, without ever needing a converted
+ * copy of the whole text: Unix text is written directly, and DOS and Macintosh
+ * text is converted and written a chunk at a time. The text is passed as two
+ * pieces, so that the two halves of a gap buffer can be written as they are.
+ * Compressed text is compressed a chunk at a time in the same way.
+ *
+ * @brief WriteTextFile
+ * @param file an open file, which mustn't have anything waiting in its buffer
+ * @param first
+ * @param second
+ * @param format
+ * @param error set to the reason when the file couldn't be written
+ * @param hash if given, is fed the characters as they are written
+ * @param codec if given, the format the file is compressed in
+ * @return
+ */
+bool WriteTextFile(QFile *file, view::string_view first, view::string_view second, FileFormats format, QString *error, QCryptographicHash *hash, const Codec *codec) {
+
+	if (codec) {
+		return writeCompressed(file, first, second, format, codec, error, hash);
+	}
+
+	if (format == FileFormats::Unix) {
+		if (hash) {
+			AddToHash(hash, first);
+			AddToHash(hash, second);
+		}
+
+		return writeSegments(file, {first, second}, error);
+	}
+
+	std::vector<char> buffer(2 * WRITE_CHUNK_SIZE);
+
+	for (view::string_view segment : {first, second}) {
+		for (size_t pos = 0; pos < segment.size(); pos += WRITE_CHUNK_SIZE) {
+			const size_t length = convertChunk(segment.substr(pos, WRITE_CHUNK_SIZE), format, buffer.data());
+			if (hash) {
+				AddToHash(hash, view::string_view(buffer.data(), length));
+			}
+
+			if (!writeSegments(file, {view::string_view(buffer.data(), length)}, error)) {
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+#ifdef Q_OS_UNIX
+/**
+ * Replaces the contents of an existing file with text, without ever leaving a
+ * partly written file behind: the text is written to a temporary file in the
+ * same directory, which is then renamed over the original. If backupName isn't
+ * empty, the original is kept under that name by making a hard link to it, or
+ * by renaming it when the file system has no hard links, instead of copying
+ * it. Only the file system is touched, so this can run on any thread.
+ *
+ * @brief ReplaceTextFile
+ * @param fileName
+ * @param backupName
+ * @param text
+ * @param format
+ * @param sync whether to wait for the text to reach the disk before the
+ * original is replaced
+ * @param error set to the reason when the file couldn't be replaced
+ * @param hash if given, is fed the characters as they are written
+ * @param codec if given, the format the file is compressed in
+ * @return
+ */
+bool ReplaceTextFile(const QString &fileName, const QString &backupName, view::string_view text, FileFormats format, bool sync, QString *error, QCryptographicHash *hash, const Codec *codec) {
+
+	const QByteArray name = QFile::encodeName(fileName);
+	const QFileInfo fi(fileName);
+
+	QT_STATBUF statbuf;
+	if (QT_STAT(name.constData(), &statbuf) != 0) {
+		*error = QString::fromLocal8Bit(strerror(errno));
+		return false;
+	}
+
+	QTemporaryFile file(QString::fromLatin1("%1/.%2.XXXXXX").arg(fi.absolutePath(), fi.fileName()));
+	if (!file.open()) {
+		*error = file.errorString();
+		return false;
+	}
+
+	if (!WriteTextFile(&file, text, view::string_view(), format, error, hash, codec)) {
+		return false;
+	}
+
+	// keep the permissions of the original, and its group if we may
+	if (::fchmod(file.handle(), statbuf.st_mode & 07777) != 0) {
+		*error = QString::fromLocal8Bit(strerror(errno));
+		return false;
+	}
+
+	if (::fchown(file.handle(), static_cast<uid_t>(-1), statbuf.st_gid) != 0) {
+		// not being in the group of the file isn't worth failing over
+	}
+
+	if (sync && ::fsync(file.handle()) != 0) {
+		*error = QString::fromLocal8Bit(strerror(errno));
+		return false;
+	}
+
+	if (!backupName.isEmpty()) {
+		const QByteArray backup = QFile::encodeName(backupName);
+		::unlink(backup.constData());
+
+		if (::link(name.constData(), backup.constData()) != 0 && ::rename(name.constData(), backup.constData()) != 0) {
+			*error = QString::fromLatin1("%1: %2").arg(backupName, QString::fromLocal8Bit(strerror(errno)));
+			return false;
+		}
+	}
+
+	if (::rename(QFile::encodeName(file.fileName()).constData(), name.constData()) != 0) {
+		*error = QString::fromLocal8Bit(strerror(errno));
+		return false;
+	}
+
+	file.setAutoRemove(false);
+
+	// the rename itself only lasts once the directory has been written too
+	if (sync) {
+		const int fd = QT_OPEN(QFile::encodeName(fi.absolutePath()).constData(), QT_OPEN_RDONLY);
+		if (fd >= 0) {
+			::fsync(fd);
+			QT_CLOSE(fd);
+		}
+	}
+
+	return true;
+}
+#endif
+
+/**
+ * @brief AddToHash
+ * @param hash
+ * @param text which, unlike what QCryptographicHash takes at once, may be
+ * larger than 2 GB
+ */
+void AddToHash(QCryptographicHash *hash, view::string_view text) {
+	for (size_t pos = 0; pos < text.size(); pos += HASH_CHUNK_SIZE) {
+		const view::string_view chunk = text.substr(pos, HASH_CHUNK_SIZE);
+		hash->addData(chunk.data(), static_cast<int>(chunk.size()));
+	}
+}
+
+/**
+ * @brief HashText
+ * @param text
+ * @return the hash of text, to compare with HashFile
+ */
+QByteArray HashText(view::string_view text) {
+	QCryptographicHash hash(ContentHashAlgorithm);
+	AddToHash(&hash, text);
+	return hash.result();
+}
+
+/**
+ * Reads the file a chunk at a time, rather than mapping it, so that a file
+ * which is cut short while it's being read can't bring the program down.
+ *
+ * @brief HashFile
+ * @param fileName
+ * @return the hash of the contents of the file, or a null array if it can't
+ * be read
+ */
+QByteArray HashFile(const QString &fileName) {
+
+	QFile file(fileName);
+	if (!file.open(QIODevice::ReadOnly | QIODevice::Unbuffered)) {
+		return QByteArray();
+	}
+
+	QCryptographicHash hash(ContentHashAlgorithm);
+	std::vector<char> buffer(HASH_CHUNK_SIZE);
+
+	for (;;) {
+		const qint64 n = file.read(buffer.data(), static_cast<qint64>(buffer.size()));
+		if (n < 0) {
+			return QByteArray();
+		}
+
+		if (n == 0) {
+			break;
+		}
+
+		hash.addData(buffer.data(), static_cast<int>(n));
+	}
+
+	return hash.result();
+}
+
 /*
 ** Converts a string (which may represent the entire contents of the file) from
 ** Unix to DOS format.
 */
 void ConvertToDos(std::string &text) {
 
-	// How long a string will we need?
-	size_t outLength = 0;
-	for (char ch : text) {
-		if (ch == '\n') {
-			outLength++;
-		}
-		outLength++;
+	// How long a string will we need? Exactly one more character for each line.
+	const size_t newlines = countCharacter(text.data(), text.size(), '\n');
+	if (newlines == 0) {
+		return;
 	}
 
-	std::string outString;
-	outString.reserve(outLength);
-	auto outPtr = std::back_inserter(outString);
-
-	for (char ch : text) {
-		if (ch == '\n') {
-			*outPtr++ = '\r';
-		}
-		*outPtr++ = ch;
-	}
+	std::string outString(text.size() + newlines, '\0');
+	insertReturns(text.data(), text.data() + text.size(), &outString[0]);
 
 	text = std::move(outString);
 }
@@ -181,7 +689,7 @@ void ConvertToDos(std::string &text) {
 ** from Unix to Macintosh format.
 */
 void ConvertToMac(std::string &text) {
-	std::replace(text.begin(), text.end(), '\n', '\r');
+	detail::replaceCharacter(&text[0], text.size(), '\n', '\r');
 }
 
 /**
@@ -189,7 +697,7 @@ void ConvertToMac(std::string &text) {
  * @param text
  */
 void ConvertFromMac(std::string &text) {
-	std::replace(text.begin(), text.end(), '\r', '\n');
+	detail::replaceCharacter(&text[0], text.size(), '\r', '\n');
 }
 
 /**
@@ -206,32 +714,59 @@ void ConvertFromDos(std::string &text) {
  * @param pendingCR
  */
 void ConvertFromDos(std::string &text, char *pendingCR) {
+	text.resize(detail::convertFromDos(&text[0], text.size(), pendingCR));
+}
+
+namespace detail {
+
+/*
+** Converts length characters of text from DOS to Unix format in place, as
+** described for ConvertFromDos, and returns the new length. The text is
+** moved a line at a time, and not at all before the first carriage return.
+*/
+size_t convertFromDos(char *text, size_t length, char *pendingCR) {
 
 	if (pendingCR) {
 		*pendingCR = '\0';
 	}
 
-	auto out = text.begin();
-	auto it  = text.begin();
-
-	while (it != text.end()) {
-		if (*it == '\r') {
-			auto next = std::next(it);
-			if (next != text.end()) {
-				if (*next == '\n') {
-					++it;
-				}
-			} else {
-				if (pendingCR) {
-					*pendingCR = *it;
-					break;
-				}
+	char *out       = text;
+	const char *in  = text;
+	const char *end = text + length;
+
+	while (in != end) {
+		const auto cr = static_cast<const char *>(std::memchr(in, '\r', static_cast<size_t>(end - in)));
+		if (!cr) {
+			out = (out == in) ? out + (end - in) : std::copy(in, end, out);
+			break;
+		}
+
+		out = (out == in) ? out + (cr - in) : std::copy(in, cr, out);
+		in  = cr;
+
+		if (in + 1 != end) {
+			if (in[1] == '\n') {
+				++in;
 			}
+		} else if (pendingCR) {
+			*pendingCR = *in;
+			break;
 		}
-		*out++ = *it++;
+
+		*out++ = *in++;
 	}
 
-	text.erase(out, text.end());
+	return static_cast<size_t>(out - text);
+}
+
+/*
+** Replaces every from in the first length characters of text with to,
+** 16 characters at a time where it can.
+*/
+void replaceCharacter(char *text, size_t length, char from, char to) {
+	copyReplacing(text, text, length, from, to);
+}
+
 }
 
 /*
@@ -276,3 +811,62 @@ QString ReadAnyTextFile(const QString &fileName, bool forceNL) {
 		return {};
 	}
 }
+
+/**
+ * Makes reading the part of a mapped file which is past its end, once it has
+ * been cut short, find zeros rather than bring the program down. A file which
+ * is mapped can't be cut short on Windows, so there is nothing to do there.
+ *
+ * @brief GuardMapping
+ * @param address the start of the mapping
+ * @param size its size in bytes
+ * @return false if too many mappings are guarded already, in which case the
+ * file shouldn't be left mapped
+ */
+bool GuardMapping(const void *address, int64_t size) {
+#ifdef Q_OS_UNIX
+	static const bool installed = installBusHandler();
+	if (!installed) {
+		return false;
+	}
+
+	const auto begin = reinterpret_cast<uintptr_t>(address);
+
+	// a slot's end is only set once it is claimed, and cleared before it is given back
+	for (GuardedMapping &mapping : guardedMappings) {
+		uintptr_t expected = 0;
+		if (mapping.begin.compare_exchange_strong(expected, begin)) {
+			mapping.end.store(begin + static_cast<uintptr_t>(size));
+			return true;
+		}
+	}
+
+	return false;
+#else
+	Q_UNUSED(address)
+	Q_UNUSED(size)
+	return true;
+#endif
+}
+
+/**
+ * Stops guarding a mapping, which has to happen before it is unmapped.
+ *
+ * @brief UnguardMapping
+ * @param address the start of the mapping, as given to GuardMapping
+ */
+void UnguardMapping(const void *address) {
+#ifdef Q_OS_UNIX
+	const auto begin = reinterpret_cast<uintptr_t>(address);
+
+	for (GuardedMapping &mapping : guardedMappings) {
+		if (mapping.begin.load() == begin) {
+			mapping.end.store(0);
+			mapping.begin.store(0);
+			return;
+		}
+	}
+#else
+	Q_UNUSED(address)
+#endif
+}
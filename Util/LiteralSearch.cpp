@@ -0,0 +1,214 @@
+
+#include "Util/LiteralSearch.h"
+#include <QtGlobal>
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LITERAL_SEARCH_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace {
+
+/*
+** The pattern being searched for. "folded" is false when the upper and lower
+** case versions are identical, in which case candidates can be verified with a
+** plain memcmp.
+*/
+struct Pattern {
+	const char *upper;
+	const char *lower;
+	size_t length;
+	bool folded;
+};
+
+Pattern makePattern(view::string_view upper, view::string_view lower) {
+	Q_ASSERT(upper.size() == lower.size());
+
+	Pattern pattern;
+	pattern.upper  = upper.data();
+	pattern.lower  = lower.data();
+	pattern.length = upper.size();
+	pattern.folded = !(upper == lower);
+	return pattern;
+}
+
+bool matchesAt(const char *p, const Pattern &pattern) {
+
+	if (!pattern.folded) {
+		return std::memcmp(p, pattern.upper, pattern.length) == 0;
+	}
+
+	for (size_t i = 0; i < pattern.length; ++i) {
+		if (p[i] != pattern.upper[i] && p[i] != pattern.lower[i]) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*
+** Cheap filter on the first and last character of the pattern, this rejects
+** almost every position before we bother comparing the whole pattern
+*/
+bool candidateAt(const char *p, const Pattern &pattern) {
+	const size_t n = pattern.length - 1;
+	return (p[0] == pattern.upper[0] || p[0] == pattern.lower[0]) && (p[n] == pattern.upper[n] || p[n] == pattern.lower[n]);
+}
+
+#if defined(LITERAL_SEARCH_SSE2)
+constexpr size_t BlockSize = 16;
+
+unsigned int lowestBit(unsigned int mask) {
+#if defined(_MSC_VER)
+	unsigned long index;
+	_BitScanForward(&index, mask);
+	return index;
+#else
+	return static_cast<unsigned int>(__builtin_ctz(mask));
+#endif
+}
+
+unsigned int highestBit(unsigned int mask) {
+#if defined(_MSC_VER)
+	unsigned long index;
+	_BitScanReverse(&index, mask);
+	return index;
+#else
+	return static_cast<unsigned int>(31 - __builtin_clz(mask));
+#endif
+}
+
+/*
+** Generic SIMD substring search: for 16 consecutive starting positions at
+** once, compare the text against the first and the last character of the
+** pattern (in either case). Only positions where both agree are verified in
+** full. Bit N of the result is set if position "p + N" is a candidate.
+**
+** The caller guarantees that the whole block, including the last character
+** of a match starting at "p + 15", lies within the text.
+*/
+unsigned int candidateMask(const char *p, const Pattern &pattern) {
+
+	const size_t n = pattern.length - 1;
+
+	const __m128i upperFirst = _mm_set1_epi8(pattern.upper[0]);
+	const __m128i lowerFirst = _mm_set1_epi8(pattern.lower[0]);
+	const __m128i upperLast  = _mm_set1_epi8(pattern.upper[n]);
+	const __m128i lowerLast  = _mm_set1_epi8(pattern.lower[n]);
+
+	const __m128i blockFirst = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+	const __m128i blockLast  = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + n));
+
+	const __m128i eqFirst = _mm_or_si128(_mm_cmpeq_epi8(blockFirst, upperFirst), _mm_cmpeq_epi8(blockFirst, lowerFirst));
+	const __m128i eqLast  = _mm_or_si128(_mm_cmpeq_epi8(blockLast, upperLast), _mm_cmpeq_epi8(blockLast, lowerLast));
+
+	return static_cast<unsigned int>(_mm_movemask_epi8(_mm_and_si128(eqFirst, eqLast)));
+}
+#endif
+
+/*
+** Clamps [first, last) to the starting positions at which a match would fit
+** in the text. Returns false if there are none.
+*/
+bool clampRange(view::string_view text, const Pattern &pattern, size_t *first, size_t *last) {
+
+	if (pattern.length == 0 || pattern.length > text.size()) {
+		return false;
+	}
+
+	*last = std::min(*last, text.size() - pattern.length + 1);
+	return *first < *last;
+}
+
+}
+
+/**
+ * @brief find_literal
+ * @param text
+ * @param upper
+ * @param lower
+ * @param first
+ * @param last
+ * @return the lowest position in [first, last) at which the pattern matches
+ */
+size_t find_literal(view::string_view text, view::string_view upper, view::string_view lower, size_t first, size_t last) {
+
+	const Pattern pattern = makePattern(upper, lower);
+	if (!clampRange(text, pattern, &first, &last)) {
+		return view::string_view::npos;
+	}
+
+	const char *const data = text.data();
+	size_t pos             = first;
+
+#if defined(LITERAL_SEARCH_SSE2)
+	for (; last - pos >= BlockSize; pos += BlockSize) {
+		unsigned int mask = candidateMask(data + pos, pattern);
+		while (mask) {
+			const size_t offset = pos + lowestBit(mask);
+			if (matchesAt(data + offset, pattern)) {
+				return offset;
+			}
+			mask &= mask - 1;
+		}
+	}
+#endif
+
+	for (; pos != last; ++pos) {
+		if (candidateAt(data + pos, pattern) && matchesAt(data + pos, pattern)) {
+			return pos;
+		}
+	}
+
+	return view::string_view::npos;
+}
+
+/**
+ * @brief rfind_literal
+ * @param text
+ * @param upper
+ * @param lower
+ * @param first
+ * @param last
+ * @return the highest position in [first, last) at which the pattern matches
+ */
+size_t rfind_literal(view::string_view text, view::string_view upper, view::string_view lower, size_t first, size_t last) {
+
+	const Pattern pattern = makePattern(upper, lower);
+	if (!clampRange(text, pattern, &first, &last)) {
+		return view::string_view::npos;
+	}
+
+	const char *const data = text.data();
+	size_t pos             = last;
+
+#if defined(LITERAL_SEARCH_SSE2)
+	for (; pos - first >= BlockSize; pos -= BlockSize) {
+		const size_t block = pos - BlockSize;
+		unsigned int mask  = candidateMask(data + block, pattern);
+		while (mask) {
+			const unsigned int bit = highestBit(mask);
+			if (matchesAt(data + block + bit, pattern)) {
+				return block + bit;
+			}
+			mask &= ~(1u << bit);
+		}
+	}
+#endif
+
+	while (pos != first) {
+		--pos;
+		if (candidateAt(data + pos, pattern) && matchesAt(data + pos, pattern)) {
+			return pos;
+		}
+	}
+
+	return view::string_view::npos;
+}
@@ -0,0 +1,55 @@
+
+#ifndef UTIL_CODEC_H_
+#define UTIL_CODEC_H_
+
+#include "Util/string_view.h"
+#include <QString>
+#include <memory>
+#include <string>
+
+/*
+** Streams which decompress or compress data a piece at a time. Whatever comes
+** out of a piece is appended to output, so that the caller decides how much
+** of it to hold on to. They return false, with the reason in error, when the
+** data can't be processed.
+*/
+class Decompressor {
+public:
+	virtual ~Decompressor() = default;
+
+public:
+	virtual bool decompress(view::string_view input, std::string *output, QString *error) = 0;
+	virtual bool finish(QString *error) = 0; // fails if the data was cut short
+};
+
+class Compressor {
+public:
+	virtual ~Compressor() = default;
+
+public:
+	virtual bool compress(view::string_view input, std::string *output, QString *error) = 0;
+	virtual bool finish(std::string *output, QString *error) = 0;
+};
+
+/*
+** A compressed file format which files can be read from and written in.
+** Formats are recognized by the first few bytes of a file, and the ones
+** available depend on the libraries NEdit-ng was built with. To add one,
+** add a Codec for it to the list in Codec.cpp.
+*/
+struct Codec {
+	const char *name;   // as shown to the user
+	const char *suffix; // the extension files in the format are usually given
+	const char *magic;  // what every file in the format starts with
+	size_t magicLength;
+	std::unique_ptr<Decompressor> (*createDecompressor)();
+	std::unique_ptr<Compressor> (*createCompressor)();
+};
+
+const Codec *CodecForData(view::string_view header);
+const Codec *CodecForFile(const QString &fileName);
+const Codec *CodecForFileName(const QString &fileName);
+const Codec *DefaultCodec();
+bool Decompress(const Codec *codec, view::string_view input, std::string *output, QString *error);
+
+#endif
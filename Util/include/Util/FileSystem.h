@@ -3,12 +3,20 @@
 #define UTIL_FILESYSTEM_H_
 
 #include "string_view.h"
+#include <QByteArray>
+#include <QCryptographicHash>
 #include <QString>
 #include <QtGlobal>
 #include <boost/optional.hpp>
+#include <cstdint>
 #include <string>
 
 enum class FileFormats : int;
+class QFile;
+struct Codec;
+
+// the hash kept of the contents of a file, to tell whether it has really changed
+constexpr QCryptographicHash::Algorithm ContentHashAlgorithm = QCryptographicHash::Md5;
 
 struct PathInfo {
 	QString pathname;
@@ -20,6 +28,18 @@ QString GetTrailingPathComponents(const QString &path, int components);
 QString NormalizePathname(const QString &pathname);
 QString ReadAnyTextFile(const QString &fileName, bool forceNL);
 PathInfo parseFilename(const QString &fullname);
+QByteArray HashFile(const QString &fileName);
+QByteArray HashText(view::string_view text);
+void AddToHash(QCryptographicHash *hash, view::string_view text);
+bool WriteTextFile(QFile *file, view::string_view first, view::string_view second, FileFormats format, QString *error, QCryptographicHash *hash = nullptr, const Codec *codec = nullptr);
+
+// mapped files which may be cut short while they are in use
+bool GuardMapping(const void *address, int64_t size);
+void UnguardMapping(const void *address);
+
+#ifdef Q_OS_UNIX
+bool ReplaceTextFile(const QString &fileName, const QString &backupName, view::string_view text, FileFormats format, bool sync, QString *error, QCryptographicHash *hash = nullptr, const Codec *codec = nullptr);
+#endif
 
 // std::string based convesions
 void ConvertToMac(std::string &text);
@@ -28,6 +48,11 @@ void ConvertFromMac(std::string &text);
 void ConvertFromDos(std::string &text);
 void ConvertFromDos(std::string &text, char *pendingCR);
 
+namespace detail {
+size_t convertFromDos(char *text, size_t length, char *pendingCR);
+void replaceCharacter(char *text, size_t length, char from, char to);
+}
+
 template <class Integer>
 using IsInteger = typename std::enable_if<std::is_integral<Integer>::value>::type;
 
@@ -46,7 +71,7 @@ template <class Length, class = IsInteger<Length>>
 void ConvertFromMac(char *text, Length length) {
 
 	Q_ASSERT(text);
-	std::replace(text, text + length, '\r', '\n');
+	detail::replaceCharacter(text, static_cast<size_t>(length), '\r', '\n');
 }
 
 /**
@@ -59,31 +84,7 @@ template <class Length, class = IsInteger<Length>>
 void ConvertFromDos(char *text, Length *length, char *pendingCR) {
 
 	Q_ASSERT(text);
-	char *out       = text;
-	const char *in  = text;
-	const char *end = text + *length;
-
-	if (pendingCR) {
-		*pendingCR = '\0';
-	}
-
-	while (in < end) {
-		if (*in == '\r') {
-			if (in < end - 1) {
-				if (in[1] == '\n') {
-					++in;
-				}
-			} else {
-				if (pendingCR) {
-					*pendingCR = *in;
-					break;
-				}
-			}
-		}
-		*out++ = *in++;
-	}
-
-	*length = static_cast<Length>(out - text);
+	*length = static_cast<Length>(detail::convertFromDos(text, static_cast<size_t>(*length), pendingCR));
 }
 
 #endif
@@ -0,0 +1,19 @@
+
+#ifndef LITERAL_SEARCH_H_
+#define LITERAL_SEARCH_H_
+
+#include "Util/string_view.h"
+
+/*
+** Literal substring search used by the find/replace code. The pattern is given
+** as an upper and a lower case version of the same length, a character of the
+** text matches if it is equal to the corresponding character of either one, so
+** passing the same string twice gives a case sensitive search.
+**
+** Only matches which start in [first, last) and fit entirely in the text are
+** reported. Both return view::string_view::npos if there is no match.
+*/
+size_t find_literal(view::string_view text, view::string_view upper, view::string_view lower, size_t first, size_t last);
+size_t rfind_literal(view::string_view text, view::string_view upper, view::string_view lower, size_t first, size_t last);
+
+#endif
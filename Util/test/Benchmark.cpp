@@ -0,0 +1,180 @@
+
+#include "Util/LiteralSearch.h"
+#include "Util/String.h"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+
+namespace {
+
+/*
+** The character by character search which find_literal replaced, kept here
+** as a reference for both the results and the timings
+*/
+size_t reference_find(view::string_view text, view::string_view upper, view::string_view lower, size_t first, size_t last) {
+
+	for (size_t pos = first; pos < last && pos + upper.size() <= text.size(); ++pos) {
+		size_t i = 0;
+		while (i < upper.size() && (text[pos + i] == upper[i] || text[pos + i] == lower[i])) {
+			++i;
+		}
+
+		if (i == upper.size()) {
+			return pos;
+		}
+	}
+
+	return view::string_view::npos;
+}
+
+size_t reference_rfind(view::string_view text, view::string_view upper, view::string_view lower, size_t first, size_t last) {
+
+	for (size_t pos = last; pos-- > first;) {
+		if (pos + upper.size() > text.size()) {
+			continue;
+		}
+
+		size_t i = 0;
+		while (i < upper.size() && (text[pos + i] == upper[i] || text[pos + i] == lower[i])) {
+			++i;
+		}
+
+		if (i == upper.size()) {
+			return pos;
+		}
+	}
+
+	return view::string_view::npos;
+}
+
+/*
+** Something that looks like a log file, so that the first character of the
+** search string occurs frequently
+*/
+std::string make_text(size_t size) {
+
+	static const char *const words[] = {
+		"INFO", "WARN", "debug", "request", "response", "handler", "connection",
+		"timeout", "user", "session", "0x7ffd", "retrying", "in", "ms", "=", ":",
+	};
+
+	std::mt19937 rng(42);
+	std::uniform_int_distribution<size_t> dist(0, (sizeof(words) / sizeof(words[0])) - 1);
+
+	std::string text;
+	text.reserve(size + 64);
+
+	while (text.size() < size) {
+		for (int i = 0; i < 12; ++i) {
+			text.append(words[dist(rng)]);
+			text.push_back(' ');
+		}
+		text.push_back('\n');
+	}
+
+	text.resize(size);
+	return text;
+}
+
+template <class F>
+size_t time_search(const char *name, size_t bytes, F func) {
+
+	const auto start  = std::chrono::steady_clock::now();
+	const size_t pos  = func();
+	const auto finish = std::chrono::steady_clock::now();
+
+	const double seconds = std::chrono::duration<double>(finish - start).count();
+	std::cout << "  " << name << ": " << (seconds * 1000.0) << " ms (" << (static_cast<double>(bytes) / (1024.0 * 1024.0) / seconds) << " MB/s)\n";
+	return pos;
+}
+
+}
+
+int main(int argc, char *argv[]) {
+
+	size_t megabytes = 256;
+	if (argc > 1) {
+		megabytes = std::strtoul(argv[1], nullptr, 10);
+	}
+
+	std::string text = make_text(megabytes * 1024 * 1024);
+
+	// plant the needle near the end for the forward searches and near the
+	// start for the backward ones, so that nearly the whole text is scanned
+	const std::string needle = "ReSpOnSe handler timed out";
+	text.replace(text.size() - 100, needle.size(), needle);
+	text.replace(100, needle.size(), needle);
+
+	const view::string_view haystack = text;
+
+	struct Case {
+		const char *name;
+		std::string upper;
+		std::string lower;
+	};
+
+	const Case cases[] = {
+		{"case sensitive", needle, needle},
+		{"case insensitive", to_upper(needle), to_lower(needle)},
+	};
+
+	for (const Case &c : cases) {
+		std::cout << c.name << " forward, " << megabytes << " MB\n";
+
+		const size_t expected = time_search("reference", text.size(), [&]() {
+			return reference_find(haystack, c.upper, c.lower, 200, text.size());
+		});
+
+		const size_t actual = time_search("find_literal", text.size(), [&]() {
+			return find_literal(haystack, c.upper, c.lower, 200, text.size());
+		});
+
+		if (expected != actual || actual == view::string_view::npos) {
+			std::cerr << "ERROR    : find_literal returned " << actual << ", expected " << expected << std::endl;
+			return -1;
+		}
+
+		std::cout << c.name << " backward, " << megabytes << " MB\n";
+
+		const size_t rexpected = time_search("reference", text.size(), [&]() {
+			return reference_rfind(haystack, c.upper, c.lower, 0, text.size() - 200);
+		});
+
+		const size_t ractual = time_search("rfind_literal", text.size(), [&]() {
+			return rfind_literal(haystack, c.upper, c.lower, 0, text.size() - 200);
+		});
+
+		if (rexpected != ractual || ractual == view::string_view::npos) {
+			std::cerr << "ERROR    : rfind_literal returned " << ractual << ", expected " << rexpected << std::endl;
+			return -1;
+		}
+	}
+
+	// exhaustively check the edges of the range handling on short strings,
+	// these exercise the scalar tails as well as the vectorized blocks
+	const std::string small = "abcabcABCaBcabc-abcab";
+	for (size_t length = 1; length <= 4; ++length) {
+		for (size_t offset = 0; offset + length <= small.size(); ++offset) {
+			const std::string upper = to_upper(small.substr(offset, length));
+			const std::string lower = to_lower(small.substr(offset, length));
+
+			for (size_t first = 0; first <= small.size(); ++first) {
+				for (size_t last = first; last <= small.size() + 1; ++last) {
+					if (find_literal(small, upper, lower, first, last) != reference_find(small, upper, lower, first, last)) {
+						std::cerr << "ERROR    : find_literal mismatch on \"" << upper << "\" [" << first << ", " << last << ")" << std::endl;
+						return -1;
+					}
+
+					if (rfind_literal(small, upper, lower, first, last) != reference_rfind(small, upper, lower, first, last)) {
+						std::cerr << "ERROR    : rfind_literal mismatch on \"" << upper << "\" [" << first << ", " << last << ")" << std::endl;
+						return -1;
+					}
+				}
+			}
+		}
+	}
+
+	std::cout << "SUCCESS\n";
+}
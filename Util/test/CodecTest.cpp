@@ -0,0 +1,175 @@
+#include "Util/Codec.h"
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+// the size of the pieces Codec.cpp grows its output by, the interesting sizes
+// are the ones which end exactly where a piece fills up
+constexpr size_t OutputChunkSize = 256 * 1024;
+
+/*
+** Something which compresses about as well as text usually does
+*/
+std::string make_text(size_t size, unsigned int seed) {
+
+	static const char *const words[] = {
+		"INFO", "WARN", "debug", "request", "response", "handler", "connection",
+		"timeout", "user", "session", "0x7ffd", "retrying", "in", "ms", "=", ":",
+	};
+
+	std::mt19937 rng(seed);
+	std::uniform_int_distribution<size_t> dist(0, (sizeof(words) / sizeof(words[0])) - 1);
+	std::uniform_int_distribution<int> number(0, 99999);
+
+	std::string text;
+	text.reserve(size + 256);
+
+	while (text.size() < size) {
+		text.append(words[dist(rng)]);
+		text.push_back(' ');
+		text.append(std::to_string(number(rng)));
+		text.push_back((number(rng) % 8) == 0 ? '\n' : ' ');
+	}
+
+	text.resize(size);
+	return text;
+}
+
+bool compress(const Codec *codec, const std::string &text, std::string *output) {
+
+	std::unique_ptr<Compressor> compressor = codec->createCompressor();
+
+	QString error;
+	if (!compressor->compress(text, output, &error) || !compressor->finish(output, &error)) {
+		std::cerr << "ERROR    : " << codec->name << " compression failed: " << error.toStdString() << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+/*
+** Decompresses the data both in one go and a piece at a time, the way files
+** are read, and checks that both come back to the expected text
+*/
+bool check(const Codec *codec, const std::string &data, const std::string &expected, const char *what) {
+
+	std::string text;
+	QString error;
+	if (!Decompress(codec, data, &text, &error)) {
+		std::cerr << "ERROR    : " << codec->name << " " << what << ": " << error.toStdString() << std::endl;
+		return false;
+	}
+
+	if (text != expected) {
+		std::cerr << "ERROR    : " << codec->name << " " << what << ": decompressed to " << text.size() << " characters instead of " << expected.size() << std::endl;
+		return false;
+	}
+
+	for (size_t pieceSize : {size_t(1000), size_t(64 * 1024)}) {
+		std::unique_ptr<Decompressor> decompressor = codec->createDecompressor();
+
+		std::string pieces;
+		for (size_t pos = 0; pos < data.size(); pos += pieceSize) {
+			if (!decompressor->decompress(view::string_view(data).substr(pos, pieceSize), &pieces, &error)) {
+				break;
+			}
+		}
+
+		if (!error.isEmpty() || !decompressor->finish(&error) || pieces != expected) {
+			std::cerr << "ERROR    : " << codec->name << " " << what << ", in pieces of " << pieceSize << ": " << error.toStdString() << std::endl;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+}
+
+int main() {
+
+	const std::vector<size_t> sizes = {
+		0,
+		1,
+		OutputChunkSize - 1,
+		OutputChunkSize,
+		OutputChunkSize + 1,
+		2 * OutputChunkSize,
+		3 * OutputChunkSize,
+	};
+
+	int tested = 0;
+
+	for (const char *fileName : {"test.gz", "test.zst"}) {
+		const Codec *codec = CodecForFileName(QString::fromLatin1(fileName));
+		if (!codec) {
+			std::cout << "not built with support for " << fileName << ", skipped\n";
+			continue;
+		}
+
+		++tested;
+
+		for (size_t size : sizes) {
+			const std::string text = make_text(size, static_cast<unsigned int>(size));
+
+			std::string data;
+			if (!compress(codec, text, &data)) {
+				return -1;
+			}
+
+			if (CodecForData(data) != codec) {
+				std::cerr << "ERROR    : " << codec->name << " data isn't recognized" << std::endl;
+				return -1;
+			}
+
+			const std::string what = "round trip of " + std::to_string(size);
+			if (!check(codec, data, text, what.c_str())) {
+				return -1;
+			}
+		}
+
+		// several streams one after the other, with the joins falling at the
+		// end of a piece of output as well as elsewhere
+		for (size_t first : sizes) {
+			const std::string text1 = make_text(first, 1);
+			const std::string text2 = make_text(OutputChunkSize, 2);
+			const std::string text3 = make_text(12345, 3);
+
+			std::string data;
+			if (!compress(codec, text1, &data) || !compress(codec, text2, &data) || !compress(codec, text3, &data)) {
+				return -1;
+			}
+
+			const std::string what = "concatenation after " + std::to_string(first);
+			if (!check(codec, data, text1 + text2 + text3, what.c_str())) {
+				return -1;
+			}
+		}
+
+		// data which is cut short has to be noticed
+		std::string data;
+		if (!compress(codec, make_text(OutputChunkSize, 4), &data)) {
+			return -1;
+		}
+
+		std::string text;
+		QString error;
+		if (Decompress(codec, view::string_view(data).substr(0, data.size() / 2), &text, &error)) {
+			std::cerr << "ERROR    : " << codec->name << " truncated data wasn't noticed" << std::endl;
+			return -1;
+		}
+
+		std::cout << codec->name << ": OK\n";
+	}
+
+	if (tested == 0) {
+		std::cout << "no compressed formats to test\n";
+	}
+
+	std::cout << "SUCCESS\n";
+}
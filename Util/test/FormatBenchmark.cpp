@@ -0,0 +1,258 @@
+#include "Util/FileFormats.h"
+#include "Util/FileSystem.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <string>
+
+namespace {
+
+/*
+** The character by character conversions which the block at a time ones
+** replaced, kept here as a reference for both the results and the timings
+*/
+FileFormats reference_format(view::string_view text) {
+
+	size_t nNewlines = 0;
+	size_t nReturns  = 0;
+
+	const auto end = std::min(text.end(), text.begin() + 2000);
+
+	for (auto it = text.begin(); it != end; ++it) {
+		if (*it == '\n') {
+			nNewlines++;
+			if (it == text.begin() || *std::prev(it) != '\r') {
+				return FileFormats::Unix;
+			}
+
+			if (nNewlines >= 5) {
+				return FileFormats::Dos;
+			}
+		} else if (*it == '\r') {
+			nReturns++;
+		}
+	}
+
+	if (nNewlines > 0) {
+		return FileFormats::Dos;
+	}
+
+	if (nReturns > 0) {
+		return FileFormats::Mac;
+	}
+
+	return FileFormats::Unix;
+}
+
+void reference_from_dos(std::string &text, char *pendingCR) {
+
+	if (pendingCR) {
+		*pendingCR = '\0';
+	}
+
+	auto out = text.begin();
+	auto it  = text.begin();
+
+	while (it != text.end()) {
+		if (*it == '\r') {
+			auto next = std::next(it);
+			if (next != text.end()) {
+				if (*next == '\n') {
+					++it;
+				}
+			} else {
+				if (pendingCR) {
+					*pendingCR = *it;
+					break;
+				}
+			}
+		}
+		*out++ = *it++;
+	}
+
+	text.erase(out, text.end());
+}
+
+void reference_to_dos(std::string &text) {
+
+	std::string outString;
+	for (char ch : text) {
+		if (ch == '\n') {
+			outString.push_back('\r');
+		}
+		outString.push_back(ch);
+	}
+
+	text = std::move(outString);
+}
+
+/*
+** Something that looks like a log file, with lines of varying length
+*/
+std::string make_text(size_t size) {
+
+	static const char *const words[] = {
+		"INFO", "WARN", "debug", "request", "response", "handler", "connection",
+		"timeout", "user", "session", "0x7ffd", "retrying", "in", "ms", "=", ":",
+	};
+
+	std::mt19937 rng(42);
+	std::uniform_int_distribution<size_t> dist(0, (sizeof(words) / sizeof(words[0])) - 1);
+	std::uniform_int_distribution<int> length(1, 20);
+
+	std::string text;
+	text.reserve(size + 256);
+
+	while (text.size() < size) {
+		for (int i = length(rng); i > 0; --i) {
+			text.append(words[dist(rng)]);
+			text.push_back(' ');
+		}
+		text.push_back('\n');
+	}
+
+	text.resize(size);
+	return text;
+}
+
+template <class F>
+void time_conversion(const char *name, size_t bytes, F func) {
+
+	const auto start  = std::chrono::steady_clock::now();
+	func();
+	const auto finish = std::chrono::steady_clock::now();
+
+	const double seconds = std::chrono::duration<double>(finish - start).count();
+	std::cout << "  " << name << ": " << (seconds * 1000.0) << " ms (" << (static_cast<double>(bytes) / (1024.0 * 1024.0) / seconds) << " MB/s)\n";
+}
+
+bool check(bool ok, const char *what, const std::string &text) {
+	if (!ok) {
+		std::string shown;
+		for (char ch : text) {
+			shown += (ch == '\r') ? "\\r" : (ch == '\n') ? "\\n" : std::string(1, ch);
+		}
+		std::cerr << "ERROR    : " << what << " mismatch on \"" << shown << "\"" << std::endl;
+	}
+	return ok;
+}
+
+}
+
+int main(int argc, char *argv[]) {
+
+	size_t megabytes = 256;
+	if (argc > 1) {
+		megabytes = std::strtoul(argv[1], nullptr, 10);
+	}
+
+	const std::string unixText = make_text(megabytes * 1024 * 1024);
+
+	std::cout << "to DOS, " << megabytes << " MB\n";
+
+	std::string expectedDos = unixText;
+	time_conversion("reference", unixText.size(), [&]() {
+		reference_to_dos(expectedDos);
+	});
+
+	std::string dos = unixText;
+	time_conversion("ConvertToDos", unixText.size(), [&]() {
+		ConvertToDos(dos);
+	});
+
+	if (dos != expectedDos) {
+		std::cerr << "ERROR    : ConvertToDos differs from the reference" << std::endl;
+		return -1;
+	}
+
+	std::cout << "from DOS, " << megabytes << " MB\n";
+
+	std::string expectedUnix = dos;
+	time_conversion("reference", dos.size(), [&]() {
+		reference_from_dos(expectedUnix, nullptr);
+	});
+
+	std::string converted = dos;
+	time_conversion("ConvertFromDos", dos.size(), [&]() {
+		ConvertFromDos(converted);
+	});
+
+	if (converted != expectedUnix || converted != unixText) {
+		std::cerr << "ERROR    : ConvertFromDos differs from the reference" << std::endl;
+		return -1;
+	}
+
+	std::cout << "to and from Macintosh, " << megabytes << " MB\n";
+
+	std::string expectedMac = unixText;
+	time_conversion("reference", unixText.size(), [&]() {
+		std::replace(expectedMac.begin(), expectedMac.end(), '\n', '\r');
+	});
+
+	std::string mac = unixText;
+	time_conversion("ConvertToMac", unixText.size(), [&]() {
+		ConvertToMac(mac);
+	});
+
+	converted = mac;
+	time_conversion("ConvertFromMac", unixText.size(), [&]() {
+		ConvertFromMac(converted);
+	});
+
+	if (mac != expectedMac || converted != unixText) {
+		std::cerr << "ERROR    : the Macintosh conversions differ from the reference" << std::endl;
+		return -1;
+	}
+
+	// exhaustively check every short mix of line breaks and other characters,
+	// these exercise the scalar tails as well as the vectorized blocks
+	const char alphabet[] = {'a', '\r', '\n'};
+	for (size_t length = 0; length <= 8; ++length) {
+		size_t combinations = 1;
+		for (size_t i = 0; i < length; ++i) {
+			combinations *= 3;
+		}
+
+		for (size_t n = 0; n < combinations; ++n) {
+			std::string text;
+			for (size_t i = 0, rest = n; i < length; ++i, rest /= 3) {
+				text.push_back(alphabet[rest % 3]);
+			}
+
+			// and at an offset which puts the interesting part across the end of a block
+			for (const std::string &sample : {text, std::string(13, 'x') + text}) {
+				if (!check(FormatOfFile(sample) == reference_format(sample), "FormatOfFile", sample)) {
+					return -1;
+				}
+
+				for (bool pending : {false, true}) {
+					std::string expected = sample;
+					std::string actual   = sample;
+					char expectedCR      = 'x';
+					char actualCR        = 'y';
+
+					reference_from_dos(expected, pending ? &expectedCR : nullptr);
+					ConvertFromDos(actual, pending ? &actualCR : nullptr);
+
+					if (!check(actual == expected && (!pending || actualCR == expectedCR), "ConvertFromDos", sample)) {
+						return -1;
+					}
+				}
+
+				std::string expected = sample;
+				std::string actual   = sample;
+				reference_to_dos(expected);
+				ConvertToDos(actual);
+
+				if (!check(actual == expected, "ConvertToDos", sample)) {
+					return -1;
+				}
+			}
+		}
+	}
+
+	std::cout << "SUCCESS\n";
+}
@@ -522,6 +522,12 @@ int main(int argc, char *argv[]) {
 	Settings::focusOnRaise                 = false;
 	Settings::forceOSConversion            = true;
 	Settings::honorSymlinks                = true;
+	Settings::backgroundSave               = false;
+	Settings::syncOnSave                   = true;
+	Settings::recompressOnSave             = true;
+	Settings::deferredOpen                 = false;
+	Settings::prefetchDeferred             = false;
+	Settings::documentMemoryLimit          = 0;
 	Settings::stickyCaseSenseButton        = true;
 	Settings::typingHidesPointer           = false;
 	Settings::undoModifiesSelection        = true;
@@ -0,0 +1,256 @@
+
+#include "DialogFindInFiles.h"
+#include "DocumentWidget.h"
+#include "FileSearch.h"
+#include "MainWindow.h"
+#include "Regex.h"
+#include "Util/regex.h"
+
+#include <QDir>
+#include <QFileDialog>
+#include <QFileInfo>
+#include <QMessageBox>
+#include <QTimer>
+
+#include <algorithm>
+
+namespace {
+
+// how often (msec) the matches found so far are added to the list
+constexpr int UpdateInterval = 100;
+
+// stop looking once there are more matches than anyone could go through
+constexpr int64_t MaxResults = 100000;
+
+constexpr int PathRole = Qt::UserRole;
+constexpr int LineRole = Qt::UserRole + 1;
+
+}
+
+/**
+ * @brief DialogFindInFiles::DialogFindInFiles
+ * @param window
+ * @param f
+ */
+DialogFindInFiles::DialogFindInFiles(MainWindow *window, Qt::WindowFlags f)
+	: Dialog(window, f), window_(window) {
+	ui.setupUi(this);
+
+	updateTimer_ = new QTimer(this);
+	updateTimer_->setInterval(UpdateInterval);
+
+	connectSlots();
+}
+
+/**
+ * @brief DialogFindInFiles::~DialogFindInFiles
+ */
+DialogFindInFiles::~DialogFindInFiles() = default;
+
+/**
+ * @brief DialogFindInFiles::connectSlots
+ */
+void DialogFindInFiles::connectSlots() {
+	connect(ui.buttonBrowse, &QPushButton::clicked, this, &DialogFindInFiles::buttonBrowse_clicked);
+	connect(ui.buttonFind, &QPushButton::clicked, this, &DialogFindInFiles::buttonFind_clicked);
+	connect(ui.buttonStop, &QPushButton::clicked, this, &DialogFindInFiles::buttonStop_clicked);
+	connect(ui.checkRegex, &QCheckBox::toggled, this, &DialogFindInFiles::checkRegex_toggled);
+	connect(ui.listResults, &QListWidget::itemActivated, this, &DialogFindInFiles::listResults_itemActivated);
+	connect(updateTimer_, &QTimer::timeout, this, &DialogFindInFiles::updateResults);
+}
+
+/**
+ * @brief DialogFindInFiles::showEvent
+ * @param event
+ */
+void DialogFindInFiles::showEvent(QShowEvent *event) {
+	Dialog::showEvent(event);
+	ui.textFind->setFocus();
+}
+
+/**
+ * @brief DialogFindInFiles::hideEvent
+ * @param event
+ */
+void DialogFindInFiles::hideEvent(QHideEvent *event) {
+	stopSearch();
+	Dialog::hideEvent(event);
+}
+
+/**
+ * @brief DialogFindInFiles::setDirectory
+ * @param directory
+ */
+void DialogFindInFiles::setDirectory(const QString &directory) {
+	if (ui.textDirectory->text().isEmpty()) {
+		ui.textDirectory->setText(QDir::toNativeSeparators(directory));
+	}
+}
+
+/**
+ * @brief DialogFindInFiles::checkRegex_toggled
+ * @param checked
+ */
+void DialogFindInFiles::checkRegex_toggled(bool checked) {
+	// regular expressions have their own way of matching whole words
+	ui.checkWord->setEnabled(!checked);
+}
+
+/**
+ * @brief DialogFindInFiles::searchType
+ * @return
+ */
+SearchType DialogFindInFiles::searchType() const {
+
+	if (ui.checkRegex->isChecked()) {
+		return ui.checkCase->isChecked() ? SearchType::Regex : SearchType::RegexNoCase;
+	}
+
+	if (ui.checkCase->isChecked()) {
+		return ui.checkWord->isChecked() ? SearchType::CaseSenseWord : SearchType::CaseSense;
+	}
+
+	return ui.checkWord->isChecked() ? SearchType::LiteralWord : SearchType::Literal;
+}
+
+/**
+ * @brief DialogFindInFiles::buttonBrowse_clicked
+ */
+void DialogFindInFiles::buttonBrowse_clicked() {
+
+	const QString directory = QFileDialog::getExistingDirectory(this, tr("Directory to Search"), ui.textDirectory->text());
+	if (!directory.isEmpty()) {
+		ui.textDirectory->setText(QDir::toNativeSeparators(directory));
+	}
+}
+
+/**
+ * @brief DialogFindInFiles::buttonFind_clicked
+ */
+void DialogFindInFiles::buttonFind_clicked() {
+
+	const QString searchString = ui.textFind->text();
+	if (searchString.isEmpty()) {
+		QApplication::beep();
+		return;
+	}
+
+	const QString directory = QDir::fromNativeSeparators(ui.textDirectory->text());
+	if (!QFileInfo(directory).isDir()) {
+		QMessageBox::warning(this, tr("Find in Files"), tr("%1 is not a directory").arg(ui.textDirectory->text()));
+		return;
+	}
+
+	const SearchType type = searchType();
+
+	// check the regular expression up front rather than once for every file
+	if (type == SearchType::Regex || type == SearchType::RegexNoCase) {
+		try {
+			auto compiledRE = make_regex(searchString, type == SearchType::Regex ? REDFLT_STANDARD : REDFLT_CASE_INSENSITIVE);
+		} catch (const RegexError &e) {
+			QMessageBox::warning(
+				this,
+				tr("Regex Error"),
+				tr("Please respecify the search string:\n%1").arg(QString::fromLatin1(e.what())));
+			return;
+		}
+	}
+
+	stopSearch();
+
+	ui.listResults->clear();
+
+	const QStringList nameFilters = ui.textFilter->text().split(QLatin1Char(' '), QString::SkipEmptyParts);
+
+	search_ = std::make_unique<FileSearch>(directory, nameFilters, searchString, type);
+	search_->start();
+
+	elapsed_.start();
+	updateTimer_->start();
+
+	ui.buttonFind->setEnabled(false);
+	ui.buttonStop->setEnabled(true);
+}
+
+/**
+ * @brief DialogFindInFiles::buttonStop_clicked
+ */
+void DialogFindInFiles::buttonStop_clicked() {
+	if (search_) {
+		search_->cancel();
+	}
+}
+
+/**
+ * @brief DialogFindInFiles::stopSearch
+ */
+void DialogFindInFiles::stopSearch() {
+
+	if (search_) {
+		// destroying the search waits for the files being searched right now
+		search_->cancel();
+		search_ = nullptr;
+
+		updateTimer_->stop();
+		ui.buttonFind->setEnabled(true);
+		ui.buttonStop->setEnabled(false);
+	}
+}
+
+/**
+ * @brief DialogFindInFiles::updateResults
+ */
+void DialogFindInFiles::updateResults() {
+
+	if (!search_) {
+		return;
+	}
+
+	// look at this first, so that no matches found after it can be missed
+	const bool finished = search_->isFinished();
+
+	for (const FileSearch::Match &match : search_->takeMatches()) {
+		auto item = new QListWidgetItem(tr("%1:%2: %3").arg(QDir::toNativeSeparators(match.path), QString::number(match.line), match.text), ui.listResults);
+		item->setData(PathRole, match.path);
+		item->setData(LineRole, static_cast<qlonglong>(match.line));
+	}
+
+	const FileSearch::Statistics stats = search_->statistics();
+	const double seconds               = std::max(elapsed_.elapsed(), qint64(1)) / 1000.0;
+	const double megabytes             = static_cast<double>(stats.bytes) / (1024.0 * 1024.0);
+
+	ui.labelStatus->setText(tr("%1 matches in %2 files, %3 MB (%4 files/s, %5 MB/s)")
+								.arg(stats.matches)
+								.arg(stats.files)
+								.arg(megabytes, 0, 'f', 1)
+								.arg(static_cast<double>(stats.files) / seconds, 0, 'f', 0)
+								.arg(megabytes / seconds, 0, 'f', 1));
+
+	if (stats.matches >= MaxResults) {
+		search_->cancel();
+	}
+
+	if (finished) {
+		updateTimer_->stop();
+		search_ = nullptr;
+
+		ui.buttonFind->setEnabled(true);
+		ui.buttonStop->setEnabled(false);
+	}
+}
+
+/**
+ * @brief DialogFindInFiles::listResults_itemActivated
+ * @param item
+ */
+void DialogFindInFiles::listResults_itemActivated(QListWidgetItem *item) {
+
+	DocumentWidget *current = window_->currentDocument();
+	if (!current) {
+		return;
+	}
+
+	if (DocumentWidget *document = current->open(item->data(PathRole).toString())) {
+		document->selectNumberedLine(document->firstPane(), item->data(LineRole).toLongLong());
+	}
+}
@@ -0,0 +1,53 @@
+
+#ifndef DIALOG_FIND_IN_FILES_H_
+#define DIALOG_FIND_IN_FILES_H_
+
+#include "Dialog.h"
+#include "SearchType.h"
+
+#include "ui_DialogFindInFiles.h"
+
+#include <QElapsedTimer>
+
+#include <memory>
+
+class DocumentWidget;
+class FileSearch;
+class MainWindow;
+class QListWidgetItem;
+class QTimer;
+
+class DialogFindInFiles final : public Dialog {
+	Q_OBJECT
+
+public:
+	DialogFindInFiles(MainWindow *window, Qt::WindowFlags f = Qt::WindowFlags());
+	~DialogFindInFiles() override;
+
+protected:
+	void hideEvent(QHideEvent *event) override;
+	void showEvent(QShowEvent *event) override;
+
+public:
+	void setDirectory(const QString &directory);
+
+private:
+	SearchType searchType() const;
+	void buttonBrowse_clicked();
+	void buttonFind_clicked();
+	void buttonStop_clicked();
+	void checkRegex_toggled(bool checked);
+	void connectSlots();
+	void listResults_itemActivated(QListWidgetItem *item);
+	void stopSearch();
+	void updateResults();
+
+private:
+	Ui::DialogFindInFiles ui;
+	MainWindow *window_;
+	QTimer *updateTimer_;
+	QElapsedTimer elapsed_;
+	std::unique_ptr<FileSearch> search_;
+};
+
+#endif
@@ -8,6 +8,7 @@
 #include "MenuItemModel.h"
 #include "Preferences.h"
 #include "Util/String.h"
+#include "macro.h"
 #include "parse.h"
 #include "userCmds.h"
 
@@ -358,6 +359,9 @@ bool DialogMacros::applyDialogChanges() {
 
 	parse_menu_item_list(MacroMenuData);
 
+	// the menu items have changed, so their compiled programs are stale
+	clearCompiledMacroCache();
+
 	// Update the menus themselves in all of the NEdit windows
 	for (MainWindow *window : MainWindow::allWindows()) {
 		window->updateUserMenus();
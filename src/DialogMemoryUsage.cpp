@@ -0,0 +1,151 @@
+
+#include "DialogMemoryUsage.h"
+#include "DocumentWidget.h"
+#include "Preferences.h"
+
+#include <QHeaderView>
+
+#include <algorithm>
+
+/**
+ * @brief DialogMemoryUsage::DialogMemoryUsage
+ * @param parent
+ * @param f
+ */
+DialogMemoryUsage::DialogMemoryUsage(QWidget *parent, Qt::WindowFlags f)
+	: Dialog(parent, f) {
+	ui.setupUi(this);
+	connectSlots();
+
+	ui.tableDocuments->horizontalHeader()->setSectionResizeMode(0, QHeaderView::Stretch);
+	refresh();
+}
+
+/**
+ * @brief DialogMemoryUsage::connectSlots
+ */
+void DialogMemoryUsage::connectSlots() {
+	connect(ui.buttonHibernate, &QPushButton::clicked, this, &DialogMemoryUsage::buttonHibernate_clicked);
+}
+
+/**
+ * @brief DialogMemoryUsage::buttonHibernate_clicked
+ */
+void DialogMemoryUsage::buttonHibernate_clicked() {
+	DocumentWidget::reclaimMemory(0);
+	refresh();
+}
+
+/**
+ * @brief DialogMemoryUsage::formatSize
+ * @param bytes
+ * @return
+ */
+QString DialogMemoryUsage::formatSize(int64_t bytes) const {
+
+	if (bytes < 1024 * 1024) {
+		return tr("%1 KB").arg(static_cast<double>(bytes) / 1024.0, 0, 'f', 1);
+	}
+
+	return tr("%1 MB").arg(static_cast<double>(bytes) / (1024.0 * 1024.0), 0, 'f', 1);
+}
+
+/**
+ * @brief DialogMemoryUsage::residenceName
+ * @param residence
+ * @return
+ */
+QString DialogMemoryUsage::residenceName(Residence residence) const {
+
+	switch (residence) {
+	case Residence::Memory:
+		return tr("In memory");
+	case Residence::Mapped:
+		return tr("Viewed from file");
+	case Residence::NotRead:
+		return tr("Not read yet");
+	case Residence::Hibernated:
+		return tr("Hibernated");
+	case Residence::Snapshot:
+		return tr("Hibernated to disk");
+	}
+
+	Q_UNREACHABLE();
+}
+
+/**
+ * @brief DialogMemoryUsage::sizeItem
+ * @param bytes
+ * @return
+ */
+QTableWidgetItem *DialogMemoryUsage::sizeItem(int64_t bytes) const {
+	auto item = new QTableWidgetItem(formatSize(bytes));
+	item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+	return item;
+}
+
+/*
+** Fill in the table with what each document takes up right now, the ones
+** which take up the most first, followed by the totals.
+*/
+void DialogMemoryUsage::refresh() {
+
+	std::vector<DocumentWidget *> documents = DocumentWidget::allDocuments();
+
+	std::vector<std::pair<DocumentWidget *, MemoryUsage>> usages;
+	usages.reserve(documents.size());
+
+	for (DocumentWidget *document : documents) {
+		usages.emplace_back(document, document->memoryUsage());
+	}
+
+	std::sort(usages.begin(), usages.end(), [](const std::pair<DocumentWidget *, MemoryUsage> &lhs, const std::pair<DocumentWidget *, MemoryUsage> &rhs) {
+		return lhs.second.total() > rhs.second.total();
+	});
+
+	ui.tableDocuments->setRowCount(static_cast<int>(usages.size()));
+
+	MemoryUsage total;
+	int hibernated = 0;
+	int row        = 0;
+
+	for (const std::pair<DocumentWidget *, MemoryUsage> &entry : usages) {
+		DocumentWidget *document  = entry.first;
+		const MemoryUsage &usage  = entry.second;
+		const Residence residence = document->residence();
+
+		auto nameItem = new QTableWidgetItem(document->filename());
+		nameItem->setToolTip(document->fullPath());
+
+		ui.tableDocuments->setItem(row, 0, nameItem);
+		ui.tableDocuments->setItem(row, 1, sizeItem(usage.text));
+		ui.tableDocuments->setItem(row, 2, sizeItem(usage.styles));
+		ui.tableDocuments->setItem(row, 3, sizeItem(usage.undo));
+		ui.tableDocuments->setItem(row, 4, sizeItem(usage.snapshot));
+		ui.tableDocuments->setItem(row, 5, new QTableWidgetItem(residenceName(residence)));
+
+		total.text += usage.text;
+		total.styles += usage.styles;
+		total.undo += usage.undo;
+		total.snapshot += usage.snapshot;
+
+		if (residence == Residence::Hibernated || residence == Residence::Snapshot) {
+			++hibernated;
+		}
+
+		++row;
+	}
+
+	ui.tableDocuments->resizeColumnsToContents();
+
+	const int limit = Preferences::GetPrefDocumentMemoryLimit();
+
+	QString text = tr("Documents: %1, hibernated: %2. In memory: %3 (text %4, highlighting %5, undo %6). On disk: %7.")
+					   .arg(QString::number(usages.size()), QString::number(hibernated), formatSize(total.total()), formatSize(total.text), formatSize(total.styles), formatSize(total.undo), formatSize(total.snapshot));
+
+	if (limit > 0) {
+		text += QLatin1Char(' ') + tr("Limit: %1 MB.").arg(limit);
+	}
+
+	ui.labelTotal->setText(text);
+}
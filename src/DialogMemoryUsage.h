@@ -0,0 +1,29 @@
+
+#ifndef DIALOG_MEMORY_USAGE_H_
+#define DIALOG_MEMORY_USAGE_H_
+
+#include "Dialog.h"
+#include "MemoryUsage.h"
+#include "ui_DialogMemoryUsage.h"
+
+class DialogMemoryUsage final : public Dialog {
+	Q_OBJECT
+public:
+	explicit DialogMemoryUsage(QWidget *parent = nullptr, Qt::WindowFlags f = Qt::WindowFlags());
+	~DialogMemoryUsage() override = default;
+
+private:
+	void buttonHibernate_clicked();
+	void connectSlots();
+	void refresh();
+
+private:
+	QString formatSize(int64_t bytes) const;
+	QString residenceName(Residence residence) const;
+	QTableWidgetItem *sizeItem(int64_t bytes) const;
+
+private:
+	Ui::DialogMemoryUsage ui;
+};
+
+#endif
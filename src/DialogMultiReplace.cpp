@@ -5,8 +5,24 @@
 #include "DocumentWidget.h"
 #include "MainWindow.h"
 #include "Preferences.h"
+#include "Search.h"
+#include "TextArea.h"
+#include "TextBuffer.h"
+#include "WindowMenuEvent.h"
 
+#include <QEventLoop>
+#include <QFutureWatcher>
 #include <QMessageBox>
+#include <QProgressDialog>
+#include <QTimer>
+#include <QtConcurrent>
+
+namespace {
+
+// how long to wait (msec) before showing the progress of the replacements
+constexpr int ProgressDelay = 250;
+
+}
 
 /**
  * @brief DialogMultiReplace::DialogMultiReplace
@@ -95,45 +111,69 @@ void DialogMultiReplace::buttonReplace_clicked() {
 	// Set the initial focus of the dialog back to the search string
 	replace_->ui.textFind->setFocus();
 
-	bool replaceFailed  = true;
-	bool noWritableLeft = true;
+	// save a copy of search and replace strings in the search history
+	Search::saveSearchHistory(fields->searchString, fields->replaceString, fields->searchType, /*isIncremental=*/false);
 
-	// Perform the replacements and mark the selected files (history)
+	/* First check again whether the files are still writable. If the file
+	 * status has changed or the file was locked in the mean time, we just
+	 * skip the document. */
+	std::vector<ReplaceJob> jobs;
 	for (QModelIndex index : selections) {
 		if (DocumentWidget *writeableDocument = model_->itemFromIndex(index)) {
+			// the text has to be in memory to be searched
+			writeableDocument->makeResident();
 
-			/* First check again whether the file is still writable. If the
-			 * file status has changed or the file was locked in the mean time,
-			 * we just skip the window. */
 			if (!writeableDocument->lockReasons().isAnyLocked()) {
-				noWritableLeft                    = false;
-				writeableDocument->multiFileBusy_ = true; // Avoid multi-beep/dialog
-				writeableDocument->replaceFailed_ = false;
-
-				if (MainWindow *win = MainWindow::fromDocument(writeableDocument)) {
-					win->action_Replace_All(
-						writeableDocument,
-						fields->searchString,
-						fields->replaceString,
-						fields->searchType);
-				}
-
-				writeableDocument->multiFileBusy_ = false;
-				if (!writeableDocument->replaceFailed_) {
-					replaceFailed = false;
-				}
+				ReplaceJob job;
+				job.document   = writeableDocument;
+				job.text       = writeableDocument->buffer()->BufAsString().to_string();
+				job.delimiters = writeableDocument->getWindowDelimiters();
+				jobs.push_back(std::move(job));
 			}
 		}
 	}
 
+	const bool noWritableLeft = jobs.empty();
+	bool replaceFailed        = true;
+
+	if (!replaceInDocuments(jobs, *fields)) {
+		// the user cancelled, nothing has been changed
+		return;
+	}
+
+	/* Apply the replacements. Each one replaces a single range of the buffer,
+	 * so it can be undone in one step. A document which was changed while its
+	 * replacement was being worked out is left alone, since the result no
+	 * longer applies to it */
+	for (ReplaceJob &job : jobs) {
+		if (!job.document || !job.replacement || job.document->lockReasons().isAnyLocked()) {
+			continue;
+		}
+
+		TextBuffer *buffer = job.document->buffer();
+		if (!(buffer->BufAsString() == job.text)) {
+			continue;
+		}
+
+		// recorded as it was when each document was done with Replace All,
+		// so that learn/replay and repeat reproduce the replacement
+		emit_event("replace_all", fields->searchString, fields->replaceString, to_string(fields->searchType));
+
+		buffer->BufReplace(TextCursor(job.copyStart), TextCursor(job.copyEnd), *job.replacement);
+
+		// Move the cursor to the end of the last replacement
+		job.document->firstPane()->TextSetCursorPos(TextCursor(job.copyStart + static_cast<int64_t>(job.replacement->size())));
+		replaceFailed = false;
+	}
+
 	if (!replace_->keepDialog()) {
 		replace_->hide();
 	}
 
 	hide();
 
-	/* We suppressed multiple beeps/dialogs. If there wasn't any file in
-	   which the replacement succeeded, we should still warn the user */
+	/* The replacements don't beep or warn for each file. If there wasn't any
+	   file in which the replacement succeeded, we should still warn the user */
 	if (replaceFailed) {
 		if (Preferences::GetPrefSearchDlogs()) {
 			if (noWritableLeft) {
@@ -147,6 +187,60 @@ void DialogMultiReplace::buttonReplace_clicked() {
 	}
 }
 
+/*
+** Works out the replacements for all of the jobs on the thread pool, each
+** against its own copy of the text, so that large sets of files don't hold up
+** the GUI. A progress dialog is shown if this takes more than a moment.
+** Returns false if the user cancelled, in which case no results should be
+** applied.
+*/
+bool DialogMultiReplace::replaceInDocuments(std::vector<ReplaceJob> &jobs, const DialogReplace::Fields &fields) {
+
+	const QString searchString  = fields.searchString;
+	const QString replaceString = fields.replaceString;
+	const SearchType searchType = fields.searchType;
+
+	QFutureWatcher<void> watcher;
+
+	watcher.setFuture(QtConcurrent::map(jobs, [searchString, replaceString, searchType](ReplaceJob &job) {
+		job.replacement = Search::ReplaceAllInString(
+			job.text,
+			searchString,
+			replaceString,
+			searchType,
+			&job.copyStart,
+			&job.copyEnd,
+			job.delimiters);
+	}));
+
+	{
+		// wait a moment before bothering the user with a progress dialog,
+		// ignoring input so that the documents can't be touched meanwhile
+		QEventLoop loop;
+		connect(&watcher, &QFutureWatcher<void>::finished, &loop, &QEventLoop::quit);
+		QTimer::singleShot(ProgressDelay, &loop, &QEventLoop::quit);
+		loop.exec(QEventLoop::ExcludeUserInputEvents);
+	}
+
+	if (!watcher.isFinished()) {
+		QProgressDialog progress(tr("Replacing in %1 files...").arg(jobs.size()), tr("Cancel"), 0, static_cast<int>(jobs.size()), this);
+		progress.setWindowTitle(tr("Multi-File Replacement"));
+		progress.setWindowModality(Qt::WindowModal);
+		progress.setMinimumDuration(0);
+		progress.setValue(watcher.progressValue());
+
+		connect(&watcher, &QFutureWatcher<void>::progressValueChanged, &progress, &QProgressDialog::setValue);
+		connect(&watcher, &QFutureWatcher<void>::finished, &progress, &QProgressDialog::reset);
+		connect(&progress, &QProgressDialog::canceled, &watcher, &QFutureWatcher<void>::cancel);
+
+		progress.exec();
+	}
+
+	// a cancelled run still has to wait for the jobs already underway
+	watcher.waitForFinished();
+	return !watcher.isCanceled();
+}
+
 /**
  * @brief DialogMultiReplace::uploadFileListItems
  */
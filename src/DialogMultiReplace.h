@@ -3,15 +3,33 @@
 #define DIALOG_MULTI_REPLACE_H_
 
 #include "Dialog.h"
+#include "DialogReplace.h"
 #include "ui_DialogMultiReplace.h"
 
-class DialogReplace;
+#include <QPointer>
+
+#include <boost/optional.hpp>
+
+#include <string>
+#include <vector>
+
 class DocumentModel;
 class DocumentWidget;
 class MainWindow;
 
 class DialogMultiReplace : public Dialog {
 	Q_OBJECT
+private:
+	// a replacement to work out on the thread pool, for one document
+	struct ReplaceJob {
+		QPointer<DocumentWidget> document;
+		std::string text;
+		QString delimiters;
+		boost::optional<std::string> replacement;
+		int64_t copyStart = 0;
+		int64_t copyEnd   = 0;
+	};
+
 public:
 	explicit DialogMultiReplace(DialogReplace *replace, Qt::WindowFlags f = Qt::WindowFlags());
 	~DialogMultiReplace() override = default;
@@ -22,6 +40,7 @@ private:
 	void buttonSelectAll_clicked();
 	void buttonReplace_clicked();
 	void connectSlots();
+	bool replaceInDocuments(std::vector<ReplaceJob> &jobs, const DialogReplace::Fields &fields);
 
 public:
 	void uploadFileListItems(const std::vector<DocumentWidget *> &writeableDocuments);
@@ -10,6 +10,8 @@
 #include "UndoInfo.h"
 #include "Util/FileFormats.h"
 #include "WrapStyle.h"
+#include <QByteArray>
+#include <QFile>
 #include <QString>
 #include <QtGlobal>
 #include <deque>
@@ -20,6 +22,8 @@
 #include <unistd.h>
 #endif
 
+struct Codec;
+
 struct DocumentInfo {
 	QString filename;                                 // name component of file being edited
 	QString path;                                     // path component of file being edited
@@ -43,6 +47,10 @@ struct DocumentInfo {
 	time_t lastModTime     = 0;                                    // time of last modification to file
 	dev_t dev              = 0;                                    // device where the file resides
 	ino_t ino              = 0;                                    // file's inode
+	int64_t fileSize       = 0;                                    // size of the file when it was last read or written
+	QByteArray fileHash;                                           // hash of the contents of the file when it was last read or written, empty if unknown
+	std::shared_ptr<QFile> mappedFile;                             // the file the text is borrowed from while the document is only being viewed
+	const Codec *codec = nullptr;                                  // the format the file is compressed in when it's saved, if any
 	std::shared_ptr<TextBuffer> buffer;                            // holds the text being edited
 	int autoSaveCharCount               = 0;                       // count of single characters typed since last backup file generated
 	int autoSaveOpCount                 = 0;                       // count of editing operations
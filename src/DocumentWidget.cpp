@@ -8,6 +8,7 @@
 #include "DialogReplace.h"
 #include "DragEndEvent.h"
 #include "EditFlags.h"
+#include "FileLoader.h"
 #include "Font.h"
 #include "Highlight.h"
 #include "HighlightData.h"
@@ -25,6 +26,7 @@
 #include "TextArea.h"
 #include "TextBuffer.h"
 #include "Util/ClearCase.h"
+#include "Util/Codec.h"
 #include "Util/FileSystem.h"
 #include "Util/Input.h"
 #include "Util/User.h"
@@ -41,6 +43,7 @@
 #include <QButtonGroup>
 #include <QClipboard>
 #include <QFile>
+#include <QFileSystemWatcher>
 #include <QMessageBox>
 #include <QMimeData>
 #include <QRadioButton>
@@ -48,6 +51,7 @@
 #include <QSplitter>
 #include <QTemporaryFile>
 #include <QTimer>
+#include <QtConcurrent>
 #include <qplatformdefs.h>
 
 #include <chrono>
@@ -72,6 +76,13 @@ struct ShellCommandData {
 	bool bannerIsUp;
 };
 
+struct DocumentWidget::Hibernation {
+	std::vector<std::pair<TextCursor, int>> panes; // the cursor position and top line of each pane
+	boost::optional<SelectionPos> selection;       // the primary selection, if there was one
+	std::unique_ptr<QTemporaryFile> snapshot;      // the text of a modified document, or nullptr if the file is to be read again
+	const Codec *codec = nullptr;                  // the format the snapshot is compressed in, if any
+};
+
 DocumentWidget *DocumentWidget::LastCreated = nullptr;
 
 namespace {
@@ -84,6 +95,33 @@ constexpr int BannerWaitTime = 6000;
 
 constexpr int FlashInterval = 1500;
 
+/* how long (msec) to wait after a file changes on disk before looking at it,
+   so that whatever is writing it has a chance to finish first */
+constexpr int FileCheckDelay = 250;
+
+/* files at least this large are shown while they are still being read, rather
+   than only once all of them has been read */
+constexpr int64_t StreamingOpenSize = 64 * 1024 * 1024;
+
+// files opened read only from this size up are viewed straight from the file, rather than read in
+constexpr int64_t MappedViewSize = 64 * 1024 * 1024;
+
+// how often (msec) the text read so far is added to a document being loaded
+constexpr int LoadUpdateInterval = 100;
+
+// how long (msec) to wait between reading files which were put off, when prefetching them
+constexpr int PrefetchInterval = 50;
+
+// how long (msec) to wait after a document is opened or raised before checking how much memory the documents take up
+constexpr int ReclaimDelay = 1000;
+
+// the number of times any document has been raised, to tell which were raised longest ago
+uint64_t raiseCount = 0;
+
+// the name and default color of the rangeset which Mark All fills in
+constexpr auto MarkAllName  = "mark_all";
+constexpr auto MarkAllColor = "#ffff80";
+
 enum : int {
 	ACCUMULATE        = 1,
 	ERROR_DIALOGS     = 2,
@@ -352,6 +390,8 @@ QLatin1String createRepeatMacro(int how) {
 ** works in association with the SetLanguageMode() function that has
 ** the syntax highlighting deferred, in order to speed up the file-
 ** opening operation when multiple files are being opened in succession.
+** With the deferredOpen preference, a file opened in a background tab isn't
+** even read until the tab is first raised.
 */
 DocumentWidget *DocumentWidget::editExistingFile(DocumentWidget *inDocument, const QString &name, const QString &path, int flags, const QString &geometry, bool iconic, const QString &languageMode, bool tabbed, bool background) {
 
@@ -413,19 +453,22 @@ DocumentWidget *DocumentWidget::editExistingFile(DocumentWidget *inDocument, con
 		return nullptr;
 	}
 
-	// Open the file
-	if (!document->doOpen(name, path, flags)) {
-		document->closeDocument();
-		return nullptr;
-	}
+	const bool deferred = background && !document->isTopDocument() && Preferences::GetPrefDeferredOpen() && document->deferOpen(name, path, flags, languageMode);
+	if (!deferred) {
+		// Open the file
+		if (!document->doOpen(name, path, flags)) {
+			document->closeDocument();
+			return nullptr;
+		}
 
-	win->forceShowLineNumbers();
+		win->forceShowLineNumbers();
 
-	// Decide what language mode to use, trigger language specific actions
-	if (languageMode.isNull()) {
-		document->determineLanguageMode(/*forceNewDefaults=*/true);
-	} else {
-		document->action_Set_Language_Mode(languageMode, /*forceNewDefaults=*/true);
+		// Decide what language mode to use, trigger language specific actions
+		if (languageMode.isNull()) {
+			document->determineLanguageMode(/*forceNewDefaults=*/true);
+		} else {
+			document->action_Set_Language_Mode(languageMode, /*forceNewDefaults=*/true);
+		}
 	}
 
 	// update tab label and tooltip
@@ -450,6 +493,9 @@ DocumentWidget *DocumentWidget::editExistingFile(DocumentWidget *inDocument, con
 	}
 
 	MainWindow::addToPrevOpenMenu(fullname);
+
+	// opening the file may have taken more memory than is allowed
+	scheduleReclaim();
 	return document;
 }
 
@@ -515,6 +561,16 @@ DocumentWidget::DocumentWidget(std::shared_ptr<DocumentInfo> &info_ptr, QWidget
 		eraseFlash();
 	});
 
+	journal_ = new EditJournal(this);
+	connect(journal_, &EditJournal::failed, this, &DocumentWidget::backupFailed);
+
+	loadTimer_ = new QTimer(this);
+	loadTimer_->setInterval(LoadUpdateInterval);
+
+	connect(loadTimer_, &QTimer::timeout, this, &DocumentWidget::updateLoading);
+	connect(ui.buttonCancelLoad, &QToolButton::clicked, this, &DocumentWidget::cancelLoading);
+	ui.buttonCancelLoad->hide();
+
 	auto area = createTextArea(info_->buffer);
 
 	info_->buffer->BufAddModifyCB(modifiedCB, this);
@@ -595,6 +651,16 @@ DocumentWidget::DocumentWidget(const QString &name, QWidget *parent, Qt::WindowF
 		eraseFlash();
 	});
 
+	journal_ = new EditJournal(this);
+	connect(journal_, &EditJournal::failed, this, &DocumentWidget::backupFailed);
+
+	loadTimer_ = new QTimer(this);
+	loadTimer_->setInterval(LoadUpdateInterval);
+
+	connect(loadTimer_, &QTimer::timeout, this, &DocumentWidget::updateLoading);
+	connect(ui.buttonCancelLoad, &QToolButton::clicked, this, &DocumentWidget::cancelLoading);
+	ui.buttonCancelLoad->hide();
+
 	auto area = createTextArea(info_->buffer);
 
 	info_->buffer->BufAddModifyCB(modifiedCB, this);
@@ -614,6 +680,16 @@ DocumentWidget::DocumentWidget(const QString &name, QWidget *parent, Qt::WindowF
  */
 DocumentWidget::~DocumentWidget() {
 
+	// don't leave a half written temporary file behind
+	if (saveWatcher_) {
+		saveWatcher_->waitForFinished();
+	}
+
+	unwatchFile();
+
+	// stop reading the file before the buffer goes away
+	loader_ = nullptr;
+
 	// first delete all of the text area's so that they can properly
 	// remove themselves from the buffer's callbacks
 	const std::vector<TextArea *> textAreas = textPanes();
@@ -958,11 +1034,21 @@ void DocumentWidget::modifiedCallback(TextCursor pos, int64_t nInserted, int64_t
 		updateMarkTable(pos, nInserted, nDeleted);
 	}
 
+	// tags found in the text before may have moved
+	if (nInserted != 0 || nDeleted != 0) {
+		tagLocations_.clear();
+	}
+
 	MainWindow *win = MainWindow::fromDocument(this);
 	if (!win) {
 		return;
 	}
 
+	// an incremental search can't resume from a result in text which has changed
+	if ((nInserted != 0 || nDeleted != 0) && win->iSearchResume_.document == this) {
+		win->iSearchResume_ = {};
+	}
+
 	// Check and dim/undim selection related menu items
 	if (info_->wasSelected != selected) {
 		info_->wasSelected = selected;
@@ -986,6 +1072,25 @@ void DocumentWidget::modifiedCallback(TextCursor pos, int64_t nInserted, int64_t
 		return;
 	}
 
+	++editCount_;
+
+	// keep the incremental backup in step with the text
+	if (info_->autoSave) {
+		if (!journal_->isOpen()) {
+			journal_->open(backupFileName(), journalBase());
+		}
+
+		if (nDeleted != 0) {
+			journal_->recordDelete(to_integer(pos), nDeleted);
+		}
+
+		if (nInserted != 0) {
+			journal_->recordInsert(to_integer(pos), info_->buffer->BufGetRange(pos, pos + nInserted));
+		}
+	} else if (journal_->isOpen()) {
+		journal_->remove();
+	}
+
 	// Make sure line number display is sufficient for new data
 	win->updateLineNumDisp();
 
@@ -1099,6 +1204,14 @@ void DocumentWidget::raiseDocumentWindow() {
  * @brief DocumentWidget::documentRaised
  */
 void DocumentWidget::documentRaised() {
+	// Read the file if that was put off until now, or bring it back from hibernation.
+	makeResident();
+
+	lastRaised_ = ++raiseCount;
+
+	// raising a document may have taken more memory than is allowed
+	scheduleReclaim();
+
 	// Turn on syntax highlight that might have been deferred.
 	if (highlightSyntax_ && !highlightData_) {
 		startHighlighting(Verbosity::Silent);
@@ -1898,9 +2011,28 @@ void DocumentWidget::removeBackupFile() const {
 		return;
 	}
 
+	journal_->remove();
 	QFile::remove(backupFileName());
 }
 
+/*
+** The file the incremental backup can start from, which is the file on disk
+** provided that the text is still the same as it.
+*/
+boost::optional<EditJournal::Base> DocumentWidget::journalBase() const {
+
+	if (!info_->filenameSet || info_->fileChanged) {
+		return boost::none;
+	}
+
+	QT_STATBUF statbuf;
+	if (QT_STAT(fullPath().toUtf8().data(), &statbuf) != 0) {
+		return boost::none;
+	}
+
+	return EditJournal::Base{static_cast<int64_t>(statbuf.st_size), static_cast<int64_t>(statbuf.st_mtime)};
+}
+
 /*
 ** Generate the name of the backup file for this window from the filename
 ** and path in the window data structure & write into name
@@ -1920,13 +2052,12 @@ QString DocumentWidget::backupFileName() const {
 */
 void DocumentWidget::checkForChangesToFile() {
 
-	/* Maximum frequency of checking for external modifications. The periodic
-	 * check is only performed on buffer modification, and the check interval is
-	 * only to prevent checking on every keystroke in case of a file system which
-	 * is slow to process stat requests (which I'm not sure exists) */
+	/* Maximum frequency of checking for external modifications of files which
+	 * can't be watched. The check is only performed on buffer modification,
+	 * and the check interval is only to prevent checking on every keystroke
+	 * in case of a file system which is slow to process stat requests */
 	constexpr auto CheckInterval = std::chrono::milliseconds(3000);
 
-	// TODO(eteran): 2.0, this concept can probably be reworked in terms of QFileSystemWatcher
 	static QPointer<DocumentWidget> lastCheckWindow;
 	static std::chrono::high_resolution_clock::time_point lastCheckTime;
 
@@ -1934,14 +2065,34 @@ void DocumentWidget::checkForChangesToFile() {
 		return;
 	}
 
-	// If last check was very recent, don't impact performance
-	auto timestamp = std::chrono::high_resolution_clock::now();
-	if (this == lastCheckWindow && (timestamp - lastCheckTime) < CheckInterval) {
+	// the file is being replaced by a save of our own
+	if (saveWatcher_) {
+		return;
+	}
+
+	// a file which hasn't been read yet will be read as it is when it is, and the same goes for a hibernated document
+	if (deferredOpen_ || hibernation_) {
 		return;
 	}
 
-	lastCheckWindow = this;
-	lastCheckTime   = timestamp;
+	// Get the file mode and modification time
+	QString fullname = fullPath();
+
+	if (watchedPath_ == fullname) {
+		// nothing has happened to a watched file until the watcher says so
+		if (!fileCheckPending_) {
+			return;
+		}
+	} else {
+		// If last check was very recent, don't impact performance
+		auto timestamp = std::chrono::high_resolution_clock::now();
+		if (this == lastCheckWindow && (timestamp - lastCheckTime) < CheckInterval) {
+			return;
+		}
+
+		lastCheckWindow = this;
+		lastCheckTime   = timestamp;
+	}
 
 	MainWindow *win = MainWindow::fromDocument(this);
 	if (!win) {
@@ -1954,8 +2105,10 @@ void DocumentWidget::checkForChangesToFile() {
 	 */
 	const bool silent = (!isTopDocument() || !win->isVisible());
 
-	// Get the file mode and modification time
-	QString fullname = fullPath();
+	// a change which can't be shown to the user yet is looked at again later
+	if (!silent) {
+		fileCheckPending_ = false;
+	}
 
 	QT_STATBUF statbuf;
 	if (QT_STAT(fullname.toUtf8().data(), &statbuf) != 0) {
@@ -2031,6 +2184,11 @@ void DocumentWidget::checkForChangesToFile() {
 		return;
 	}
 
+	// the file may have been replaced by a new one, which has to be watched afresh
+	if (watchedPath_ != fullname) {
+		watchFile();
+	}
+
 	/* Check that the file's read-only status is still correct (but
 	   only if the file can still be opened successfully in read mode) */
 	if (info_->mode != statbuf.st_mode || info_->uid != statbuf.st_uid || info_->gid != statbuf.st_gid) {
@@ -2062,7 +2220,7 @@ void DocumentWidget::checkForChangesToFile() {
 			return;
 		}
 
-		if (Preferences::GetPrefWarnRealFileMods() && !compareDocumentToFile(fullname)) {
+		if (Preferences::GetPrefWarnRealFileMods() && !fileContentsChanged(fullname)) {
 			// Contents hasn't changed. Update the modification time.
 			info_->lastModTime = statbuf.st_mtime;
 			return;
@@ -2089,6 +2247,98 @@ void DocumentWidget::checkForChangesToFile() {
 	}
 }
 
+/*
+** The one watcher shared by all of the documents, which tells them when
+** something happens to their files, rather than each of them having to keep
+** looking.
+*/
+QFileSystemWatcher *DocumentWidget::fileWatcher() {
+
+	static QFileSystemWatcher *watcher = nullptr;
+
+	if (!watcher) {
+		watcher = new QFileSystemWatcher(qApp);
+		QObject::connect(watcher, &QFileSystemWatcher::fileChanged, watcher, [](const QString &path) {
+			for (DocumentWidget *document : DocumentWidget::allDocuments()) {
+				if (document->watchedPath_ == path) {
+					document->fileChangedOnDisk(path);
+				}
+			}
+		});
+	}
+
+	return watcher;
+}
+
+/*
+** Start watching the file of the document, if it can be, instead of looking
+** at it every so often.
+*/
+void DocumentWidget::watchFile() {
+
+	unwatchFile();
+
+	const QString fullname = fullPath();
+	if (fullname.isEmpty()) {
+		return;
+	}
+
+	// another view of the same file may already be watching it
+	if (fileWatcher()->files().contains(fullname) || fileWatcher()->addPath(fullname)) {
+		watchedPath_ = fullname;
+	}
+}
+
+/**
+ * @brief DocumentWidget::unwatchFile
+ */
+void DocumentWidget::unwatchFile() {
+
+	if (watchedPath_.isEmpty()) {
+		return;
+	}
+
+	const QString path = watchedPath_;
+	watchedPath_.clear();
+
+	const std::vector<DocumentWidget *> documents = DocumentWidget::allDocuments();
+	const bool shared = std::any_of(documents.begin(), documents.end(), [&path](DocumentWidget *document) {
+		return document->watchedPath_ == path;
+	});
+
+	if (!shared) {
+		fileWatcher()->removePath(path);
+	}
+}
+
+/*
+** Called when the watcher sees the file of the document change. The file is
+** looked at shortly afterwards if the document is in front of the user,
+** otherwise the next time it is.
+*/
+void DocumentWidget::fileChangedOnDisk(const QString &path) {
+
+	// a file which is deleted or replaced isn't watched any more
+	if (!fileWatcher()->files().contains(path)) {
+		watchedPath_.clear();
+	}
+
+	// this can't wait for the check below, nor for the document to be raised
+	mappedFileChanged();
+
+	if (fileCheckPending_) {
+		return;
+	}
+
+	fileCheckPending_ = true;
+
+	if (isTopDocument() && window()->isActiveWindow()) {
+		QTimer::singleShot(FileCheckDelay, this, [this]() {
+			checkForChangesToFile();
+		});
+	}
+}
+
 /**
  * @brief DocumentWidget::fullPath
  * @return
@@ -2127,6 +2377,45 @@ QString DocumentWidget::path() const {
 	return info_->path;
 }
 
+/*
+** Whether the contents of the file named fileName are different from what
+** was last read from or written to it. A file of a different size certainly
+** is; otherwise it's read once to compare its hash with the one kept. When
+** there is no hash, the file is compared with the text instead.
+*/
+bool DocumentWidget::fileContentsChanged(const QString &fileName) const {
+
+	// text viewed straight from the file changes along with it, so there is nothing to compare
+	if (info_->mappedFile) {
+		return true;
+	}
+
+	if (info_->fileHash.isEmpty()) {
+		// a compressed file can't be compared with the text it holds
+		if (CodecForFile(fileName)) {
+			return true;
+		}
+
+		return compareDocumentToFile(fileName);
+	}
+
+	QT_STATBUF statbuf;
+	if (QT_STAT(fileName.toUtf8().data(), &statbuf) != 0 || statbuf.st_size != info_->fileSize) {
+		return true;
+	}
+
+	/* For large files, this can take a while. If it takes too long,
+	   the user should be given a clue about what is happening. */
+	MainWindow::allDocumentsBusy(tr("Comparing externally modified %1 ...").arg(info_->filename));
+
+	// make sure that we unbusy the windows when we're done
+	auto _ = gsl::finally([]() {
+		MainWindow::allDocumentsUnbusy();
+	});
+
+	return HashFile(fileName) != info_->fileHash;
+}
+
 /*
  * Check if the contents of the TextBuffer is equal
  * the contens of the file named fileName. The format of
@@ -2306,68 +2595,38 @@ void DocumentWidget::revertToSaved() {
 }
 
 /*
-** Create a backup file for the current document.  The name for the backup file
-** is generated using the name and path stored in the window and adding a
-** tilde (~) on UNIX.
+** Bring the backup file for the current document up to date, by appending the
+** changes made since it was last written to its journal. The name for the
+** backup file is generated using the name and path stored in the window and
+** adding a tilde (~) on UNIX.
 */
 bool DocumentWidget::writeBackupFile() {
-	FILE *fp;
-
-	// Generate a name for the autoSave file
-	const QString name = backupFileName();
-
-	// remove the old backup file. Well, this might fail - we'll notice later however.
-	QFile::remove(name);
-
-	/* open the file, set more restrictive permissions (using default
-	   permissions was somewhat of a security hole, because permissions were
-	   independent of those of the original file being edited */
-#ifdef Q_OS_WIN
-	int fd = QT_OPEN(name.toUtf8().data(), QT_OPEN_CREAT | O_EXCL | QT_OPEN_WRONLY, _S_IREAD | _S_IWRITE);
-#else
-	int fd = QT_OPEN(name.toUtf8().data(), QT_OPEN_CREAT | O_EXCL | QT_OPEN_WRONLY, S_IRUSR | S_IWUSR);
-#endif
-	if (fd < 0 || (fp = fdopen(fd, "w")) == nullptr) {
-
-		QMessageBox::warning(
-			this,
-			tr("Error writing Backup"),
-			tr("Unable to save backup for %1:\n%2\nAutomatic backup is now off").arg(info_->filename, errorString(errno)));
-
-		info_->autoSave = false;
 
-		if (auto win = MainWindow::fromDocument(this)) {
-			no_signals(win->ui.action_Incremental_Backup)->setChecked(false);
-		}
+	QString error;
+	if (!journal_->flush(info_->buffer.get(), &error)) {
+		backupFailed(error);
 		return false;
 	}
 
-	// get the text buffer contents
-	std::string fileString = info_->buffer->BufGetAll();
+	return true;
+}
 
-	// add a terminating newline if the file doesn't already have one
-	if (Preferences::GetPrefAppendLF()) {
-		if (!fileString.empty() && fileString.back() != '\n') {
-			fileString.append("\n");
-		}
-	}
+/*
+** Tell the user that the backup file couldn't be written, and stop trying.
+*/
+void DocumentWidget::backupFailed(const QString &error) {
 
-	auto _ = gsl::finally([fp] { ::fclose(fp); });
+	QMessageBox::warning(
+		this,
+		tr("Error writing Backup"),
+		tr("Unable to save backup for %1:\n%2\nAutomatic backup is now off").arg(info_->filename, error));
 
-	// write out the file
-	::fwrite(fileString.data(), 1, fileString.size(), fp);
-	if (::ferror(fp)) {
-		QMessageBox::critical(
-			this,
-			tr("Error saving Backup"),
-			tr("Error while saving backup for %1:\n%2\nAutomatic backup is now off").arg(info_->filename, errorString(errno)));
+	info_->autoSave = false;
+	journal_->close();
 
-		QFile::remove(name);
-		info_->autoSave = false;
-		return false;
+	if (auto win = MainWindow::fromDocument(this)) {
+		no_signals(win->ui.action_Incremental_Backup)->setChecked(false);
 	}
-
-	return true;
 }
 
 /**
@@ -2376,6 +2635,12 @@ bool DocumentWidget::writeBackupFile() {
  */
 bool DocumentWidget::saveDocument() {
 
+	// one save at a time, so that an older one can't finish last
+	waitForSave();
+
+	// a document whose text is in a snapshot has to have it back to write it out
+	makeResident();
+
 	// Try to ensure our information is up-to-date
 	checkForChangesToFile();
 
@@ -2419,16 +2684,128 @@ bool DocumentWidget::saveDocument() {
 		}
 	}
 
+	if (Preferences::GetPrefBackgroundSave() && saveDocumentInBackground()) {
+		return true;
+	}
+
 	if (writeBckVersion()) {
 		return false;
 	}
 
-	const bool status = doSave();
-	if (status) {
+	return doSave();
+}
+
+/*
+** Start saving the document on a worker thread, if it's a file that can be
+** replaced by a new one without anybody noticing: a regular file, with no
+** other names, owned by the user, in a directory they can write to. Returns
+** false without doing anything when it isn't, so that the caller can save
+** in the usual way instead.
+*/
+bool DocumentWidget::saveDocumentInBackground() {
+#ifdef Q_OS_UNIX
+	const QString fullname = fullPath();
+
+	QT_STATBUF statbuf;
+	if (QT_LSTAT(fullname.toUtf8().data(), &statbuf) != 0) {
+		return false;
+	}
+
+	if (!S_ISREG(statbuf.st_mode) || statbuf.st_nlink != 1 || statbuf.st_uid != ::geteuid() || (statbuf.st_mode & S_IWUSR) == 0) {
+		return false;
+	}
+
+	if (!QFileInfo(info_->path).isWritable()) {
+		return false;
+	}
+
+	// see doSave
+	if (Preferences::GetPrefAppendLF() && !info_->buffer->BufIsEmpty() && info_->buffer->back() != '\n') {
+		info_->buffer->BufAppend('\n');
+	}
+
+	/* the worker gets a copy of the text, which takes far less time to make
+	   than writing it out does, so that it can be edited in the meantime */
+	auto text                = std::make_shared<std::string>(info_->buffer->BufGetAll());
+	const QString backup     = info_->saveOldVersion ? tr("%1.bck").arg(fullname) : QString();
+	const FileFormats format = info_->fileFormat;
+	const Codec *codec       = info_->codec;
+	const bool sync          = Preferences::GetPrefSyncOnSave();
+
+	savedEditCount_ = editCount_;
+
+	auto watcher = new QFutureWatcher<SaveResult>(this);
+	connect(watcher, &QFutureWatcher<SaveResult>::finished, this, [this, watcher]() {
+		if (watcher == saveWatcher_) {
+			finishBackgroundSave();
+		}
+	});
+
+	saveWatcher_ = watcher;
+	saveWatcher_->setFuture(QtConcurrent::run([fullname, backup, text, format, sync, codec]() {
+		SaveResult result;
+		QCryptographicHash hash(ContentHashAlgorithm);
+		if (!ReplaceTextFile(fullname, backup, *text, format, sync, &result.error, &hash, codec) && result.error.isEmpty()) {
+			result.error = tr("unknown error");
+		}
+
+		result.hash = hash.result();
+		return result;
+	}));
+
+	return true;
+#else
+	return false;
+#endif
+}
+
+/*
+** Deal with the outcome of a save written in the background once it's done.
+** Returns false if the file couldn't be saved.
+*/
+bool DocumentWidget::finishBackgroundSave() {
+
+	if (!saveWatcher_) {
+		return true;
+	}
+
+	const SaveResult result = saveWatcher_->result();
+	saveWatcher_->deleteLater();
+	saveWatcher_ = nullptr;
+
+	if (!result.error.isEmpty()) {
+		QMessageBox::critical(this, tr("Error saving File"), tr("%1 not saved:\n%2").arg(info_->filename, result.error));
+		return false;
+	}
+
+	info_->fileHash = result.hash;
+
+	// the document is only as it was saved if it wasn't edited in the meantime
+	if (editCount_ == savedEditCount_) {
+		setWindowModified(false);
 		removeBackupFile();
+	} else if (journal_->isOpen()) {
+		// what the backup was based on has just been replaced
+		journal_->open(backupFileName(), boost::none);
 	}
 
-	return status;
+	refreshFileStatus();
+	return true;
+}
+
+/**
+ * @brief DocumentWidget::waitForSave
+ * @return false if a save which was still being written in the background
+ * failed
+ */
+bool DocumentWidget::waitForSave() {
+
+	if (!saveWatcher_) {
+		return true;
+	}
+
+	saveWatcher_->waitForFinished();
+	return finishBackgroundSave();
 }
 
 bool DocumentWidget::doSave() {
@@ -2484,48 +2861,56 @@ bool DocumentWidget::doSave() {
 		return false;
 	}
 
-	// get the text buffer contents and its length
-	std::string text = info_->buffer->BufGetAll();
-
-	// If the file is to be saved in DOS or Macintosh format, reconvert
-	switch (info_->fileFormat) {
-	case FileFormats::Dos:
-		ConvertToDos(text);
-		break;
-	case FileFormats::Mac:
-		ConvertToMac(text);
-		break;
-	default:
-		break;
-	}
+	/* write the text straight from the two halves of the buffer, converting
+	   it to DOS or Macintosh format and compressing it on the way if needed,
+	   rather than making a copy of it all first */
+	const std::pair<view::string_view, view::string_view> segments = info_->buffer->BufAsSegments();
 
-	// write to the file
-	if (file.write(text.data(), static_cast<int64_t>(text.size())) == -1) {
-		QMessageBox::critical(this, tr("Error saving File"), tr("%1 not saved:\n%2").arg(info_->filename, file.errorString()));
+	QString error;
+	QCryptographicHash hash(ContentHashAlgorithm);
+	if (!WriteTextFile(&file, segments.first, segments.second, info_->fileFormat, &error, &hash, info_->codec)) {
+		QMessageBox::critical(this, tr("Error saving File"), tr("%1 not saved:\n%2").arg(info_->filename, error));
 		file.close();
 		file.remove();
+		info_->fileHash.clear();
 		return false;
 	}
 
 	// success, file was written
+	info_->fileHash = hash.result();
 	setWindowModified(false);
+	refreshFileStatus();
+	removeBackupFile();
+	return true;
+}
+
+/*
+** Record the modification time, size and identity of the file as it is now
+** on disk, after it has been written, and watch it from now on.
+*/
+void DocumentWidget::refreshFileStatus() {
+
+	const QString fullname = fullPath();
 
-	// update the modification time
 	QT_STATBUF statbuf;
 	if (QT_STAT(fullname.toUtf8().data(), &statbuf) == 0) {
 		info_->lastModTime = statbuf.st_mtime;
 		info_->fileMissing = false;
 		info_->dev         = statbuf.st_dev;
 		info_->ino         = statbuf.st_ino;
+		info_->fileSize    = statbuf.st_size;
+
+		// the file may be a new one, which has replaced the one being watched
+		watchFile();
 	} else {
 		// This needs to produce an error message -- the file can't be accessed!
 		info_->lastModTime = 0;
 		info_->fileMissing = true;
 		info_->dev         = 0;
 		info_->ino         = 0;
+		info_->fileHash.clear();
+		unwatchFile();
 	}
-
-	return true;
 }
 
 /**
@@ -2536,6 +2921,14 @@ bool DocumentWidget::doSave() {
  */
 bool DocumentWidget::saveDocumentAs(const QString &newName, bool addWrap) {
 
+	waitForSave();
+
+	// only the whole of the file is worth saving under another name
+	makeResident();
+	if (loader_) {
+		finishLoading();
+	}
+
 	MainWindow *win = MainWindow::fromDocument(this);
 	if (!win) {
 		return false;
@@ -2603,6 +2996,9 @@ bool DocumentWidget::saveDocumentAs(const QString &newName, bool addWrap) {
 	info_->uid      = 0;
 	info_->gid      = 0;
 
+	// a name such as "file.gz" asks for the file to be compressed
+	info_->codec = CodecForFileName(fi.filename);
+
 	info_->lockReasons.clear();
 	const int retVal = doSave();
 	Q_EMIT updateWindowReadOnly(this);
@@ -2818,7 +3214,7 @@ bool DocumentWidget::fileWasModifiedExternally() const {
 		return false;
 	}
 
-	if (Preferences::GetPrefWarnRealFileMods() && !compareDocumentToFile(fullname)) {
+	if (Preferences::GetPrefWarnRealFileMods() && !fileContentsChanged(fullname)) {
 		return false;
 	}
 
@@ -2827,6 +3223,9 @@ bool DocumentWidget::fileWasModifiedExternally() const {
 
 bool DocumentWidget::closeFileAndWindow(CloseMode preResponse) {
 
+	// a save still being written decides whether there is anything left to save
+	waitForSave();
+
 	/* If the window is a normal & unmodified file or an empty new file,
 	   or if the user wants to ignore external modifications then
 	   just close it.  Otherwise ask for confirmation first. */
@@ -2862,7 +3261,7 @@ bool DocumentWidget::closeFileAndWindow(CloseMode preResponse) {
 		switch (response) {
 		case QMessageBox::Yes:
 			// Save
-			if (saveDocument()) {
+			if (saveDocument() && waitForSave()) {
 				closeDocument();
 			} else {
 				return false;
@@ -2927,8 +3326,15 @@ void DocumentWidget::closeDocument() {
 		info_->lastModTime = 0;
 		info_->dev         = 0;
 		info_->ino         = 0;
+		info_->fileSize    = 0;
 		info_->filename    = name;
+		info_->codec       = nullptr;
+		info_->fileHash.clear();
 		setPath(QString());
+		unwatchFile();
+		stopLoading();
+		deferredOpen_ = boost::none;
+		hibernation_  = nullptr;
 
 		markTable_.clear();
 
@@ -2936,6 +3342,7 @@ void DocumentWidget::closeDocument() {
 		info_->ignoreModify = true;
 		info_->buffer->BufSetAll(view::string_view());
 		info_->ignoreModify = false;
+		releaseMappedFile();
 
 		info_->filenameSet = false;
 		info_->fileChanged = false;
@@ -3039,10 +3446,16 @@ bool DocumentWidget::doOpen(const QString &name, const QString &path, int flags)
 	info_->lockReasons.clear();
 
 	// Update the window data structure
+	stopLoading();
+	unwatchFile();
+	deferredOpen_ = boost::none;
+	hibernation_  = nullptr;
 	setPath(path);
 	info_->filename    = name;
 	info_->filenameSet = true;
 	info_->fileMissing = true;
+	info_->codec       = nullptr;
+	info_->fileHash.clear();
 
 	FILE *fp = nullptr;
 
@@ -3059,180 +3472,1005 @@ bool DocumentWidget::doOpen(const QString &name, const QString &path, int flags)
 	{
 		if ((fp = ::fopen(fullname.toUtf8().data(), "r"))) {
 
-			// detect if the file is readable, but not writable
-			QFile file(fullname);
-			if (file.open(QIODevice::ReadWrite) || file.open(QIODevice::ReadOnly)) {
-				info_->lockReasons.setPermLocked(!file.isWritable());
-			}
+			// detect if the file is readable, but not writable
+			QFile file(fullname);
+			if (file.open(QIODevice::ReadWrite) || file.open(QIODevice::ReadOnly)) {
+				info_->lockReasons.setPermLocked(!file.isWritable());
+			}
+
+		} else if (flags & EditFlags::CREATE && errno == ENOENT) {
+			// Give option to create (or to exit if this is the only window)
+			if (!(flags & EditFlags::SUPPRESS_CREATE_WARN)) {
+
+				QMessageBox msgbox(this);
+				msgbox.setIcon(QMessageBox::Warning);
+				msgbox.setWindowTitle(tr("New File"));
+				msgbox.setText(tr("Can't open %1:\n%2").arg(fullname, errorString(errno)));
+
+				QAbstractButton *exitButton   = nullptr;
+				QAbstractButton *cancelButton = msgbox.addButton(QMessageBox::Cancel);
+				QAbstractButton *newButton    = msgbox.addButton(tr("New File"), QMessageBox::AcceptRole);
+
+				// ask user for next action if file not found
+				std::vector<DocumentWidget *> documents = DocumentWidget::allDocuments();
+
+				if (documents.size() == 1 && documents.front() == this) {
+					exitButton = msgbox.addButton(tr("Exit NEdit"), QMessageBox::RejectRole);
+				}
+
+				Q_UNUSED(newButton)
+
+				msgbox.exec();
+
+				if (msgbox.clickedButton() == cancelButton) {
+					return false;
+				} else if (msgbox.clickedButton() == exitButton) {
+					// NOTE(eteran): we use ::exit here because if we got here
+					// it's because we failed to open the initial documents on
+					// launch and the user has opted to no longer continue
+					// running nedit-ng
+					::exit(0);
+				}
+			}
+
+			// Test if new file can be created
+			const int fd = QT_OPEN(fullname.toUtf8().data(), QT_OPEN_CREAT | QT_OPEN_WRONLY | QT_OPEN_TRUNC, 0666);
+			if (fd == -1) {
+				QMessageBox::critical(this, tr("Error creating File"), tr("Can't create %1:\n%2").arg(fullname, errorString(errno)));
+				return false;
+			} else {
+				QT_CLOSE(fd);
+				QFile::remove(fullname);
+			}
+
+			setWindowModified(false);
+			if ((flags & EditFlags::PREF_READ_ONLY) != 0) {
+				info_->lockReasons.setUserLocked(true);
+			}
+
+			Q_EMIT updateWindowReadOnly(this);
+			return true;
+		} else {
+			// A true error
+			QMessageBox::critical(this, tr("Error opening File"), tr("Could not open %1%2:\n%3").arg(path, name, errorString(errno)));
+			return false;
+		}
+	}
+
+	auto _ = gsl::finally([fp] { ::fclose(fp); });
+
+	/* Get the length of the file, the protection mode, and the time of the
+	   last modification to the file */
+	QT_STATBUF statbuf;
+	if (QT_FSTAT(QT_FILENO(fp), &statbuf) != 0) {
+		info_->filenameSet = false; // Temp. prevent check for changes.
+		QMessageBox::critical(this, tr("Error opening File"), tr("Error opening %1").arg(name));
+		info_->filenameSet = true;
+		return false;
+	}
+
+#ifdef Q_OS_WIN
+// Copied from linux libc sys/stat.h:
+#define S_ISREG(m) (((m)&S_IFMT) == S_IFREG)
+#define S_ISDIR(m) (((m)&S_IFMT) == S_IFDIR)
+#endif
+
+	if (S_ISDIR(statbuf.st_mode)) {
+		info_->filenameSet = false; // Temp. prevent check for changes.
+		QMessageBox::critical(this, tr("Error opening File"), tr("Can't open directory %1").arg(name));
+		info_->filenameSet = true;
+		return false;
+	}
+
+#ifdef S_ISBLK
+	if (S_ISBLK(statbuf.st_mode)) {
+		info_->filenameSet = false; // Temp. prevent check for changes.
+		QMessageBox::critical(this, tr("Error opening File"), tr("Can't open block device %1").arg(name));
+		info_->filenameSet = true;
+		return false;
+	}
+#endif
+
+	// compressed files are decompressed as they're read, and compressed again when they're saved if the user wants
+	const Codec *codec = CodecForFile(fullname);
+	if (Preferences::GetPrefRecompressOnSave()) {
+		info_->codec = codec;
+	}
+
+	// very large files which are only being viewed are shown straight from the file, without reading them in
+	if ((flags & EditFlags::PREF_READ_ONLY) != 0 && statbuf.st_size >= MappedViewSize && !codec && !EditJournal::isJournal(backupFileName()) && mapFile(fullname)) {
+		info_->mode        = statbuf.st_mode;
+		info_->uid         = statbuf.st_uid;
+		info_->gid         = statbuf.st_gid;
+		info_->lastModTime = statbuf.st_mtime;
+		info_->dev         = statbuf.st_dev;
+		info_->ino         = statbuf.st_ino;
+		info_->fileSize    = statbuf.st_size;
+		info_->fileMissing = false;
+
+		journal_->close();
+		info_->lockReasons.setUserLocked(true);
+
+		if (info_->lockReasons.isPermLocked()) {
+			info_->fileChanged = false;
+		} else {
+			setWindowModified(false);
+		}
+
+		Q_EMIT updateWindowTitle(this);
+		Q_EMIT updateWindowReadOnly(this);
+
+		watchFile();
+		fileCheckPending_ = false;
+		return true;
+	}
+
+	/* very large files are shown while the rest of them is still being read,
+	   as are compressed ones, which may well turn out to be very large */
+	if ((statbuf.st_size >= StreamingOpenSize || codec) && !EditJournal::isJournal(backupFileName())) {
+		info_->mode        = statbuf.st_mode;
+		info_->uid         = statbuf.st_uid;
+		info_->gid         = statbuf.st_gid;
+		info_->lastModTime = statbuf.st_mtime;
+		info_->dev         = statbuf.st_dev;
+		info_->ino         = statbuf.st_ino;
+		info_->fileSize    = statbuf.st_size;
+		info_->fileMissing = false;
+
+		journal_->close();
+		startLoading(fullname, statbuf.st_size);
+		releaseMappedFile();
+
+		if ((flags & EditFlags::PREF_READ_ONLY) != 0) {
+			info_->lockReasons.setUserLocked(true);
+		}
+
+		if (info_->lockReasons.isPermLocked()) {
+			info_->fileChanged = false;
+		} else {
+			setWindowModified(false);
+		}
+
+		Q_EMIT updateWindowTitle(this);
+		Q_EMIT updateWindowReadOnly(this);
+
+		watchFile();
+		fileCheckPending_ = false;
+		return true;
+	}
+
+	// Allocate space for the whole contents of the file (unfortunately)
+	try {
+		QFile file;
+		// TODO(eteran): error checking on this open?
+		file.open(fp, QIODevice::ReadOnly);
+
+		std::string text;
+
+		if (file.size() != 0) {
+			uchar *memory = file.map(0, file.size());
+			if (!memory) {
+				info_->filenameSet = false; // Temp. prevent check for changes.
+				QMessageBox::critical(this, tr("Error while opening File"), tr("Error reading %1\n%2").arg(name, file.errorString()));
+				info_->filenameSet = true;
+				return false;
+			}
+
+			text = std::string{reinterpret_cast<char *>(memory), static_cast<size_t>(file.size())};
+			file.unmap(memory);
+		}
+
+		/* Any errors that happen after this point leave the window in a
+		 * "broken" state, and thus RevertToSaved will abandon the window if
+		 * info_->fileMissing is false and doOpen fails. */
+		info_->mode        = statbuf.st_mode;
+		info_->uid         = statbuf.st_uid;
+		info_->gid         = statbuf.st_gid;
+		info_->lastModTime = statbuf.st_mtime;
+		info_->dev         = statbuf.st_dev;
+		info_->ino         = statbuf.st_ino;
+		info_->fileMissing = false;
+
+		// remember what was read, before it's converted, to tell later whether the file has really changed
+		info_->fileSize = static_cast<int64_t>(text.size());
+		info_->fileHash = HashText(text);
+
+		if (codec) {
+			std::string plain;
+			QString error;
+			if (!Decompress(codec, text, &plain, &error)) {
+				info_->filenameSet = false; // Temp. prevent check for changes.
+				QMessageBox::critical(this, tr("Error while opening File"), tr("Error decompressing %1\n%2").arg(name, error));
+				info_->filenameSet = true;
+				return false;
+			}
+
+			text.swap(plain);
+		}
+
+		// Detect and convert DOS and Macintosh format files
+		if (Preferences::GetPrefForceOSConversion()) {
+			info_->fileFormat = FormatOfFile(text);
+			switch (info_->fileFormat) {
+			case FileFormats::Dos:
+				ConvertFromDos(text);
+				break;
+			case FileFormats::Mac:
+				ConvertFromMac(text);
+				break;
+			case FileFormats::Unix:
+				break;
+			}
+		}
+
+		// offer to bring back changes which were lost when NEdit-ng last exited
+		const QString journalName = backupFileName();
+		const EditJournal::Base base{static_cast<int64_t>(statbuf.st_size), static_cast<int64_t>(statbuf.st_mtime)};
+		const bool recovered = EditJournal::isJournal(journalName) && recoverFromJournal(journalName, base, &text);
+
+		// Display the file contents in the text widget
+		info_->ignoreModify = true;
+		info_->buffer->BufSetAll(text);
+		info_->ignoreModify = false;
+		releaseMappedFile();
+
+		// the backup which was recovered from carries on, starting with the text as it is now
+		if (recovered && info_->autoSave) {
+			journal_->open(journalName, boost::none);
+		} else {
+			journal_->close();
+		}
+
+		// Set window title and file changed flag
+		if ((flags & EditFlags::PREF_READ_ONLY) != 0) {
+			info_->lockReasons.setUserLocked(true);
+		}
+
+		if (info_->lockReasons.isPermLocked()) {
+			info_->fileChanged = recovered;
+			Q_EMIT updateWindowTitle(this);
+		} else {
+			setWindowModified(recovered);
+			if (info_->lockReasons.isAnyLocked()) {
+				Q_EMIT updateWindowTitle(this);
+			}
+		}
+
+		Q_EMIT updateWindowReadOnly(this);
+
+		watchFile();
+		fileCheckPending_ = false;
+		return true;
+	} catch (const std::bad_alloc &) {
+		info_->filenameSet = false; // Temp. prevent check for changes.
+		QMessageBox::critical(this, tr("Error while opening File"), tr("File is too large to edit"));
+		info_->filenameSet = true;
+		return false;
+	}
+}
+
+/*
+** Offer to bring back the changes recorded in the incremental backup of a
+** file which wasn't saved or closed before NEdit-ng exited, most likely in a
+** crash. Returns true if text was replaced with the text as it was when the
+** backup was last written.
+*/
+bool DocumentWidget::recoverFromJournal(const QString &journalName, const EditJournal::Base &base, std::string *text) {
+
+	QMessageBox messageBox(this);
+	messageBox.setWindowTitle(tr("Recover File"));
+	messageBox.setIcon(QMessageBox::Question);
+	messageBox.setText(tr("The backup file %1 holds changes to %2 which were never saved, most likely because NEdit-ng didn't exit normally.\n\n"
+						  "Recover them?")
+						   .arg(journalName, info_->filename));
+
+	QPushButton *buttonRecover = messageBox.addButton(tr("Recover"), QMessageBox::AcceptRole);
+	QPushButton *buttonDiscard = messageBox.addButton(tr("Discard"), QMessageBox::DestructiveRole);
+	QPushButton *buttonCancel  = messageBox.addButton(QMessageBox::Cancel);
+	Q_UNUSED(buttonCancel)
+
+	messageBox.exec();
+	if (messageBox.clickedButton() == buttonDiscard) {
+		QFile::remove(journalName);
+		return false;
+	}
+
+	if (messageBox.clickedButton() != buttonRecover) {
+		keepJournal(journalName);
+		return false;
+	}
+
+	QString error;
+	if (!EditJournal::replay(journalName, base, text, &error)) {
+		QMessageBox::warning(this, tr("Recover File"), tr("The changes to %1 can't be recovered:\n%2").arg(info_->filename, error));
+		keepJournal(journalName);
+		return false;
+	}
+
+	return true;
+}
+
+/*
+** Move an incremental backup which wasn't recovered from out of the way, since
+** the first change to the document starts a new one under the same name. If it
+** can't be moved, incremental backup is turned off for the document instead.
+*/
+void DocumentWidget::keepJournal(const QString &journalName) {
+
+	QString keptName;
+	for (int i = 1;; ++i) {
+		keptName = journalName + QLatin1Char('.') + QString::number(i);
+		if (!QFile::exists(keptName)) {
+			break;
+		}
+	}
+
+	if (QFile::rename(journalName, keptName)) {
+		QMessageBox::information(this, tr("Recover File"), tr("The unsaved changes to %1 have been kept in %2.").arg(info_->filename, keptName));
+		return;
+	}
+
+	QMessageBox::warning(
+		this,
+		tr("Recover File"),
+		tr("The backup file %1 can't be moved out of the way.\nAutomatic backup of %2 is now off, so that it isn't overwritten").arg(journalName, info_->filename));
+
+	info_->autoSave = false;
+
+	if (auto win = MainWindow::fromDocument(this)) {
+		if (isTopDocument()) {
+			no_signals(win->ui.action_Incremental_Backup)->setChecked(false);
+		}
+	}
+}
+
+/*
+** Start reading the file in the background, adding it to the document a
+** piece at a time. Until all of it has been read, the document is read-only.
+*/
+void DocumentWidget::startLoading(const QString &fileName, int64_t size) {
+
+	loader_ = std::make_unique<FileLoader>(fileName, Preferences::GetPrefForceOSConversion());
+
+	/* converting the file from DOS format only ever makes it smaller, so this
+	   is all the room it needs, unless it's compressed */
+	info_->ignoreModify = true;
+	info_->buffer->BufSetAll(view::string_view());
+	info_->buffer->BufReserve(size);
+	info_->ignoreModify = false;
+
+	info_->lockReasons.setLoadingLocked(true);
+	loadSize_     = size;
+	loadCapacity_ = size;
+
+	loader_->start();
+	loadTimer_->start();
+
+	ui.buttonCancelLoad->show();
+	setModeMessage(tr("Loading %1 ...").arg(info_->filename));
+}
+
+/*
+** Add the text read since the last time to the end of the document being
+** loaded, which also updates the line count and the scroll bars.
+*/
+void DocumentWidget::appendLoadedText() {
+
+	const std::string text = loader_->takeText();
+	if (text.empty()) {
+		return;
+	}
+
+	// a decompressed file outgrows the room reserved for it, so make more a lot at a time
+	const int64_t needed = info_->buffer->length() + static_cast<int64_t>(text.size());
+	if (needed > loadCapacity_) {
+		loadCapacity_ = std::max(needed, loadCapacity_ * 2);
+		info_->buffer->BufReserve(loadCapacity_);
+	}
+
+	info_->ignoreModify = true;
+	info_->buffer->BufAppend(text);
+	info_->ignoreModify = false;
+}
+
+/**
+ * @brief DocumentWidget::updateLoading
+ */
+void DocumentWidget::updateLoading() {
+
+	if (!loader_) {
+		return;
+	}
+
+	if (loader_->isFinished()) {
+		finishLoading();
+		return;
+	}
+
+	appendLoadedText();
+
+	const int64_t percent = loadSize_ > 0 ? (loader_->bytesRead() * 100) / loadSize_ : 100;
+	setModeMessage(tr("Loading %1 ... %2%").arg(info_->filename).arg(percent));
+}
+
+/*
+** Wait for the rest of the file to be read, or for reading it to be given up
+** after a cancel, and add it to the document. A document which was loaded
+** completely can be edited from now on, one which wasn't stays read-only.
+*/
+void DocumentWidget::finishLoading() {
+
+	if (!loader_) {
+		return;
+	}
+
+	loadTimer_->stop();
+	loader_->waitForFinished();
+	appendLoadedText();
+
+	const QString error   = loader_->errorString();
+	const QByteArray hash = loader_->hash();
+
+	if (error.isEmpty() && !hash.isEmpty()) {
+		info_->fileHash = hash;
+		if (Preferences::GetPrefForceOSConversion()) {
+			info_->fileFormat = loader_->format();
+		}
+
+		info_->lockReasons.setLoadingLocked(false);
+	}
+
+	loader_ = nullptr;
+	ui.buttonCancelLoad->hide();
+	clearModeMessage();
+
+	if (!error.isEmpty()) {
+		QMessageBox::critical(this, tr("Error while opening File"), tr("Error reading %1\n%2").arg(info_->filename, error));
+	}
+
+	Q_EMIT updateWindowTitle(this);
+	Q_EMIT updateWindowReadOnly(this);
+}
+
+/**
+ * @brief DocumentWidget::cancelLoading
+ */
+void DocumentWidget::cancelLoading() {
+	if (loader_) {
+		loader_->cancel();
+		finishLoading();
+	}
+}
+
+/*
+** Throw away a load which is still going on, such as when another file is
+** about to be opened in its place.
+*/
+void DocumentWidget::stopLoading() {
+
+	if (!loader_) {
+		return;
+	}
+
+	loadTimer_->stop();
+	loader_ = nullptr;
+	ui.buttonCancelLoad->hide();
+	clearModeMessage();
+	info_->lockReasons.setLoadingLocked(false);
+}
+
+/*
+** Put off reading the file named name in the directory path until the
+** document is first raised, recording only what is needed to show its tab
+** and to open it later. Returns false if the file isn't one which can simply
+** be read later, such as one which doesn't exist yet.
+*/
+bool DocumentWidget::deferOpen(const QString &name, const QString &path, int flags, const QString &languageMode) {
+
+	const QString fullname = tr("%1%2").arg(path, name);
+
+	QT_STATBUF statbuf;
+	if (!QFileInfo(fullname).isFile() || QT_STAT(fullname.toUtf8().data(), &statbuf) != 0) {
+		return false;
+	}
+
+	stopLoading();
+	unwatchFile();
+	setPath(path);
+	info_->filename    = name;
+	info_->filenameSet = true;
+	info_->fileMissing = false;
+	info_->mode        = statbuf.st_mode;
+	info_->uid         = statbuf.st_uid;
+	info_->gid         = statbuf.st_gid;
+	info_->lastModTime = statbuf.st_mtime;
+	info_->dev         = statbuf.st_dev;
+	info_->ino         = statbuf.st_ino;
+	info_->fileSize    = statbuf.st_size;
+	info_->fileHash.clear();
+
+	if ((flags & EditFlags::PREF_READ_ONLY) != 0) {
+		info_->lockReasons.setUserLocked(true);
+	}
+
+	deferredOpen_ = DeferredOpen{flags, languageMode};
+
+	if (Preferences::GetPrefPrefetchDeferred()) {
+		schedulePrefetch();
+	}
+
+	return true;
+}
+
+/*
+** Read the file of a document whose opening was put off, and do everything
+** else that opening it in the foreground would have done. If it can't be
+** read after all, the document is closed.
+*/
+void DocumentWidget::openDeferred() {
+
+	if (!deferredOpen_) {
+		return;
+	}
+
+	const DeferredOpen deferred = *deferredOpen_;
+	deferredOpen_               = boost::none;
+
+	MainWindow *win = MainWindow::fromDocument(this);
+	if (!win) {
+		return;
+	}
+
+	if (!doOpen(info_->filename, info_->path, deferred.flags)) {
+		// this may be called while the tab is being switched to, so let that finish first
+		QTimer::singleShot(0, this, [this]() {
+			closeDocument();
+		});
+		return;
+	}
+
+	win->forceShowLineNumbers();
+
+	if (deferred.languageMode.isNull()) {
+		determineLanguageMode(/*forceNewDefaults=*/true);
+	} else {
+		action_Set_Language_Mode(deferred.languageMode, /*forceNewDefaults=*/true);
+	}
+
+	refreshTabState();
+
+	Q_EMIT updateWindowTitle(this);
+	Q_EMIT updateWindowReadOnly(this);
+	Q_EMIT updateStatus(this, nullptr);
+}
+
+/*
+** Read the next file whose opening was put off, a little while from now, and
+** carry on like that until there are none left. Reading them one at a time,
+** a little while apart, lets the user carry on in between.
+*/
+void DocumentWidget::schedulePrefetch() {
+
+	static bool scheduled = false;
+	if (scheduled) {
+		return;
+	}
+
+	scheduled = true;
+	QTimer::singleShot(PrefetchInterval, []() {
+		scheduled = false;
+
+		for (DocumentWidget *document : DocumentWidget::allDocuments()) {
+			if (document->deferredOpen_) {
+				document->openDeferred();
+				schedulePrefetch();
+				return;
+			}
+		}
+	});
+}
+
+/*
+** Read the file if that was put off, or bring the text back from
+** hibernation, so that the document is just as if it had always been in
+** memory.
+*/
+void DocumentWidget::makeResident() {
+	openDeferred();
+	wake();
+}
+
+/**
+ * @brief DocumentWidget::residence
+ * @return
+ */
+Residence DocumentWidget::residence() const {
+
+	if (deferredOpen_) {
+		return Residence::NotRead;
+	}
+
+	if (hibernation_) {
+		return hibernation_->snapshot ? Residence::Snapshot : Residence::Hibernated;
+	}
+
+	if (info_->mappedFile) {
+		return Residence::Mapped;
+	}
+
+	return Residence::Memory;
+}
+
+/*
+** How much memory the text of the document, its highlighting and its undo
+** history take up. Text viewed straight from the file doesn't count, since it
+** isn't really in memory.
+*/
+MemoryUsage DocumentWidget::memoryUsage() const {
+
+	MemoryUsage usage;
+
+	if (!info_->mappedFile) {
+		usage.text = info_->buffer->BufCapacity();
+	}
+
+	if (highlightData_ && highlightData_->styleBuffer) {
+		usage.styles = highlightData_->styleBuffer->BufCapacity();
+	}
+
+	for (const std::deque<UndoInfo> *list : {&info_->undo, &info_->redo}) {
+		for (const UndoInfo &info : *list) {
+			usage.undo += static_cast<int64_t>(sizeof(UndoInfo) + info.oldText.capacity());
+		}
+	}
+
+	if (hibernation_ && hibernation_->snapshot) {
+		usage.snapshot = hibernation_->snapshot->size();
+	}
+
+	return usage;
+}
+
+/*
+** Free the memory the text of the document and its highlighting take up,
+** until it's raised again. An unmodified document also lets go of its undo
+** history and is read from its file again. A modified one is written to a
+** temporary file instead, compressed if possible, and keeps its undo
+** history, which is what the text comes back to. Returns false if the
+** document can't be hibernated right now.
+*/
+bool DocumentWidget::hibernate() {
+
+	// the document must be out of sight and nothing must be working on it
+	if (hibernation_ || deferredOpen_ || isTopDocument() || loader_ || info_->mappedFile || saveWatcher_ || macroCmdData_ || shellCmdData_) {
+		return false;
+	}
+
+	if (info_->buffer->BufIsEmpty()) {
+		return false;
+	}
+
+	// emptying the buffer would collapse every range set, such as the matches
+	// of Mark All or ones made by macros, and there would be no bringing them back
+	if (rangesetTable_) {
+		const std::vector<Rangeset> &sets = rangesetTable_->sets_;
+		if (std::any_of(sets.begin(), sets.end(), [](const Rangeset &set) { return set.size() != 0; })) {
+			return false;
+		}
+	}
+
+	auto hibernation = std::make_unique<Hibernation>();
+
+	for (TextArea *area : textPanes()) {
+		hibernation->panes.emplace_back(area->cursorPos(), area->verticalScrollBar()->value());
+	}
+
+	hibernation->selection = info_->buffer->BufGetSelectionPos();
+
+	const bool canReread = info_->filenameSet && !info_->fileChanged && !info_->fileMissing;
+	if (canReread) {
+		clearUndoList();
+		clearRedoList();
+	} else {
+		// the backup has to be up to date, since it can't be written while the text is gone
+		if (journal_->isOpen() && !writeBackupFile()) {
+			return false;
+		}
+
+		auto file = std::make_unique<QTemporaryFile>(QDir(QDir::tempPath()).filePath(QLatin1String("nedit-ng-XXXXXX")));
+		if (!file->open()) {
+			return false;
+		}
+
+		const Codec *codec                                             = DefaultCodec();
+		const std::pair<view::string_view, view::string_view> segments = info_->buffer->BufAsSegments();
+
+		QString error;
+		if (!WriteTextFile(file.get(), segments.first, segments.second, FileFormats::Unix, &error, nullptr, codec)) {
+			return false;
+		}
+
+		hibernation->snapshot = std::move(file);
+		hibernation->codec    = codec;
+	}
+
+	stopHighlighting();
+
+	// the text's memory has to actually be given back, not just emptied
+	info_->ignoreModify = true;
+	info_->buffer->BufDiscardAll();
+	info_->ignoreModify = false;
+
+	Q_ASSERT(memoryUsage().text <= gap_buffer<char>::PreferredGapSize);
+
+	hibernation_ = std::move(hibernation);
+	return true;
+}
+
+/*
+** Bring back the text of a hibernated document, from its snapshot or from
+** its file, and put the panes back where they were. Highlighting starts up
+** again once the document is raised.
+*/
+void DocumentWidget::wake() {
+
+	if (!hibernation_) {
+		return;
+	}
+
+	const std::unique_ptr<Hibernation> hibernation = std::move(hibernation_);
+
+	if (hibernation->snapshot) {
+		QTemporaryFile *file  = hibernation->snapshot.get();
+		const QByteArray data = file->seek(0) ? file->readAll() : QByteArray();
+
+		std::string text(data.constData(), static_cast<size_t>(data.size()));
+
+		QString error = file->errorString();
+		if (data.size() == file->size() && (!hibernation->codec || Decompress(hibernation->codec, view::string_view(data.constData(), static_cast<size_t>(data.size())), &text, &error))) {
+			info_->ignoreModify = true;
+			info_->buffer->BufSetAll(text);
+			info_->ignoreModify = false;
+		} else {
+			/* the snapshot is all there is of the changes, so leave it for the
+			   user, and don't let the empty document be saved. The lock has a
+			   reason of its own, so that stopping a load can't lift it */
+			file->setAutoRemove(false);
+			info_->lockReasons.setRestoreLocked(true);
+			Q_EMIT updateWindowReadOnly(this);
+			QMessageBox::critical(this, tr("Error restoring Document"), tr("The text of %1 couldn't be read back from %2:\n%3").arg(info_->filename, file->fileName(), error));
+			return;
+		}
+	} else {
+		const int flags = info_->lockReasons.isUserLocked() ? EditFlags::PREF_READ_ONLY : 0;
+		if (!doOpen(info_->filename, info_->path, flags)) {
+			// this may be called while the tab is being switched to, so let that finish first
+			QTimer::singleShot(0, this, [this]() {
+				closeDocument();
+			});
+			return;
+		}
+	}
+
+	const std::vector<TextArea *> panes = textPanes();
+	for (size_t i = 0; i < panes.size() && i < hibernation->panes.size(); ++i) {
+		panes[i]->TextSetCursorPos(std::min(hibernation->panes[i].first, info_->buffer->BufEndOfBuffer()));
+		panes[i]->verticalScrollBar()->setValue(hibernation->panes[i].second);
+	}
+
+	// the file may have changed in the meantime, in which case the selection no longer means anything
+	if (hibernation->selection && hibernation->selection->end <= info_->buffer->BufEndOfBuffer()) {
+		const SelectionPos &selection = *hibernation->selection;
+		if (selection.isRect) {
+			info_->buffer->BufRectSelect(selection.start, selection.end, selection.rectStart, selection.rectEnd);
+		} else {
+			info_->buffer->BufSelect(selection.start, selection.end);
+		}
+	}
 
-		} else if (flags & EditFlags::CREATE && errno == ENOENT) {
-			// Give option to create (or to exit if this is the only window)
-			if (!(flags & EditFlags::SUPPRESS_CREATE_WARN)) {
+	Q_EMIT updateWindowTitle(this);
+	Q_EMIT updateWindowReadOnly(this);
+	Q_EMIT updateStatus(this, nullptr);
+}
 
-				QMessageBox msgbox(this);
-				msgbox.setIcon(QMessageBox::Warning);
-				msgbox.setWindowTitle(tr("New File"));
-				msgbox.setText(tr("Can't open %1:\n%2").arg(fullname, errorString(errno)));
+/*
+** When the open documents take up more than limit bytes of memory, hibernate
+** the ones which were raised longest ago until the rest fit, or until there
+** are none left which can be. Unmodified documents go first, since they're
+** the quickest to bring back.
+*/
+void DocumentWidget::reclaimMemory(int64_t limit) {
 
-				QAbstractButton *exitButton   = nullptr;
-				QAbstractButton *cancelButton = msgbox.addButton(QMessageBox::Cancel);
-				QAbstractButton *newButton    = msgbox.addButton(tr("New File"), QMessageBox::AcceptRole);
+	std::vector<DocumentWidget *> documents = allDocuments();
 
-				// ask user for next action if file not found
-				std::vector<DocumentWidget *> documents = DocumentWidget::allDocuments();
+	int64_t total = 0;
+	for (DocumentWidget *document : documents) {
+		total += document->memoryUsage().total();
+	}
 
-				if (documents.size() == 1 && documents.front() == this) {
-					exitButton = msgbox.addButton(tr("Exit NEdit"), QMessageBox::RejectRole);
-				}
+	std::sort(documents.begin(), documents.end(), [](const DocumentWidget *lhs, const DocumentWidget *rhs) {
+		if (lhs->info_->fileChanged != rhs->info_->fileChanged) {
+			return rhs->info_->fileChanged;
+		}
 
-				Q_UNUSED(newButton)
+		return lhs->lastRaised_ < rhs->lastRaised_;
+	});
 
-				msgbox.exec();
+	for (DocumentWidget *document : documents) {
+		if (total <= limit) {
+			break;
+		}
 
-				if (msgbox.clickedButton() == cancelButton) {
-					return false;
-				} else if (msgbox.clickedButton() == exitButton) {
-					// NOTE(eteran): we use ::exit here because if we got here
-					// it's because we failed to open the initial documents on
-					// launch and the user has opted to no longer continue
-					// running nedit-ng
-					::exit(0);
-				}
-			}
+		const int64_t before = document->memoryUsage().total();
+		if (document->hibernate()) {
+			total -= before - document->memoryUsage().total();
+		}
+	}
+}
 
-			// Test if new file can be created
-			const int fd = QT_OPEN(fullname.toUtf8().data(), QT_OPEN_CREAT | QT_OPEN_WRONLY | QT_OPEN_TRUNC, 0666);
-			if (fd == -1) {
-				QMessageBox::critical(this, tr("Error creating File"), tr("Can't create %1:\n%2").arg(fullname, errorString(errno)));
-				return false;
-			} else {
-				QT_CLOSE(fd);
-				QFile::remove(fullname);
-			}
+/*
+** Check how much memory the documents take up a little while from now, once
+** whatever made them take up more has settled down, if there is a limit.
+*/
+void DocumentWidget::scheduleReclaim() {
 
-			setWindowModified(false);
-			if ((flags & EditFlags::PREF_READ_ONLY) != 0) {
-				info_->lockReasons.setUserLocked(true);
-			}
+	static bool scheduled = false;
+	if (scheduled || Preferences::GetPrefDocumentMemoryLimit() <= 0) {
+		return;
+	}
 
-			Q_EMIT updateWindowReadOnly(this);
-			return true;
-		} else {
-			// A true error
-			QMessageBox::critical(this, tr("Error opening File"), tr("Could not open %1%2:\n%3").arg(path, name, errorString(errno)));
-			return false;
+	scheduled = true;
+	QTimer::singleShot(ReclaimDelay, []() {
+		scheduled = false;
+
+		// the limit may have been turned off in the meantime
+		const int64_t limit = static_cast<int64_t>(Preferences::GetPrefDocumentMemoryLimit()) * 1024 * 1024;
+		if (limit > 0) {
+			reclaimMemory(limit);
 		}
-	}
+	});
+}
 
-	auto _ = gsl::finally([fp] { ::fclose(fp); });
+/*
+** Show the file named fileName by mapping it into memory and lending the
+** mapping to the buffer, rather than copying it in. The file is still read
+** through once, when the lines are counted, but its pages stay in the system's
+** file cache instead of taking up memory of our own. Files which would need
+** converting from DOS or Macintosh format can't be shown this way.
+** Highlighting waits until the document is converted into a normal buffer by
+** convertMappedFile, since it would keep all of the file in memory.
+*/
+bool DocumentWidget::mapFile(const QString &fileName) {
 
-	/* Get the length of the file, the protection mode, and the time of the
-	   last modification to the file */
-	QT_STATBUF statbuf;
-	if (QT_FSTAT(QT_FILENO(fp), &statbuf) != 0) {
-		info_->filenameSet = false; // Temp. prevent check for changes.
-		QMessageBox::critical(this, tr("Error opening File"), tr("Error opening %1").arg(name));
-		info_->filenameSet = true;
+	auto file = std::make_unique<QFile>(fileName);
+	if (!file->open(QIODevice::ReadOnly)) {
 		return false;
 	}
 
-#ifdef Q_OS_WIN
-// Copied from linux libc sys/stat.h:
-#define S_ISREG(m) (((m)&S_IFMT) == S_IFREG)
-#define S_ISDIR(m) (((m)&S_IFMT) == S_IFDIR)
-#endif
-
-	if (S_ISDIR(statbuf.st_mode)) {
-		info_->filenameSet = false; // Temp. prevent check for changes.
-		QMessageBox::critical(this, tr("Error opening File"), tr("Can't open directory %1").arg(name));
-		info_->filenameSet = true;
+	// a private mapping, so that the text is never written back to the file, whatever happens to it
+	const int64_t size = file->size();
+	uchar *memory      = file->map(0, size, QFileDevice::MapPrivateOption);
+	if (!memory) {
 		return false;
 	}
 
-#ifdef S_ISBLK
-	if (S_ISBLK(statbuf.st_mode)) {
-		info_->filenameSet = false; // Temp. prevent check for changes.
-		QMessageBox::critical(this, tr("Error opening File"), tr("Can't open block device %1").arg(name));
-		info_->filenameSet = true;
+	/* The file may be cut short while it is shown, as log files are by
+	   "copytruncate" rotation, and anything from a repaint to a search on
+	   another thread may read the part which is gone before we hear of it.
+	   Those reads find zeros, until the file is read again */
+	char *text = reinterpret_cast<char *>(memory);
+	if (!GuardMapping(text, size)) {
 		return false;
 	}
-#endif
 
-	// Allocate space for the whole contents of the file (unfortunately)
-	try {
-		QFile file;
-		// TODO(eteran): error checking on this open?
-		file.open(fp, QIODevice::ReadOnly);
+	std::shared_ptr<QFile> mapping(file.release(), [text](QFile *mappedFile) {
+		UnguardMapping(text);
+		delete mappedFile;
+	});
 
-		std::string text;
+	FileFormats format = FileFormats::Unix;
+	if (Preferences::GetPrefForceOSConversion()) {
+		format = FormatOfFile(view::string_view(text, static_cast<size_t>(std::min<int64_t>(size, MappedViewSize))));
+		if (format != FileFormats::Unix) {
+			return false;
+		}
+	}
 
-		if (file.size() != 0) {
-			uchar *memory = file.map(0, file.size());
-			if (!memory) {
-				info_->filenameSet = false; // Temp. prevent check for changes.
-				QMessageBox::critical(this, tr("Error while opening File"), tr("Error reading %1\n%2").arg(name, file.errorString()));
-				info_->filenameSet = true;
-				return false;
-			}
+	stopHighlighting();
 
-			text = std::string{reinterpret_cast<char *>(memory), static_cast<size_t>(file.size())};
-			file.unmap(memory);
-		}
+	info_->fileFormat   = format;
+	info_->ignoreModify = true;
+	info_->buffer->BufSetAllBorrowed(text, size);
+	info_->ignoreModify = false;
 
-		/* Any errors that happen after this point leave the window in a
-		 * "broken" state, and thus RevertToSaved will abandon the window if
-		 * info_->fileMissing is false and doOpen fails. */
-		info_->mode        = statbuf.st_mode;
-		info_->uid         = statbuf.st_uid;
-		info_->gid         = statbuf.st_gid;
-		info_->lastModTime = statbuf.st_mtime;
-		info_->dev         = statbuf.st_dev;
-		info_->ino         = statbuf.st_ino;
-		info_->fileMissing = false;
+	// the buffer no longer uses the file it was viewing before, if any
+	info_->mappedFile = std::move(mapping);
+	return true;
+}
 
-		// Detect and convert DOS and Macintosh format files
-		if (Preferences::GetPrefForceOSConversion()) {
-			info_->fileFormat = FormatOfFile(text);
-			switch (info_->fileFormat) {
-			case FileFormats::Dos:
-				ConvertFromDos(text);
-				break;
-			case FileFormats::Mac:
-				ConvertFromMac(text);
-				break;
-			case FileFormats::Unix:
-				break;
-			}
-		}
+/*
+** The file a document is viewed straight from may have changed. If it has been
+** cut short, the part of the mapping past its new end reads as zeros (see
+** mapFile), so the file is read again to show what is really in it. Files
+** which are mapped can't be cut short on Windows, so there is nothing to do
+** there.
+*/
+void DocumentWidget::mappedFileChanged() {
 
-		// Display the file contents in the text widget
-		info_->ignoreModify = true;
-		info_->buffer->BufSetAll(text);
-		info_->ignoreModify = false;
+	if (!info_->mappedFile || !info_->buffer->BufIsBorrowed()) {
+		return;
+	}
 
-		// Set window title and file changed flag
-		if ((flags & EditFlags::PREF_READ_ONLY) != 0) {
-			info_->lockReasons.setUserLocked(true);
-		}
+#ifdef Q_OS_UNIX
+	// the file as it is now, even if it has since been renamed or replaced
+	QT_STATBUF statbuf;
+	if (QT_FSTAT(info_->mappedFile->handle(), &statbuf) != 0) {
+		return;
+	}
 
-		if (info_->lockReasons.isPermLocked()) {
-			info_->fileChanged = false;
-			Q_EMIT updateWindowTitle(this);
-		} else {
-			setWindowModified(false);
-			if (info_->lockReasons.isAnyLocked()) {
-				Q_EMIT updateWindowTitle(this);
-			}
-		}
+	if (statbuf.st_size >= info_->buffer->length()) {
+		return;
+	}
 
-		Q_EMIT updateWindowReadOnly(this);
+	// let go of the old text without copying it, then read the file again
+	info_->ignoreModify = true;
+	info_->buffer->BufDiscardAll();
+	info_->ignoreModify = false;
+
+	revertToSaved();
+#endif
+}
+
+/*
+** Turn a document which is viewed straight from its file into a normal one,
+** which can be edited, by copying the text out of the file. Returns false if
+** there isn't the memory for it.
+*/
+bool DocumentWidget::convertMappedFile() {
+
+	if (!info_->mappedFile) {
 		return true;
+	}
+
+	MainWindow::allDocumentsBusy(tr("Reading %1 ...").arg(info_->filename));
+
+	auto _ = gsl::finally([]() {
+		MainWindow::allDocumentsUnbusy();
+	});
+
+	try {
+		info_->buffer->BufDetach();
 	} catch (const std::bad_alloc &) {
-		info_->filenameSet = false; // Temp. prevent check for changes.
 		QMessageBox::critical(this, tr("Error while opening File"), tr("File is too large to edit"));
-		info_->filenameSet = true;
 		return false;
 	}
+
+	releaseMappedFile();
+
+	// the highlighting which was put off until now
+	if (highlightSyntax_ && !highlightData_) {
+		startHighlighting(Verbosity::Silent);
+	}
+
+	return true;
+}
+
+/**
+ * @brief DocumentWidget::mappedFile
+ * @return the file the document is viewed straight from, if it is
+ */
+std::shared_ptr<QFile> DocumentWidget::mappedFile() const {
+	return info_->mappedFile;
+}
+
+/*
+** Let go of the file the document was viewed straight from, once the buffer
+** no longer borrows its text.
+*/
+void DocumentWidget::releaseMappedFile() {
+	if (info_->mappedFile && !info_->buffer->BufIsBorrowed()) {
+		info_->mappedFile = nullptr;
+	}
 }
 
 /*
@@ -3405,7 +4643,7 @@ void DocumentWidget::executeNewlineMacro(SmartIndentEvent *event) {
 			return;
 		}
 
-		event->request = to_integer(result);
+		event->request = static_cast<int>(to_integer(result));
 	}
 }
 
@@ -5013,7 +6251,7 @@ void DocumentWidget::doShellMenuCmd(MainWindow *inWindow, TextArea *area, const
 
 	// If the command requires the file be saved first, save it
 	if (saveFirst) {
-		if (!saveDocument()) {
+		if (!saveDocument() || !waitForSave()) {
 			if (input != FROM_NONE) {
 				return;
 			}
@@ -5107,7 +6345,7 @@ void DocumentWidget::repeatMacro(const QString &macro, int how) {
 	// Parse the resulting macro into an executable program "prog"
 	QString errMsg;
 	int stoppedAt;
-	Program *const prog = compileMacro(loopedCmd, &errMsg, &stoppedAt);
+	std::shared_ptr<Program> prog = compileMacroCached(loopedCmd, &errMsg, &stoppedAt);
 	if (!prog) {
 		qWarning("NEdit: internal error, repeat macro syntax wrong: %s", qPrintable(errMsg));
 		return;
@@ -5208,15 +6446,19 @@ bool DocumentWidget::readMacroFile(const QString &fileName, bool warnNotExist) {
 /*
 ** Run a pre-compiled macro, changing the interface state to reflect that
 ** a macro is running, and handling preemption, resumption, and cancellation.
-** frees prog when macro execution is complete;
+** releases prog when macro execution is complete;
 */
-void DocumentWidget::runMacro(Program *prog) {
+void DocumentWidget::runMacro(const std::shared_ptr<Program> &prog) {
+
+	// the macro may well want the text of the file
+	makeResident();
 
 	/* If a macro is already running, just call the program as a subroutine,
 	   instead of starting a new one, so we don't have to keep a separate
 	   context, and the macros will serialize themselves automatically */
 	if (macroCmdData_) {
-		RunMacroAsSubrCall(prog);
+		RunMacroAsSubrCall(prog.get());
+		macroCmdData_->subPrograms.push_back(prog);
 		return;
 	}
 
@@ -5234,7 +6476,7 @@ void DocumentWidget::runMacro(Program *prog) {
 	auto cmdData               = std::make_unique<MacroCommandData>();
 	cmdData->bannerIsUp        = false;
 	cmdData->closeOnCompletion = false;
-	cmdData->program           = std::unique_ptr<Program>(prog);
+	cmdData->program           = prog;
 	cmdData->context           = nullptr;
 
 	macroCmdData_ = std::move(cmdData);
@@ -5247,7 +6489,7 @@ void DocumentWidget::runMacro(Program *prog) {
 	// Begin macro execution
 	DataValue result;
 	QString errMsg;
-	const int stat = executeMacro(this, prog, {}, &result, macroCmdData_->context, &errMsg);
+	const int stat = executeMacro(this, prog.get(), {}, &result, macroCmdData_->context, &errMsg);
 
 	switch (stat) {
 	case MACRO_ERROR:
@@ -5891,6 +7133,11 @@ void DocumentWidget::handleUnparsedRegion(const std::shared_ptr<TextBuffer> &sty
 */
 void DocumentWidget::startHighlighting(Verbosity verbosity) {
 
+	// a file viewed straight from disk isn't read all the way through just to highlight it
+	if (info_->mappedFile) {
+		return;
+	}
+
 	/* Find the pattern set matching the window's current
 	   language mode, tell the user if it can't be done */
 	PatternSet *patterns = findPatternsForWindow(verbosity);
@@ -6539,7 +7786,7 @@ void DocumentWidget::replay() {
 		QString errMsg;
 		int stoppedAt;
 
-		Program *prog = compileMacro(replayMacro, &errMsg, &stoppedAt);
+		std::shared_ptr<Program> prog = compileMacroCached(replayMacro, &errMsg, &stoppedAt);
 		if (!prog) {
 			qWarning("NEdit: internal error, learn/replay macro syntax error: %s", qPrintable(errMsg));
 			return;
@@ -6612,13 +7859,13 @@ void DocumentWidget::doMacro(const QString &macro, const QString &errInName) {
 
 	// Parse the macro and report errors if it fails
 	int stoppedAt;
-	Program *const prog = compileMacro(qMacro, &errMsg, &stoppedAt);
+	std::shared_ptr<Program> prog = compileMacroCached(qMacro, &errMsg, &stoppedAt);
 	if (!prog) {
 		Preferences::reportError(this, qMacro, stoppedAt, errInName, errMsg);
 		return;
 	}
 
-	// run the executable program (prog is freed upon completion)
+	// run the executable program
 	runMacro(prog);
 }
 
@@ -6834,6 +8081,10 @@ bool DocumentWidget::userLocked() const {
 void DocumentWidget::setUserLocked(bool value) {
 	emit_event("set_locked", QString::number(value));
 
+	if (!value && !convertMappedFile()) {
+		return;
+	}
+
 	info_->lockReasons.setUserLocked(value);
 
 	if (!isTopDocument()) {
@@ -6970,6 +8221,66 @@ LockReasons DocumentWidget::lockReasons() const {
 	return info_->lockReasons;
 }
 
+/**
+ * @brief DocumentWidget::markAll
+ * @param searchString
+ * @param searchType
+ * @return the label of the rangeset holding every match of searchString, or
+ * 0 if there are no rangesets left
+ */
+int DocumentWidget::markAll(const QString &searchString, SearchType searchType) {
+
+	if (!rangesetTable_) {
+		rangesetTable_ = std::make_unique<RangesetTable>(buffer());
+	}
+
+	// each Mark All replaces the marks of the previous one, keeping any color
+	// a macro has since given them, rather than using up another rangeset
+	// every time. A macro may also have destroyed that rangeset and reused its
+	// label, so check that it is still ours
+	QString color      = QLatin1String(MarkAllColor);
+	Rangeset *previous = rangesetTable_->RangesetFetch(markAllLabel_);
+	if (previous && previous->name() == QLatin1String(MarkAllName)) {
+		color = previous->color_name_;
+		rangesetTable_->forgetLabel(markAllLabel_);
+	}
+
+	markAllLabel_ = rangesetTable_->RangesetCreate();
+
+	Rangeset *rangeset = rangesetTable_->RangesetFetch(markAllLabel_);
+	if (!rangeset) {
+		return 0;
+	}
+
+	const std::vector<Search::Result> matches = Search::FindAll(
+		buffer()->BufAsString(),
+		searchString,
+		searchType,
+		getWindowDelimiters());
+
+	// the matches are already in order, so the table can be built directly
+	// rather than inserting (and merging) them one at a time
+	std::vector<TextRange> &ranges = rangeset->ranges_;
+	ranges.reserve(matches.size());
+
+	for (const Search::Result &match : matches) {
+		if (match.start == match.end) {
+			continue;
+		}
+
+		if (!ranges.empty() && ranges.back().end >= TextCursor(match.start)) {
+			ranges.back().end = TextCursor(match.end);
+		} else {
+			ranges.push_back({TextCursor(match.start), TextCursor(match.end)});
+		}
+	}
+
+	// this also redraws the new ranges
+	rangeset->setName(QLatin1String(MarkAllName));
+	rangeset->setColor(buffer(), color);
+	return markAllLabel_;
+}
+
 /*      Finds all matches and handles tag "collisions". Prompts user with a
 		list of collided tags in the hash table and allows the user to select
 		the correct one. */
@@ -7016,6 +8327,7 @@ int DocumentWidget::findAllMatches(TextArea *area, const QString &string) {
 
 		Tags::tagSearch[nMatches] = searchString;
 		Tags::tagPosInf[nMatches] = startPos;
+		Tags::tagLine[nMatches]   = tag.line;
 
 		PathInfo fi = parseFilename(Tags::tagFiles[nMatches]);
 
@@ -7025,6 +8337,7 @@ int DocumentWidget::findAllMatches(TextArea *area, const QString &string) {
 				Tags::tagFiles[0]  = Tags::tagFiles[nMatches];
 				Tags::tagSearch[0] = Tags::tagSearch[nMatches];
 				Tags::tagPosInf[0] = Tags::tagPosInf[nMatches];
+				Tags::tagLine[0]   = Tags::tagLine[nMatches];
 			}
 			nMatches = 1;
 			break;
@@ -7052,6 +8365,7 @@ int DocumentWidget::findAllMatches(TextArea *area, const QString &string) {
 		Tags::tagFiles[0]  = Tags::tagFiles[pathMatch];
 		Tags::tagSearch[0] = Tags::tagSearch[pathMatch];
 		Tags::tagPosInf[0] = Tags::tagPosInf[pathMatch];
+		Tags::tagLine[0]   = Tags::tagLine[pathMatch];
 		nMatches           = 1;
 	}
 
@@ -7200,13 +8514,25 @@ void DocumentWidget::editTaggedLocation(TextArea *area, int i) {
 	int64_t startPos = tagLineNumber;
 	int64_t endPos;
 
-	// search for the tags file search string in the newly opened file
-	if (!Tags::fakeRegExSearch(documentToSearch->buffer()->BufAsString(), Tags::tagSearch[i], &startPos, &endPos)) {
-		QMessageBox::warning(
-			this,
-			tr("Tag Error"),
-			tr("Definition for %1\nnot found in %2").arg(Tags::tagName, Tags::tagFiles[i]));
-		return;
+	// the same tags are usually visited again and again, while the file they
+	// are in often stays the same in between
+	const QString key = QStringLiteral("%1:%2:%3").arg(QString::number(Tags::tagPosInf[i]), QString::number(Tags::tagLine[i]), Tags::tagSearch[i]);
+
+	auto cached = documentToSearch->tagLocations_.find(key);
+	if (cached != documentToSearch->tagLocations_.end()) {
+		startPos = to_integer(cached->start);
+		endPos   = to_integer(cached->end);
+	} else {
+		// search for the tags file search string in the newly opened file
+		if (!Tags::findTagLocation(documentToSearch->buffer()->BufAsString(), Tags::tagSearch[i], Tags::tagLine[i], &startPos, &endPos)) {
+			QMessageBox::warning(
+				this,
+				tr("Tag Error"),
+				tr("Definition for %1\nnot found in %2").arg(Tags::tagName, Tags::tagFiles[i]));
+			return;
+		}
+
+		documentToSearch->tagLocations_.insert(key, TextRange{TextCursor(startPos), TextCursor(endPos)});
 	}
 
 	// select the matched string
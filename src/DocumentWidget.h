@@ -7,16 +7,19 @@
 #include "CloseMode.h"
 #include "CommandSource.h"
 #include "DocumentInfo.h"
+#include "EditJournal.h"
 #include "ErrorSound.h"
 #include "IndentStyle.h"
 #include "LanguageMode.h"
 #include "LockReasons.h"
+#include "MemoryUsage.h"
 #include "MenuData.h"
 #include "MenuItem.h"
 #include "RangesetTable.h"
 #include "ShowMatchingStyle.h"
 #include "Tags.h"
 #include "TextBufferFwd.h"
+#include "TextRange.h"
 #include "UndoInfo.h"
 #include "Util/FileFormats.h"
 #include "Util/string_view.h"
@@ -25,6 +28,8 @@
 
 #include "ui_DocumentWidget.h"
 
+#include <QFutureWatcher>
+#include <QHash>
 #include <QPointer>
 #include <QProcess>
 #include <QWidget>
@@ -35,6 +40,7 @@
 
 #include <sys/stat.h>
 
+class FileLoader;
 class HighlightPattern;
 class MainWindow;
 class PatternSet;
@@ -53,6 +59,7 @@ struct SmartIndentEvent;
 struct WindowHighlightData;
 
 class QDir;
+class QFileSystemWatcher;
 class QFrame;
 class QLabel;
 class QMenu;
@@ -60,6 +67,7 @@ class QSplitter;
 class QTimer;
 
 enum class Direction : uint8_t;
+enum class SearchType;
 
 class DocumentWidget : public QWidget {
 	Q_OBJECT
@@ -96,6 +104,7 @@ public:
 	static DocumentWidget *editExistingFile(DocumentWidget *inDocument, const QString &name, const QString &path, int flags, const QString &geometry, bool iconic, const QString &languageMode, bool tabbed, bool background);
 	static DocumentWidget *fromArea(TextArea *area);
 	static std::vector<DocumentWidget *> allDocuments();
+	static void reclaimMemory(int64_t limit);
 
 public:
 	void action_Set_Fonts(const QString &fontName);
@@ -108,6 +117,7 @@ public:
 	HighlightPattern *findPatternOfWindow(const QString &name) const;
 	IndentStyle autoIndentStyle() const;
 	LockReasons lockReasons() const;
+	MemoryUsage memoryUsage() const;
 	QColor highlightBGColorOfCode(size_t hCode) const;
 	QColor highlightColorValueOfCode(size_t hCode) const;
 	QFont defaultFont() const;
@@ -121,6 +131,7 @@ public:
 	QString highlightNameOfCode(size_t hCode) const;
 	QString highlightStyleOfCode(size_t hCode) const;
 	QString path() const;
+	Residence residence() const;
 	ShowMatchingStyle showMatchingStyle() const;
 	TextArea *firstPane() const;
 	TextBuffer *buffer() const;
@@ -143,6 +154,7 @@ public:
 	bool showStatisticsLine() const;
 	bool useTabs() const;
 	bool userLocked() const;
+	bool waitForSave();
 	dev_t device() const;
 	ino_t inode() const;
 	int findDefinitionHelperCommon(TextArea *area, const QString &value, Tags::SearchMode search_type);
@@ -153,6 +165,7 @@ public:
 	int64_t styleLengthOfCodeFromPos(TextCursor pos) const;
 	size_t getLanguageMode() const;
 	size_t highlightCodeOfPos(TextCursor pos) const;
+	std::shared_ptr<QFile> mappedFile() const;
 	std::unique_ptr<WindowHighlightData> createHighlightData(PatternSet *patternSet);
 	std::vector<TextArea *> textPanes() const;
 	void abortShellCommand();
@@ -177,6 +190,7 @@ public:
 	void handleUnparsedRegion(const std::shared_ptr<TextBuffer> &styleBuf, TextCursor pos) const;
 	void handleUnparsedRegion(TextBuffer *styleBuf, TextCursor pos) const;
 	void macroBannerTimeoutProc();
+	void makeResident();
 	void makeSelectionVisible(TextArea *area);
 	void moveDocument(MainWindow *fromWindow);
 	void printString(const std::string &string, const QString &jobname);
@@ -187,7 +201,7 @@ public:
 	void readMacroInitFile();
 	void repeatMacro(const QString &macro, int how);
 	void resumeMacroExecution();
-	void runMacro(Program *prog);
+	void runMacro(const std::shared_ptr<Program> &prog);
 	void selectNumberedLine(TextArea *area, int64_t lineNum);
 	void setAutoIndent(IndentStyle indentStyle);
 	void setAutoScroll(int margin);
@@ -221,6 +235,27 @@ public:
 	void updateHighlightStyles();
 	void updateSignals(MainWindow *from, MainWindow *to);
 
+private:
+	// what a save written in the background comes back with
+	struct SaveResult {
+		QString error;   // why the file couldn't be saved, empty if it was
+		QByteArray hash; // hash of what was written
+	};
+
+	// how to open a file whose opening was put off until it's first looked at
+	struct DeferredOpen {
+		int flags;
+		QString languageMode;
+	};
+
+	// what is kept of a document while it's hibernated
+	struct Hibernation;
+
+private:
+	static QFileSystemWatcher *fileWatcher();
+	static void schedulePrefetch();
+	static void scheduleReclaim();
+
 private:
 	MacroContinuationCode continueWorkProc();
 	PatternSet *findPatternsForWindow(Verbosity verbosity);
@@ -231,15 +266,24 @@ private:
 	TextArea *createTextArea(const std::shared_ptr<TextBuffer> &buffer);
 	bool closeFileAndWindow(CloseMode preResponse);
 	bool compareDocumentToFile(const QString &fileName) const;
+	bool convertMappedFile();
+	bool deferOpen(const QString &name, const QString &path, int flags, const QString &languageMode);
 	bool doOpen(const QString &name, const QString &path, int flags);
 	bool doSave();
+	bool fileContentsChanged(const QString &fileName) const;
 	bool fileWasModifiedExternally() const;
+	bool finishBackgroundSave();
+	bool hibernate();
 	bool includeFile(const QString &name);
 	bool macroWindowCloseActions();
+	bool mapFile(const QString &fileName);
+	bool recoverFromJournal(const QString &journalName, const EditJournal::Base &base, std::string *text);
 	bool saveDocument();
 	bool saveDocumentAs(const QString &newName, bool addWrap);
+	bool saveDocumentInBackground();
 	bool writeBackupFile();
 	bool writeBckVersion();
+	boost::optional<EditJournal::Base> journalBase() const;
 	boost::optional<TextCursor> findMatchingChar(char toMatch, Style styleToMatch, TextCursor charPos, TextCursor startLimit, TextCursor endLimit);
 	int findAllMatches(TextArea *area, const QString &string);
 	size_t matchLanguageMode() const;
@@ -251,9 +295,12 @@ private:
 	void addUndoItem(UndoInfo &&undo);
 	void addWrapNewlines();
 	void appendDeletedText(view::string_view deletedText, int64_t deletedLen, Direction direction);
+	void appendLoadedText();
 	void attachHighlightToWidget(TextArea *area);
+	void backupFailed(const QString &error);
 	void beginLearn();
 	void cancelLearning();
+	void cancelLoading();
 	void clearRedoList();
 	void clearUndoList();
 	void closeDocument();
@@ -266,18 +313,25 @@ private:
 	void execCursorLine(TextArea *area, CommandSource source);
 	void executeModMacro(SmartIndentEvent *event);
 	void executeNewlineMacro(SmartIndentEvent *event);
+	void fileChangedOnDisk(const QString &path);
 	void filterSelection(const QString &command, CommandSource source);
 	void finishLearning();
+	void finishLoading();
 	void flashMatchingChar(TextArea *area);
 	void freeHighlightingData();
 	void issueCommand(MainWindow *window, TextArea *area, const QString &command, const QString &input, int flags, TextCursor replaceLeft, TextCursor replaceRight, CommandSource source);
+	void keepJournal(const QString &journalName);
+	void mappedFileChanged();
+	void openDeferred();
 	void processFinished(int exitCode, QProcess::ExitStatus exitStatus);
 	void reapplyLanguageMode(size_t mode, bool forceDefaults);
 	void redo();
 	void refreshMenuBar();
+	void refreshFileStatus();
 	void refreshMenuToggleStates();
 	void refreshTabState();
 	void refreshWindowStates();
+	void releaseMappedFile();
 	void removeBackupFile() const;
 	void removeRedoItem();
 	void removeUndoItem();
@@ -286,19 +340,23 @@ private:
 	void saveUndoInformation(TextCursor pos, int64_t nInserted, int64_t nDeleted, view::string_view deletedText);
 	void setModeMessage(const QString &message);
 	void setWindowModified(bool modified);
+	void startLoading(const QString &fileName, int64_t size);
+	void stopLoading();
 	void trimUndoList(size_t maxLength);
 	void undo();
 	void unloadLanguageModeTipsFile();
+	void unwatchFile();
+	void updateLoading();
 	void updateMarkTable(TextCursor pos, int64_t nInserted, int64_t nDeleted);
 	void updateSelectionSensitiveMenu(QMenu *menu, const gsl::span<MenuData> &menuList, bool enabled);
 	void updateSelectionSensitiveMenus(bool enabled);
+	void wake();
+	void watchFile();
 
 public:
 	std::shared_ptr<DocumentInfo> info_;
 
 public:
-	bool replaceFailed_  = false;               // flags replacements failures during multi-file replacements
-	bool multiFileBusy_  = false;               // suppresses multiple beeps/dialogs during multi-file replacements
 	size_t languageMode_ = PLAIN_LANGUAGE_MODE; // identifies language mode currently selected in the window
 
 public:
@@ -318,9 +376,24 @@ private:
 	QString backlightCharTypes_; // what backlighting to use
 	QString modeMessage_;        // stats line banner content for learn and shell command executing modes
 	QTimer *flashTimer_;         // timer for getting rid of highlighted matching paren.
+	QTimer *loadTimer_;          // timer for adding the text read so far while a large file is loaded
+	EditJournal *journal_;       // the incremental backup of the document
 	bool backlightChars_;        // is char backlighting turned on?
 	std::map<QChar, Bookmark> markTable_;
-	std::unique_ptr<ShellCommandData> shellCmdData_; // when a shell command is executing, info. about it, otherwise, nullptr
+	int markAllLabel_ = 0;                              // rangeset holding the matches of the last Mark All, if any
+	QHash<QString, TextRange> tagLocations_;            // where tags were found in the text as it is now
+	QFutureWatcher<SaveResult> *saveWatcher_ = nullptr; // the save being written in the background, if any
+	int64_t editCount_                       = 0;       // number of changes made to the text so far
+	int64_t savedEditCount_                  = 0;       // value of editCount_ when the text being saved was taken
+	QString watchedPath_;                               // the file being watched for this document, empty if it can't be
+	bool fileCheckPending_ = true;                      // may the file have changed since it was last checked?
+	std::unique_ptr<FileLoader> loader_;                // reads a large file in the background while it's opened
+	int64_t loadSize_     = 0;                          // size of the file being loaded
+	int64_t loadCapacity_ = 0;                          // room reserved in the buffer for the text being loaded
+	boost::optional<DeferredOpen> deferredOpen_;        // set while the file hasn't been read yet, because the document hasn't been looked at
+	std::unique_ptr<Hibernation> hibernation_;          // set while the document is hibernated to save memory
+	uint64_t lastRaised_ = 0;                           // when the document was last raised, for finding the ones not looked at for longest
+	std::unique_ptr<ShellCommandData> shellCmdData_;    // when a shell command is executing, info. about it, otherwise, nullptr
 	Ui::DocumentWidget ui;
 
 public:
@@ -0,0 +1,421 @@
+
+#include "EditJournal.h"
+#include "TextBuffer.h"
+#include "gap_buffer.h"
+
+#include <QFile>
+#include <QSaveFile>
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+
+namespace {
+
+// the start of every journal, which also gives the version of its format
+constexpr char JournalMagic[]     = "NEdit-ng journal 1\n";
+constexpr size_t JournalMagicSize = sizeof(JournalMagic) - 1;
+
+// a journal isn't compacted before it gets at least this large
+constexpr int64_t MinCompactSize = 4 * 1024 * 1024;
+
+/* every record is its type followed by two numbers, a position and a length,
+   and, for insertions and snapshots, that many characters of text */
+enum class RecordType : char {
+	Base     = 'F', // the size and modification time of the file the text was read from
+	Snapshot = 'S',
+	Insert   = 'I',
+	Delete   = 'D'
+};
+
+constexpr size_t RecordHeaderSize = 1 + 2 * sizeof(int64_t);
+
+/**
+ * @brief appendRecord
+ * @param out
+ * @param type
+ * @param pos
+ * @param length
+ * @param text
+ */
+void appendRecord(std::string *out, RecordType type, int64_t pos, int64_t length, view::string_view text = view::string_view()) {
+	out->push_back(static_cast<char>(type));
+	out->append(reinterpret_cast<const char *>(&pos), sizeof(pos));
+	out->append(reinterpret_cast<const char *>(&length), sizeof(length));
+	out->append(text.data(), text.size());
+}
+
+/**
+ * @brief readNumber
+ * @param p
+ * @return
+ */
+int64_t readNumber(const char *p) {
+	int64_t value;
+	std::memcpy(&value, p, sizeof(value));
+	return value;
+}
+
+/*
+** Replaces the journal with a new one holding head followed by body, without
+** ever leaving a half written journal in its place.
+*/
+bool writeJournal(const QString &fileName, view::string_view head, view::string_view body, QString *error) {
+
+	QSaveFile file(fileName);
+	if (!file.open(QIODevice::WriteOnly)) {
+		*error = file.errorString();
+		return false;
+	}
+
+	// the text may well be private, so only its owner gets to read the backup
+	file.setPermissions(QFileDevice::ReadOwner | QFileDevice::WriteOwner);
+
+	for (view::string_view part : {head, body}) {
+		if (file.write(part.data(), static_cast<qint64>(part.size())) != static_cast<qint64>(part.size())) {
+			*error = file.errorString();
+			file.cancelWriting();
+			return false;
+		}
+	}
+
+	if (!file.commit()) {
+		*error = file.errorString();
+		return false;
+	}
+
+	return true;
+}
+
+}
+
+/**
+ * @brief EditJournal::EditJournal
+ * @param parent
+ */
+EditJournal::EditJournal(QObject *parent)
+	: QObject(parent) {
+
+	connect(&watcher_, &QFutureWatcher<QString>::finished, this, &EditJournal::compactionFinished);
+}
+
+/**
+ * @brief EditJournal::~EditJournal
+ */
+EditJournal::~EditJournal() {
+	waitForCompaction();
+}
+
+/**
+ * @brief EditJournal::isJournal
+ * @param fileName
+ * @return true if fileName is a journal, rather than a backup file written by
+ * an older version, or something else altogether
+ */
+bool EditJournal::isJournal(const QString &fileName) {
+
+	QFile file(fileName);
+	if (!file.open(QIODevice::ReadOnly)) {
+		return false;
+	}
+
+	return file.read(JournalMagicSize) == QByteArray(JournalMagic, JournalMagicSize);
+}
+
+/**
+ * @brief EditJournal::replay
+ * @param fileName the journal
+ * @param base the size and modification time of the file text was read from
+ * @param text the text of the file, which is replaced with the text as it was
+ * when the journal was last written
+ * @param error set to the reason when the journal can't be replayed
+ * @return
+ */
+bool EditJournal::replay(const QString &fileName, const Base &base, std::string *text, QString *error) {
+
+	QFile file(fileName);
+	if (!file.open(QIODevice::ReadOnly)) {
+		*error = file.errorString();
+		return false;
+	}
+
+	const QByteArray journal = file.readAll();
+	view::string_view input(journal.data(), static_cast<size_t>(journal.size()));
+
+	if (input.compare(0, JournalMagicSize, view::string_view(JournalMagic, JournalMagicSize)) != 0) {
+		*error = tr("%1 is not an NEdit-ng backup file").arg(fileName);
+		return false;
+	}
+
+	input.remove_prefix(JournalMagicSize);
+
+	const QString damaged = tr("%1 is damaged").arg(fileName);
+
+	gap_buffer<char> buffer;
+	bool based = false;
+
+	while (input.size() >= RecordHeaderSize) {
+		const auto type      = static_cast<RecordType>(input[0]);
+		const int64_t pos    = readNumber(&input[1]);
+		const int64_t length = readNumber(&input[1 + sizeof(int64_t)]);
+		input.remove_prefix(RecordHeaderSize);
+
+		view::string_view payload;
+		if (type == RecordType::Insert || type == RecordType::Snapshot) {
+			if (length < 0) {
+				*error = damaged;
+				return false;
+			}
+
+			// a record cut short was still being written when the crash happened
+			if (static_cast<uint64_t>(length) > input.size()) {
+				break;
+			}
+
+			payload = input.substr(0, static_cast<size_t>(length));
+			input.remove_prefix(payload.size());
+		}
+
+		switch (type) {
+		case RecordType::Base:
+			if (pos != base.size || length != base.modTime) {
+				*error = tr("The file has been changed since %1 was written").arg(fileName);
+				return false;
+			}
+
+			buffer.assign(*text);
+			based = true;
+			break;
+		case RecordType::Snapshot:
+			buffer.assign(payload);
+			based = true;
+			break;
+		case RecordType::Insert:
+			if (!based || pos < 0 || pos > buffer.size()) {
+				*error = damaged;
+				return false;
+			}
+
+			buffer.insert(pos, payload);
+			break;
+		case RecordType::Delete:
+			if (!based || pos < 0 || length < 0 || pos + length > buffer.size()) {
+				*error = damaged;
+				return false;
+			}
+
+			buffer.erase(pos, pos + length);
+			break;
+		default:
+			*error = damaged;
+			return false;
+		}
+	}
+
+	if (!based) {
+		*error = damaged;
+		return false;
+	}
+
+	*text = buffer.to_string();
+	return true;
+}
+
+/**
+ * @brief EditJournal::isOpen
+ * @return whether the journal is being kept
+ */
+bool EditJournal::isOpen() const {
+	return !fileName_.isEmpty();
+}
+
+/**
+ * @brief EditJournal::open
+ * @param fileName where to keep the journal. Whatever is there is left alone
+ * until the journal is first written
+ * @param base the file the text was read from, if it's still as it was read,
+ * otherwise the journal starts with a snapshot of the text
+ */
+void EditJournal::open(const QString &fileName, const boost::optional<Base> &base) {
+	close();
+	fileName_ = fileName;
+	base_     = base;
+}
+
+/**
+ * @brief EditJournal::close
+ * Stops keeping the journal, leaving what has been written of it.
+ */
+void EditJournal::close() {
+	waitForCompaction();
+	fileName_.clear();
+	pending_.clear();
+	base_    = boost::none;
+	written_ = 0;
+}
+
+/**
+ * @brief EditJournal::remove
+ * Stops keeping the journal and deletes it.
+ */
+void EditJournal::remove() {
+	const QString fileName = fileName_;
+	close();
+
+	if (!fileName.isEmpty()) {
+		QFile::remove(fileName);
+	}
+}
+
+/**
+ * @brief EditJournal::recordInsert
+ * @param pos
+ * @param text
+ */
+void EditJournal::recordInsert(int64_t pos, view::string_view text) {
+	if (isOpen()) {
+		appendRecord(&pending_, RecordType::Insert, pos, static_cast<int64_t>(text.size()), text);
+	}
+}
+
+/**
+ * @brief EditJournal::recordDelete
+ * @param pos
+ * @param length
+ */
+void EditJournal::recordDelete(int64_t pos, int64_t length) {
+	if (isOpen()) {
+		appendRecord(&pending_, RecordType::Delete, pos, length);
+	}
+}
+
+/**
+ * @brief EditJournal::flush
+ * @param buffer the text the records lead to
+ * @param error set to the reason when the journal couldn't be written
+ * @return
+ */
+bool EditJournal::flush(const TextBuffer *buffer, QString *error) {
+
+	if (!isOpen()) {
+		return true;
+	}
+
+	// the records made in the meantime are written once the compacted journal is in place
+	if (compacting_) {
+		return true;
+	}
+
+	if (written_ == 0) {
+		if (!base_) {
+			startCompaction(buffer);
+			return true;
+		}
+
+		std::string head(JournalMagic, JournalMagicSize);
+		appendRecord(&head, RecordType::Base, base_->size, base_->modTime);
+		head.append(pending_);
+
+		if (!writeJournal(fileName_, head, view::string_view(), error)) {
+			return false;
+		}
+
+		written_ = static_cast<int64_t>(head.size());
+		pending_.clear();
+	} else if (!append(error)) {
+		return false;
+	}
+
+	if (written_ > std::max(MinCompactSize, buffer->length())) {
+		startCompaction(buffer);
+	}
+
+	return true;
+}
+
+/*
+** Writes the records made since the journal was last written to the end of it.
+*/
+bool EditJournal::append(QString *error) {
+
+	if (pending_.empty()) {
+		return true;
+	}
+
+	QFile file(fileName_);
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+		*error = file.errorString();
+		return false;
+	}
+
+	if (file.write(pending_.data(), static_cast<qint64>(pending_.size())) != static_cast<qint64>(pending_.size())) {
+		*error = file.errorString();
+		return false;
+	}
+
+	written_ += static_cast<int64_t>(pending_.size());
+	pending_.clear();
+	return true;
+}
+
+/*
+** Starts replacing the journal with a snapshot of the text on a worker
+** thread. The copy of the text is taken here, all at once, so that the
+** document can be edited while it's being written.
+*/
+void EditJournal::startCompaction(const TextBuffer *buffer) {
+
+	auto text = std::make_shared<std::string>(buffer->BufGetAll());
+
+	std::string head(JournalMagic, JournalMagicSize);
+	appendRecord(&head, RecordType::Snapshot, 0, static_cast<int64_t>(text->size()));
+
+	// all of the records so far are part of the snapshot
+	pending_.clear();
+	snapshot_   = static_cast<int64_t>(head.size() + text->size());
+	compacting_ = true;
+
+	const QString fileName = fileName_;
+
+	watcher_.setFuture(QtConcurrent::run([fileName, head, text]() {
+		QString error;
+		if (!writeJournal(fileName, head, *text, &error) && error.isEmpty()) {
+			error = tr("unknown error");
+		}
+		return error;
+	}));
+}
+
+/**
+ * @brief EditJournal::compactionFinished
+ */
+void EditJournal::compactionFinished() {
+
+	if (!compacting_) {
+		return;
+	}
+
+	compacting_ = false;
+
+	QString error = watcher_.result();
+	if (error.isEmpty()) {
+		written_ = snapshot_;
+		if (append(&error)) {
+			return;
+		}
+	}
+
+	close();
+	Q_EMIT failed(error);
+}
+
+/**
+ * @brief EditJournal::waitForCompaction
+ */
+void EditJournal::waitForCompaction() {
+	if (compacting_) {
+		watcher_.waitForFinished();
+		compacting_ = false;
+	}
+}
@@ -0,0 +1,71 @@
+
+#ifndef EDIT_JOURNAL_H_
+#define EDIT_JOURNAL_H_
+
+#include "TextBufferFwd.h"
+#include "Util/string_view.h"
+
+#include <QFutureWatcher>
+#include <QObject>
+#include <QString>
+
+#include <boost/optional.hpp>
+
+#include <string>
+
+/*
+** The incremental backup of a document. Rather than a copy of the whole text,
+** the backup file is a journal: it starts with what the text was based on,
+** either the file it was read from or a snapshot of the text itself, and is
+** followed by every insertion and deletion made since, which are appended as
+** they happen. Once it grows larger than the text, it's compacted into a
+** single snapshot on a worker thread. After a crash, replaying it onto the
+** file it was based on gives back the text as it was.
+*/
+class EditJournal : public QObject {
+	Q_OBJECT
+
+public:
+	// identifies the version of the file on disk which a journal applies to
+	struct Base {
+		int64_t size;
+		int64_t modTime;
+	};
+
+public:
+	explicit EditJournal(QObject *parent = nullptr);
+	~EditJournal() override;
+
+Q_SIGNALS:
+	void failed(const QString &error);
+
+public:
+	static bool isJournal(const QString &fileName);
+	static bool replay(const QString &fileName, const Base &base, std::string *text, QString *error);
+
+public:
+	bool flush(const TextBuffer *buffer, QString *error);
+	bool isOpen() const;
+	void close();
+	void open(const QString &fileName, const boost::optional<Base> &base);
+	void recordDelete(int64_t pos, int64_t length);
+	void recordInsert(int64_t pos, view::string_view text);
+	void remove();
+
+private:
+	bool append(QString *error);
+	void compactionFinished();
+	void startCompaction(const TextBuffer *buffer);
+	void waitForCompaction();
+
+private:
+	QFutureWatcher<QString> watcher_;
+	QString fileName_;           // where the journal is kept, empty when it isn't being kept
+	std::string pending_;        // records which haven't been written out yet
+	boost::optional<Base> base_; // the file the journal applies to, or none when it starts with a snapshot
+	int64_t written_  = 0;       // the size of the journal file, or 0 if it hasn't been created yet
+	int64_t snapshot_ = 0;       // the size of the journal being written by the compaction
+	bool compacting_  = false;
+};
+
+#endif
@@ -0,0 +1,244 @@
+
+#include "FileLoader.h"
+#include "Util/Codec.h"
+#include "Util/FileSystem.h"
+
+#include <QCryptographicHash>
+#include <QFile>
+#include <QMutexLocker>
+#include <QtConcurrent>
+
+#include <gsl/gsl_util>
+
+namespace {
+
+// the file is read this many characters at a time
+constexpr size_t ChunkSize = 4 * 1024 * 1024;
+
+}
+
+/**
+ * @brief FileLoader::FileLoader
+ * @param fileName
+ * @param convertFormat whether DOS and Macintosh format files are converted
+ */
+FileLoader::FileLoader(const QString &fileName, bool convertFormat)
+	: fileName_(fileName), convertFormat_(convertFormat) {
+}
+
+/**
+ * @brief FileLoader::~FileLoader
+ */
+FileLoader::~FileLoader() {
+	cancel();
+	future_.waitForFinished();
+}
+
+/**
+ * @brief FileLoader::start
+ */
+void FileLoader::start() {
+	future_ = QtConcurrent::run([this]() {
+		load();
+	});
+}
+
+/**
+ * @brief FileLoader::cancel
+ */
+void FileLoader::cancel() {
+	cancelled_ = true;
+}
+
+/**
+ * @brief FileLoader::waitForFinished
+ */
+void FileLoader::waitForFinished() {
+	future_.waitForFinished();
+}
+
+/**
+ * @brief FileLoader::isFinished
+ * @return true once all of the file has been read, or reading it has failed
+ * or been cancelled
+ */
+bool FileLoader::isFinished() const {
+	return finished_;
+}
+
+/**
+ * @brief FileLoader::bytesRead
+ * @return how much of the file has been read so far
+ */
+int64_t FileLoader::bytesRead() const {
+	return bytesRead_;
+}
+
+/**
+ * @brief FileLoader::takeText
+ * @return the text read since the last call
+ */
+std::string FileLoader::takeText() {
+	QMutexLocker locker(&mutex_);
+
+	std::string text;
+	text.swap(text_);
+	return text;
+}
+
+/**
+ * @brief FileLoader::format
+ * @return
+ */
+FileFormats FileLoader::format() const {
+	QMutexLocker locker(&mutex_);
+	return format_;
+}
+
+/**
+ * @brief FileLoader::hash
+ * @return the hash of the contents of the file, to compare with HashFile
+ */
+QByteArray FileLoader::hash() const {
+	QMutexLocker locker(&mutex_);
+	return hash_;
+}
+
+/**
+ * @brief FileLoader::errorString
+ * @return
+ */
+QString FileLoader::errorString() const {
+	QMutexLocker locker(&mutex_);
+	return error_;
+}
+
+/**
+ * @brief FileLoader::publish
+ * @param text
+ */
+void FileLoader::publish(std::string &&text) {
+	QMutexLocker locker(&mutex_);
+
+	if (text_.empty()) {
+		text_ = std::move(text);
+	} else {
+		text_.append(text);
+	}
+}
+
+/**
+ * @brief FileLoader::load
+ */
+void FileLoader::load() {
+
+	auto _ = gsl::finally([this]() {
+		finished_ = true;
+	});
+
+	QFile file(fileName_);
+	if (!file.open(QIODevice::ReadOnly | QIODevice::Unbuffered)) {
+		QMutexLocker locker(&mutex_);
+		error_ = file.errorString();
+		return;
+	}
+
+	QCryptographicHash hash(ContentHashAlgorithm);
+	std::unique_ptr<Decompressor> decompressor;
+	FileFormats format = FileFormats::Unix;
+	char pendingCR     = '\0';
+	bool first         = true;
+	bool detected      = false;
+
+	while (!cancelled_) {
+
+		std::string chunk(ChunkSize + 1, '\0');
+
+		// a carriage return left over from the last chunk may yet turn out to be part of a DOS line break
+		size_t offset = 0;
+		if (pendingCR) {
+			chunk[offset++] = pendingCR;
+		}
+
+		const qint64 n = file.read(&chunk[offset], static_cast<qint64>(ChunkSize));
+		if (n < 0) {
+			QMutexLocker locker(&mutex_);
+			error_ = file.errorString();
+			return;
+		}
+
+		if (n == 0) {
+			break;
+		}
+
+		chunk.resize(offset + static_cast<size_t>(n));
+
+		// the hash is of the file as it is on disk, compressed or not
+		const view::string_view input(&chunk[offset], static_cast<size_t>(n));
+		AddToHash(&hash, input);
+
+		if (first) {
+			if (const Codec *codec = CodecForData(input)) {
+				decompressor = codec->createDecompressor();
+			}
+		}
+
+		first = false;
+
+		if (decompressor) {
+			std::string text(chunk, 0, offset);
+
+			QString error;
+			if (!decompressor->decompress(input, &text, &error)) {
+				QMutexLocker locker(&mutex_);
+				error_ = error;
+				return;
+			}
+
+			chunk.swap(text);
+		}
+
+		// compressed data may not have come to any text yet
+		if (!detected && convertFormat_ && !chunk.empty()) {
+			format = FormatOfFile(chunk);
+
+			QMutexLocker locker(&mutex_);
+			format_ = format;
+		}
+
+		detected = detected || !chunk.empty();
+
+		switch (format) {
+		case FileFormats::Dos:
+			ConvertFromDos(chunk, &pendingCR);
+			break;
+		case FileFormats::Mac:
+			ConvertFromMac(chunk);
+			break;
+		case FileFormats::Unix:
+			break;
+		}
+
+		bytesRead_ += n;
+		publish(std::move(chunk));
+	}
+
+	if (cancelled_) {
+		return;
+	}
+
+	QString error;
+	if (decompressor && !decompressor->finish(&error)) {
+		QMutexLocker locker(&mutex_);
+		error_ = error;
+		return;
+	}
+
+	// a file which ends with a carriage return keeps it
+	if (pendingCR) {
+		publish(std::string(1, pendingCR));
+	}
+
+	QMutexLocker locker(&mutex_);
+	hash_ = hash.result();
+}
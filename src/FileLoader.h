@@ -0,0 +1,57 @@
+
+#ifndef FILE_LOADER_H_
+#define FILE_LOADER_H_
+
+#include "Util/FileFormats.h"
+
+#include <QByteArray>
+#include <QFuture>
+#include <QMutex>
+#include <QString>
+
+#include <atomic>
+#include <string>
+
+/*
+** Reads a file on a worker thread, a chunk at a time, decompressing it and
+** converting it from DOS or Macintosh format on the way if need be, so that a
+** very large file can be shown while the rest of it is still being read. The
+** text read so far is collected for the GUI to pick up at its own pace.
+*/
+class FileLoader {
+public:
+	FileLoader(const QString &fileName, bool convertFormat);
+	FileLoader(const FileLoader &) = delete;
+	FileLoader &operator=(const FileLoader &) = delete;
+	~FileLoader();
+
+public:
+	FileFormats format() const;
+	QByteArray hash() const;
+	QString errorString() const;
+	bool isFinished() const;
+	int64_t bytesRead() const;
+	std::string takeText();
+	void cancel();
+	void start();
+	void waitForFinished();
+
+private:
+	void load();
+	void publish(std::string &&text);
+
+private:
+	QString fileName_;
+	bool convertFormat_;
+	QFuture<void> future_;
+	std::atomic<bool> cancelled_{false};
+	std::atomic<bool> finished_{false};
+	std::atomic<int64_t> bytesRead_{0};
+	mutable QMutex mutex_;
+	std::string text_;                       // read, but not taken yet
+	FileFormats format_ = FileFormats::Unix; // the format the file was found to be in
+	QByteArray hash_;                        // hash of the whole file, once it has all been read
+	QString error_;                          // why the file couldn't be read, if it couldn't
+};
+
+#endif
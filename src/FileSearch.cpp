@@ -0,0 +1,217 @@
+
+#include "FileSearch.h"
+#include "Search.h"
+
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QRunnable>
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+namespace {
+
+// files with a NUL among their first this many bytes are taken to be binary
+// and skipped, much like "grep -I"
+constexpr size_t BinaryCheckSize = 8192;
+
+// longest part of a matching line which is reported
+constexpr size_t MaxLineLength = 256;
+
+}
+
+/*
+** Scans a single directory, searching its files and queueing up a new task
+** for each of its subdirectories
+*/
+class FileSearch::DirectoryTask : public QRunnable {
+public:
+	DirectoryTask(FileSearch *search, const QString &path)
+		: search_(search), path_(path) {
+	}
+
+public:
+	void run() override {
+		search_->searchDirectory(path_);
+	}
+
+private:
+	FileSearch *search_;
+	QString path_;
+};
+
+/**
+ * @brief FileSearch::FileSearch
+ * @param directory
+ * @param nameFilters wildcards for the names of the files to search, all files
+ * are searched if this is empty
+ * @param searchString
+ * @param searchType
+ */
+FileSearch::FileSearch(const QString &directory, const QStringList &nameFilters, const QString &searchString, SearchType searchType)
+	: directory_(directory), nameFilters_(nameFilters), searchString_(searchString), searchType_(searchType) {
+}
+
+/**
+ * @brief FileSearch::~FileSearch
+ */
+FileSearch::~FileSearch() {
+	cancel();
+	pool_.waitForDone();
+}
+
+/**
+ * @brief FileSearch::start
+ */
+void FileSearch::start() {
+	pending_ = 1;
+	pool_.start(new DirectoryTask(this, directory_));
+}
+
+/**
+ * @brief FileSearch::cancel
+ */
+void FileSearch::cancel() {
+	cancelled_ = true;
+}
+
+/**
+ * @brief FileSearch::isFinished
+ * @return true once every task has completed, or given up after a cancel
+ */
+bool FileSearch::isFinished() const {
+	return pending_ == 0;
+}
+
+/**
+ * @brief FileSearch::statistics
+ * @return
+ */
+FileSearch::Statistics FileSearch::statistics() const {
+	Statistics stats;
+	stats.files   = files_;
+	stats.bytes   = bytes_;
+	stats.matches = matchCount_;
+	return stats;
+}
+
+/**
+ * @brief FileSearch::takeMatches
+ * @return the matches found since the last call
+ */
+std::vector<FileSearch::Match> FileSearch::takeMatches() {
+	QMutexLocker locker(&mutex_);
+
+	std::vector<Match> matches;
+	matches.swap(matches_);
+	return matches;
+}
+
+/**
+ * @brief FileSearch::searchDirectory
+ * @param path
+ */
+void FileSearch::searchDirectory(const QString &path) {
+
+	QDirIterator it(path, QDir::Dirs | QDir::Files | QDir::NoDotAndDotDot);
+
+	while (it.hasNext() && !cancelled_) {
+		it.next();
+
+		const QFileInfo info = it.fileInfo();
+
+		if (info.isDir()) {
+			// don't follow links to directories, they may well lead in circles
+			if (!info.isSymLink()) {
+				++pending_;
+				pool_.start(new DirectoryTask(this, info.filePath()));
+			}
+		} else if (nameFilters_.isEmpty() || QDir::match(nameFilters_, info.fileName())) {
+			searchFile(info.filePath());
+		}
+	}
+
+	--pending_;
+}
+
+/**
+ * @brief FileSearch::searchFile
+ * @param path
+ */
+void FileSearch::searchFile(const QString &path) {
+
+	QFile file(path);
+	if (!file.open(QIODevice::ReadOnly)) {
+		return;
+	}
+
+	const qint64 size = file.size();
+	if (size == 0) {
+		++files_;
+		return;
+	}
+
+	uchar *data = file.map(0, size);
+	if (!data) {
+		return;
+	}
+
+	const view::string_view text(reinterpret_cast<const char *>(data), static_cast<size_t>(size));
+
+	++files_;
+	bytes_ += size;
+
+	if (std::memchr(text.data(), '\0', std::min(text.size(), BinaryCheckSize))) {
+		return;
+	}
+
+	const std::vector<Search::Result> results = Search::FindAll(text, searchString_, searchType_, QString());
+	if (results.empty()) {
+		return;
+	}
+
+	// turn the match positions into line numbers, reporting every line only
+	// once no matter how many matches it has
+	std::vector<Match> matches;
+
+	int64_t line        = 1;
+	int64_t lastLine    = 0;
+	size_t lineStart    = 0;
+	const char *counted = text.data();
+
+	for (const Search::Result &result : results) {
+		const char *matchStart = text.data() + result.start;
+
+		while (const void *newline = std::memchr(counted, '\n', static_cast<size_t>(matchStart - counted))) {
+			counted   = static_cast<const char *>(newline) + 1;
+			lineStart = static_cast<size_t>(counted - text.data());
+			++line;
+		}
+
+		counted = matchStart;
+
+		if (line == lastLine) {
+			continue;
+		}
+
+		lastLine = line;
+
+		const void *lineEnd     = std::memchr(text.data() + lineStart, '\n', text.size() - lineStart);
+		const size_t lineLength = lineEnd ? static_cast<size_t>(static_cast<const char *>(lineEnd) - (text.data() + lineStart)) : text.size() - lineStart;
+
+		Match match;
+		match.path = path;
+		match.line = line;
+		match.text = QString::fromUtf8(text.data() + lineStart, static_cast<int>(std::min(lineLength, MaxLineLength)));
+		matches.push_back(std::move(match));
+	}
+
+	matchCount_ += static_cast<int64_t>(matches.size());
+
+	QMutexLocker locker(&mutex_);
+	std::move(matches.begin(), matches.end(), std::back_inserter(matches_));
+}
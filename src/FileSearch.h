@@ -0,0 +1,71 @@
+
+#ifndef FILE_SEARCH_H_
+#define FILE_SEARCH_H_
+
+#include "SearchType.h"
+
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+
+#include <atomic>
+#include <vector>
+
+/*
+** Searches the files of a directory tree on disk, without opening them as
+** documents. Every directory is scanned by its own task on a thread pool, so
+** that idle threads pick up the subtrees which are still waiting, and every
+** file is memory mapped rather than read. The matches are collected as they
+** are found, for the GUI to pick up at its own pace.
+*/
+class FileSearch {
+public:
+	struct Match {
+		QString path;
+		int64_t line;
+		QString text;
+	};
+
+	struct Statistics {
+		int64_t files;
+		int64_t bytes;
+		int64_t matches;
+	};
+
+public:
+	FileSearch(const QString &directory, const QStringList &nameFilters, const QString &searchString, SearchType searchType);
+	FileSearch(const FileSearch &) = delete;
+	FileSearch &operator=(const FileSearch &) = delete;
+	~FileSearch();
+
+public:
+	Statistics statistics() const;
+	bool isFinished() const;
+	std::vector<Match> takeMatches();
+	void cancel();
+	void start();
+
+private:
+	class DirectoryTask;
+
+private:
+	void searchDirectory(const QString &path);
+	void searchFile(const QString &path);
+
+private:
+	QString directory_;
+	QStringList nameFilters_;
+	QString searchString_;
+	SearchType searchType_;
+	QThreadPool pool_;
+	std::atomic<bool> cancelled_{false};
+	std::atomic<int> pending_{0};
+	std::atomic<int64_t> files_{0};
+	std::atomic<int64_t> bytes_{0};
+	std::atomic<int64_t> matchCount_{0};
+	mutable QMutex mutex_;
+	std::vector<Match> matches_;
+};
+
+#endif
@@ -7,8 +7,10 @@
 class LockReasons {
 private:
 	enum Reason : uint32_t {
-		USER_LOCKED_BIT = 1,
-		PERM_LOCKED_BIT = 2,
+		USER_LOCKED_BIT    = 1,
+		PERM_LOCKED_BIT    = 2,
+		LOADING_LOCKED_BIT = 4,
+		RESTORE_LOCKED_BIT = 8,
 	};
 
 public:
@@ -20,6 +22,14 @@ public:
 		return (reasons_ & PERM_LOCKED_BIT) != 0;
 	}
 
+	bool isLoadingLocked() const {
+		return (reasons_ & LOADING_LOCKED_BIT) != 0;
+	}
+
+	bool isRestoreLocked() const {
+		return (reasons_ & RESTORE_LOCKED_BIT) != 0;
+	}
+
 	bool isAnyLockedIgnoringUser() const {
 		return (reasons_ & ~USER_LOCKED_BIT) != 0;
 	}
@@ -44,6 +54,14 @@ public:
 		setLockedByReason(enabled, PERM_LOCKED_BIT);
 	}
 
+	void setLoadingLocked(bool enabled) {
+		setLockedByReason(enabled, LOADING_LOCKED_BIT);
+	}
+
+	void setRestoreLocked(bool enabled) {
+		setLockedByReason(enabled, RESTORE_LOCKED_BIT);
+	}
+
 private:
 	void setLockedByReason(bool enabled, Reason reason) {
 		if (enabled) {
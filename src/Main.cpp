@@ -314,6 +314,8 @@ Main::Main(const QStringList &args) {
 					macroFileReadEx = true;
 				}
 				if (gotoLine) {
+					// a file opened in the background hasn't been read yet
+					document->makeResident();
 					document->selectNumberedLine(document->firstPane(), lineNum);
 				}
 
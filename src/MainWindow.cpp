@@ -7,9 +7,11 @@
 #include "DialogExecuteCommand.h"
 #include "DialogFilter.h"
 #include "DialogFind.h"
+#include "DialogFindInFiles.h"
 #include "DialogFonts.h"
 #include "DialogLanguageModes.h"
 #include "DialogMacros.h"
+#include "DialogMemoryUsage.h"
 #include "DialogRepeat.h"
 #include "DialogReplace.h"
 #include "DialogShellMenu.h"
@@ -26,6 +28,7 @@
 #include "Highlight.h"
 #include "LanguageMode.h"
 #include "Location.h"
+#include "MatchCounter.h"
 #include "PatternSet.h"
 #include "Preferences.h"
 #include "Regex.h"
@@ -51,6 +54,7 @@
 #include <QMessageBox>
 #include <QMimeData>
 #include <QShortcut>
+#include <QTimer>
 #include <QToolTip>
 #include <qplatformdefs.h>
 
@@ -62,6 +66,11 @@
 
 namespace {
 
+// regular expression incremental searches in documents larger than this wait
+// for the user to pause typing for ISearchDebounceDelay milliseconds
+constexpr int64_t ISearchDebounceSize = 1024 * 1024;
+constexpr int ISearchDebounceDelay    = 250;
+
 bool currentlyBusy   = false;
 bool modeMessageSet  = false;
 qint64 busyStartTime = 0;
@@ -117,6 +126,29 @@ boost::optional<Location> StringToLineAndCol(const QString &text) {
 	return boost::none;
 }
 
+/*
+** Adds what the files in a menu of tags or tips files cost to load to their
+** names. They are only loaded when first needed, so this is done whenever
+** the menu is shown.
+*/
+void updateTagsFileActions(QMenu *menu, const std::deque<Tags::File> &files) {
+
+	for (QAction *action : menu->actions()) {
+		const QString filename = action->data().toString();
+
+		auto it = std::find_if(files.begin(), files.end(), [&filename](const Tags::File &tf) {
+			return tf.filename == filename;
+		});
+
+		const QString statistics = (it != files.end()) ? Tags::tagsFileStatistics(*it) : QString();
+		if (statistics.isEmpty()) {
+			action->setText(filename);
+		} else {
+			action->setText(MainWindow::tr("%1 (%2)").arg(filename, statistics));
+		}
+	}
+}
+
 /**
  * @brief addToGroup
  * @param group
@@ -234,6 +266,18 @@ MainWindow::MainWindow(QWidget *parent, Qt::WindowFlags flags)
 	// determine the strings and button settings to use
 	initToggleButtonsiSearch(Preferences::GetPrefSearch());
 
+	iSearchTimer_ = new QTimer(this);
+	iSearchTimer_->setSingleShot(true);
+	iSearchTimer_->setInterval(ISearchDebounceDelay);
+	connect(iSearchTimer_, &QTimer::timeout, this, [this]() {
+		iSearchTextChanged(ui.editIFind->text(), /*immediate=*/true);
+	});
+
+	matchCounter_ = new MatchCounter(this);
+	connect(matchCounter_, &MatchCounter::countChanged, this, [this](DocumentWidget *document) {
+		updateStatus(document, nullptr);
+	});
+
 	showISearchLine_ = Preferences::GetPrefISearchLine();
 	showLineNumbers_ = Preferences::GetPrefLineNums();
 
@@ -314,10 +358,12 @@ void MainWindow::connectSlots() {
 	connect(ui.action_Find_Again, &QAction::triggered, this, &MainWindow::action_Find_Again_triggered);
 	connect(ui.action_Find_Selection, &QAction::triggered, this, &MainWindow::action_Find_Selection_triggered);
 	connect(ui.action_Find_Incremental, &QAction::triggered, this, &MainWindow::action_Find_Incremental_triggered);
+	connect(ui.action_Find_In_Files, &QAction::triggered, this, &MainWindow::action_Find_In_Files_triggered);
 	connect(ui.action_Replace, &QAction::triggered, this, &MainWindow::action_Replace_triggered);
 	connect(ui.action_Replace_Find_Again, &QAction::triggered, this, &MainWindow::action_Replace_Find_Again_triggered);
 	connect(ui.action_Replace_Again, &QAction::triggered, this, &MainWindow::action_Replace_Again_triggered);
 	connect(ui.action_Mark, &QAction::triggered, this, &MainWindow::action_Mark_triggered);
+	connect(ui.action_Mark_All, &QAction::triggered, this, &MainWindow::action_Mark_All_triggered);
 	connect(ui.action_Goto_Mark, &QAction::triggered, this, &MainWindow::action_Goto_Mark_triggered);
 	connect(ui.action_Goto_Matching, &QAction::triggered, this, &MainWindow::action_Goto_Matching_triggered);
 	connect(ui.action_Show_Calltip, &QAction::triggered, this, &MainWindow::action_Show_Calltip_triggered);
@@ -330,6 +376,7 @@ void MainWindow::connectSlots() {
 	connect(ui.action_Split_Pane, &QAction::triggered, this, &MainWindow::action_Split_Pane_triggered);
 	connect(ui.action_Close_Pane, &QAction::triggered, this, &MainWindow::action_Close_Pane_triggered);
 	connect(ui.action_Move_Tab_To, &QAction::triggered, this, &MainWindow::action_Move_Tab_To_triggered);
+	connect(ui.action_Memory_Usage, &QAction::triggered, this, &MainWindow::action_Memory_Usage_triggered);
 	connect(ui.action_Wrap_Margin, &QAction::triggered, this, &MainWindow::action_Wrap_Margin_triggered);
 	connect(ui.action_Tab_Stops, &QAction::triggered, this, &MainWindow::action_Tab_Stops_triggered);
 	connect(ui.action_Text_Fonts, &QAction::triggered, this, &MainWindow::action_Text_Fonts_triggered);
@@ -1169,6 +1216,8 @@ void MainWindow::updateWindowMenu() {
 	ui.menu_Windows->addAction(ui.action_Detach_Tab);
 	ui.menu_Windows->addAction(ui.action_Move_Tab_To);
 	ui.menu_Windows->addSeparator();
+	ui.menu_Windows->addAction(ui.action_Memory_Usage);
+	ui.menu_Windows->addSeparator();
 
 	for (DocumentWidget *document : documents) {
 		QString title = document->getWindowsMenuEntry();
@@ -2701,6 +2750,17 @@ void MainWindow::action_Shift_Find_Selection() {
 ** search for the new search string.
 */
 void MainWindow::editIFind_textChanged(const QString &text) {
+	iSearchTextChanged(text, /*immediate=*/false);
+}
+
+/*
+** Redoes the incremental search for a new search string. Unless "immediate"
+** is true, regular expression searches in large documents are postponed until
+** the user pauses typing.
+*/
+void MainWindow::iSearchTextChanged(const QString &text, bool immediate) {
+
+	iSearchTimer_->stop();
 
 	const SearchType searchType = [this]() {
 		if (ui.checkIFindCase->isChecked()) {
@@ -2732,19 +2792,31 @@ void MainWindow::editIFind_textChanged(const QString &text) {
 		}
 	}
 
+	DocumentWidget *document = currentDocument();
+	if (!document) {
+		return;
+	}
+
+	/* Unlike literal searches, a regular expression search can't pick up where
+	   the search for the previous, shorter, string left off. So in large
+	   documents, rather than searching the whole file on every keystroke, we
+	   wait until the user pauses */
+	if (!immediate && Search::isRegexType(searchType) && document->buffer()->length() > ISearchDebounceSize) {
+		iSearchTimer_->start();
+		return;
+	}
+
 	/* Call the incremental search handler to do the searching and
 	   selecting (this allows it to be recorded for learn/replay).  If
 	   there's an incremental search already in progress, mark the operation
 	   as "continued" so the search routine knows to re-start the search
 	   from the original starting position */
-	if (DocumentWidget *document = currentDocument()) {
-		action_Find_Incremental(document,
-								text,
-								direction,
-								searchType,
-								Preferences::GetPrefSearchWraps(),
-								iSearchStartPos_ != -1);
-	}
+	action_Find_Incremental(document,
+							text,
+							direction,
+							searchType,
+							Preferences::GetPrefSearchWraps(),
+							iSearchStartPos_ != -1);
 }
 
 /**
@@ -2754,6 +2826,24 @@ void MainWindow::action_Find_Incremental_triggered() {
 	beginISearch(Direction::Forward);
 }
 
+/**
+ * @brief MainWindow::action_Find_In_Files_triggered
+ */
+void MainWindow::action_Find_In_Files_triggered() {
+
+	if (!dialogFindInFiles_) {
+		dialogFindInFiles_ = new DialogFindInFiles(this);
+	}
+
+	if (DocumentWidget *document = currentDocument()) {
+		dialogFindInFiles_->setDirectory(document->path());
+	}
+
+	dialogFindInFiles_->show();
+	dialogFindInFiles_->raise();
+	dialogFindInFiles_->activateWindow();
+}
+
 /**
  * @brief MainWindow::action_Shift_Find_Incremental
  */
@@ -2800,6 +2890,9 @@ void MainWindow::buttonIFind_clicked() {
  */
 void MainWindow::editIFind_returnPressed() {
 
+	// a postponed incremental search would undo this one
+	iSearchTimer_->stop();
+
 	/* Fetch the string, search type and direction from the incremental
 	   search bar widgets at the top of the window */
 	QString searchString = ui.editIFind->text();
@@ -3009,6 +3102,7 @@ void MainWindow::initToggleButtonsiSearch(SearchType searchType) {
 void MainWindow::beginISearch(Direction direction) {
 
 	iSearchStartPos_ = TextCursor(-1);
+	iSearchResume_   = {};
 	ui.editIFind->setText(QString());
 	no_signals(ui.checkIFindReverse)->setChecked(direction == Direction::Backward);
 
@@ -3037,6 +3131,8 @@ void MainWindow::endISearch() {
 
 	// Forget the starting position used for the current run of searches
 	iSearchStartPos_ = TextCursor(-1);
+	iSearchResume_   = {};
+	iSearchTimer_->stop();
 
 	// Mark the end of incremental search history overwriting
 	Search::saveSearchHistory(QString(), QString(), SearchType::Literal, /*isIncremental=*/false);
@@ -3191,6 +3287,46 @@ void MainWindow::action_Mark_triggered() {
 	}
 }
 
+/**
+ * @brief MainWindow::action_Mark_All
+ * @param document
+ * @param searchString
+ * @param type
+ */
+void MainWindow::action_Mark_All(DocumentWidget *document, const QString &searchString, SearchType type) {
+
+	emit_event("mark_all", searchString, to_string(type));
+
+	if (document->markAll(searchString, type) == 0) {
+		qWarning("NEdit: no rangesets left for mark_all");
+		QApplication::beep();
+	}
+}
+
+/**
+ * @brief MainWindow::action_Mark_All
+ * @param document
+ */
+void MainWindow::action_Mark_All(DocumentWidget *document) {
+
+	const Search::HistoryEntry *entry = Search::HistoryByIndex(1);
+	if (!entry) {
+		QApplication::beep();
+		return;
+	}
+
+	action_Mark_All(document, entry->search, entry->type);
+}
+
+/**
+ * @brief MainWindow::action_Mark_All_triggered
+ */
+void MainWindow::action_Mark_All_triggered() {
+	if (DocumentWidget *document = currentDocument()) {
+		action_Mark_All(document);
+	}
+}
+
 /**
  * @brief MainWindow::action_Mark_Shortcut_triggered
  */
@@ -3355,6 +3491,10 @@ void MainWindow::updateTipsFileMenu() {
 
 	ui.action_Unload_Calltips_File->setMenu(tipsMenu);
 
+	connect(tipsMenu, &QMenu::aboutToShow, this, [tipsMenu]() {
+		updateTagsFileActions(tipsMenu, Tags::TipsFileList);
+	});
+
 	connect(tipsMenu, &QMenu::triggered, this, [this](QAction *action) {
 		auto filename = action->data().toString();
 		if (!filename.isEmpty()) {
@@ -3380,6 +3520,10 @@ void MainWindow::updateTagsFileMenu() {
 
 	ui.action_Unload_Tags_File->setMenu(tagsMenu);
 
+	connect(tagsMenu, &QMenu::aboutToShow, this, [tagsMenu]() {
+		updateTagsFileActions(tagsMenu, Tags::TagsFileList);
+	});
+
 	connect(tagsMenu, &QMenu::triggered, this, [this](QAction *action) {
 		auto filename = action->data().toString();
 		if (!filename.isEmpty()) {
@@ -3646,6 +3790,14 @@ void MainWindow::action_Move_Tab_To_triggered() {
 	}
 }
 
+/**
+ * @brief MainWindow::action_Memory_Usage_triggered
+ */
+void MainWindow::action_Memory_Usage_triggered() {
+	auto dialog = std::make_unique<DialogMemoryUsage>(this);
+	dialog->exec();
+}
+
 /**
  * @brief MainWindow::action_About_Qt_triggered
  */
@@ -3880,6 +4032,13 @@ void MainWindow::action_Overtype_toggled(bool state) {
  */
 void MainWindow::action_Read_Only_toggled(bool state) {
 	if (DocumentWidget *document = currentDocument()) {
+
+		// a document viewed straight from its file has to be read in before it can be edited
+		if (!state && !document->convertMappedFile()) {
+			no_signals(ui.action_Read_Only)->setChecked(true);
+			return;
+		}
+
 		document->info_->lockReasons.setUserLocked(state);
 		updateWindowTitle(document);
 		updateWindowReadOnly(document);
@@ -6202,6 +6361,14 @@ bool MainWindow::searchWindow(DocumentWidget *document, const QString &searchStr
 		}
 	}
 
+	// count all of the matches in the background for the statistics line,
+	// there is no point when it isn't shown
+	if (found && document->showStats_) {
+		matchCounter_->start(document, searchString, searchType, TextCursor(searchResult->start));
+	} else {
+		matchCounter_->cancel();
+	}
+
 	return found;
 }
 
@@ -6334,10 +6501,36 @@ bool MainWindow::searchAndSelectIncremental(DocumentWidget *document, TextArea *
 		--beginPos;
 	}
 
+	/* Every match of a literal string is also a match of each of its
+	   prefixes, so when the user has just typed another character, the
+	   search can resume where the previous one matched. If the previous
+	   string wasn't found at all, neither will this one be */
+	TextCursor searchPos = beginPos;
+	if (iSearchCanResume(document, searchString, direction, searchType, searchWrap, beginPos)) {
+		if (!iSearchResume_.found) {
+			matchCounter_->cancel();
+			QApplication::beep();
+			return false;
+		}
+
+		searchPos = iSearchResume_.matchStart;
+	}
+
 	Search::Result searchResult;
 
 	// do the search.  SearchWindow does appropriate dialogs and beeps
-	if (!searchWindow(document, searchString, direction, searchType, searchWrap, to_integer(beginPos), &searchResult)) {
+	const bool found = searchWindow(document, searchString, direction, searchType, searchWrap, to_integer(searchPos), &searchResult);
+
+	iSearchResume_.document     = document;
+	iSearchResume_.searchString = searchString;
+	iSearchResume_.searchType   = searchType;
+	iSearchResume_.direction    = direction;
+	iSearchResume_.searchWrap   = searchWrap;
+	iSearchResume_.beginPos     = beginPos;
+	iSearchResume_.matchStart   = TextCursor(searchResult.start);
+	iSearchResume_.found        = found;
+
+	if (!found) {
 		return false;
 	}
 
@@ -6943,10 +7136,7 @@ bool MainWindow::replaceAll(DocumentWidget *document, TextArea *area, const QStr
 		delimieters);
 
 	if (!newFileString) {
-		if (document->multiFileBusy_) {
-			// only needed during multi-file replacements
-			document->replaceFailed_ = true;
-		} else if (Preferences::GetPrefSearchDlogs()) {
+		if (Preferences::GetPrefSearchDlogs()) {
 
 			if (dialogFind_) {
 				if (!dialogFind_->keepDialog()) {
@@ -6987,6 +7177,39 @@ void MainWindow::iSearchRecordLastBeginPos(Direction direction, TextCursor initP
 	}
 }
 
+/*
+** Return true if the incremental search for "searchString" may resume from the
+** result of the previous one, which is the case for literal searches from the
+** same position in an unmodified document, for a string which extends the
+** previous one, and as long as the previous match didn't wrap.
+*/
+bool MainWindow::iSearchCanResume(DocumentWidget *document, const QString &searchString, Direction direction, SearchType searchType, WrapMode searchWrap, TextCursor beginPos) const {
+
+	if (searchType != SearchType::Literal && searchType != SearchType::CaseSense) {
+		return false;
+	}
+
+	const ISearchResume &last = iSearchResume_;
+
+	if (last.document != document || last.searchType != searchType || last.direction != direction || last.searchWrap != searchWrap || last.beginPos != beginPos) {
+		return false;
+	}
+
+	if (last.searchString.isEmpty() || !searchString.startsWith(last.searchString)) {
+		return false;
+	}
+
+	if (!last.found) {
+		return true;
+	}
+
+	if (direction == Direction::Forward) {
+		return last.matchStart >= beginPos;
+	} else {
+		return last.matchStart <= beginPos;
+	}
+}
+
 /*
 ** If this is an incremental search and BeepOnSearchWrap is on:
 ** Emit a beep if the search wrapped over BOF/EOF compared to
@@ -7272,6 +7495,11 @@ void MainWindow::updateStatus(DocumentWidget *document, TextArea *area) {
 		slinecol = tr("L: ---  C: ---");
 	}
 
+	const QString matches = matchCounter_->message(document);
+	if (!matches.isEmpty()) {
+		slinecol = tr("%1  %2").arg(matches, slinecol);
+	}
+
 	// Update the line/column number
 	document->ui.labelStats->setText(slinecol);
 
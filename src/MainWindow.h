@@ -30,9 +30,12 @@ struct PathInfo;
 class DocumentWidget;
 class DialogReplace;
 class DialogFind;
+class DialogFindInFiles;
 class DialogShellMenu;
 class DialogMacros;
 class DialogWindowBackgroundMenu;
+class MatchCounter;
+class QTimer;
 struct MenuData;
 struct TextRange;
 
@@ -96,6 +99,8 @@ public:
 	void initToggleButtonsiSearch(SearchType searchType);
 	void iSearchRecordLastBeginPos(Direction direction, TextCursor initPos);
 	void iSearchTryBeepOnWrap(Direction direction, TextCursor beginPos, TextCursor startPos);
+	bool iSearchCanResume(DocumentWidget *document, const QString &searchString, Direction direction, SearchType searchType, WrapMode searchWrap, TextCursor beginPos) const;
+	void iSearchTextChanged(const QString &text, bool immediate);
 	void openFile(DocumentWidget *document, const QString &text);
 	void parseGeometry(QString geometry);
 	void replaceInSelection(DocumentWidget *document, TextArea *area, const QString &searchString, const QString &replaceString, SearchType searchType);
@@ -202,6 +207,8 @@ public:
 	void action_Macro_Menu_Command(DocumentWidget *document, const QString &name);
 	void action_Mark(DocumentWidget *document);
 	void action_Mark(DocumentWidget *document, const QString &mark);
+	void action_Mark_All(DocumentWidget *document);
+	void action_Mark_All(DocumentWidget *document, const QString &searchString, SearchType type);
 	void action_Move_Tab_To(DocumentWidget *document);
 	void action_New(DocumentWidget *document, NewMode mode = NewMode::Prefs);
 	void action_Open(DocumentWidget *document);
@@ -329,10 +336,12 @@ public:
 	void action_Find_Again_triggered();
 	void action_Find_Selection_triggered();
 	void action_Find_Incremental_triggered();
+	void action_Find_In_Files_triggered();
 	void action_Replace_triggered();
 	void action_Replace_Find_Again_triggered();
 	void action_Replace_Again_triggered();
 	void action_Mark_triggered();
+	void action_Mark_All_triggered();
 	void action_Goto_Mark_triggered();
 	void action_Goto_Matching_triggered();
 	void action_Show_Calltip_triggered();
@@ -346,6 +355,7 @@ public:
 	void action_Split_Pane_triggered();
 	void action_Close_Pane_triggered();
 	void action_Move_Tab_To_triggered();
+	void action_Memory_Usage_triggered();
 
 	void action_Statistics_Line_toggled(bool state);
 	void action_Incremental_Search_Line_toggled(bool state);
@@ -430,11 +440,13 @@ public:
 private:
 	QList<QAction *> previousOpenFilesList_;
 	QPointer<DialogFind> dialogFind_;
+	QPointer<DialogFindInFiles> dialogFindInFiles_;
 	QPointer<DialogReplace> dialogReplace_;
 	QPointer<DialogShellMenu> dialogShellMenu_;
 	QPointer<DialogMacros> dialogMacros_;
 	QPointer<DialogWindowBackgroundMenu> dialogWindowBackgroundMenu_;
 	QPointer<TextArea> lastFocus_;
+	MatchCounter *matchCounter_ = nullptr;
 
 private:
 	bool iSearchLastLiteralCase_    = false;          // idem, for literal mode
@@ -442,6 +454,22 @@ private:
 	int iSearchHistIndex_           = 0;              // find and replace dialogs
 	TextCursor iSearchLastBeginPos_ = {};             // beg. pos. last match of current i.s.
 	TextCursor iSearchStartPos_     = TextCursor(-1); // start pos. of current incr. search
+	QTimer *iSearchTimer_           = nullptr;        // postpones regex incremental searches while typing
+
+	// the previous incremental search, which a literal search for a longer
+	// string can resume from (reset whenever the document is modified)
+	struct ISearchResume {
+		QPointer<DocumentWidget> document;
+		QString searchString;
+		SearchType searchType = SearchType::Literal;
+		Direction direction   = Direction::Forward;
+		WrapMode searchWrap   = WrapMode::NoWrap;
+		TextCursor beginPos;
+		TextCursor matchStart;
+		bool found = false;
+	};
+
+	ISearchResume iSearchResume_;
 
 public:
 	Ui::MainWindow ui;
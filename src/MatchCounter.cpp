@@ -0,0 +1,204 @@
+
+#include "MatchCounter.h"
+#include "DocumentWidget.h"
+#include "Search.h"
+#include "TextBuffer.h"
+
+#include <QTimer>
+#include <QtConcurrent>
+
+/**
+ * @brief MatchCounter::MatchCounter
+ * @param parent
+ */
+MatchCounter::MatchCounter(QObject *parent)
+	: QObject(parent) {
+
+	connect(&watcher_, &QFutureWatcher<Count>::finished, this, &MatchCounter::countFinished);
+}
+
+/**
+ * @brief MatchCounter::~MatchCounter
+ */
+MatchCounter::~MatchCounter() {
+	stop();
+	release();
+}
+
+/**
+ * @brief MatchCounter::start
+ * @param document
+ * @param searchString
+ * @param searchType
+ * @param matchStart the start of the match which was just selected
+ */
+void MatchCounter::start(DocumentWidget *document, const QString &searchString, SearchType searchType, TextCursor matchStart) {
+
+	cancel();
+
+	// the worker counts in its own copy of the text, so the buffer may be
+	// freely edited (which cancels the count) while it runs. The copy is kept
+	// until the buffer changes, so repeated searches don't copy it again. A
+	// document which is viewed straight from its file is counted in the
+	// mapping instead, which stays valid for as long as the worker holds it
+	if (document != document_ || !snapshot_) {
+		release();
+
+		document_ = document;
+
+		if (std::shared_ptr<QFile> mapping = document->mappedFile()) {
+			text_     = document->buffer()->BufAsString();
+			snapshot_ = std::move(mapping);
+		} else {
+			auto copy = std::make_shared<std::string>(document->buffer()->BufAsString().to_string());
+			text_     = *copy;
+			snapshot_ = std::move(copy);
+		}
+
+		document->buffer()->BufAddModifyCB(modifiedCB, this);
+		connect(document, &DocumentWidget::documentClosed, this, &MatchCounter::documentClosed);
+	}
+
+	auto cancelled = std::make_shared<std::atomic<bool>>(false);
+	cancelled_     = cancelled;
+
+	std::shared_ptr<const void> snapshot = snapshot_;
+	const view::string_view text         = text_;
+	const QString delimiters             = document->getWindowDelimiters();
+	const int64_t start                  = to_integer(matchStart);
+
+	watcher_.setFuture(QtConcurrent::run([snapshot, text, cancelled, searchString, searchType, delimiters, start]() {
+		const Search::MatchCount matches = Search::CountMatches(text, searchString, searchType, delimiters, start, *cancelled);
+
+		Count count;
+		count.index = matches.before;
+		count.total = matches.total;
+		return count;
+	}));
+}
+
+/**
+ * @brief MatchCounter::cancel
+ */
+void MatchCounter::cancel() {
+
+	const bool hadCount = counted_;
+
+	stop();
+
+	if (hadCount && document_) {
+		Q_EMIT countChanged(document_);
+	}
+}
+
+/**
+ * @brief MatchCounter::stop
+ */
+void MatchCounter::stop() {
+
+	if (cancelled_) {
+		cancelled_->store(true);
+		cancelled_ = nullptr;
+	}
+
+	counted_ = false;
+}
+
+/**
+ * @brief MatchCounter::release
+ */
+void MatchCounter::release() {
+
+	if (document_) {
+		document_->buffer()->BufRemoveModifyCB(modifiedCB, this);
+		disconnect(document_, &DocumentWidget::documentClosed, this, &MatchCounter::documentClosed);
+	}
+
+	document_ = nullptr;
+	snapshot_ = nullptr;
+	text_     = view::string_view();
+}
+
+/**
+ * @brief MatchCounter::documentClosed
+ */
+void MatchCounter::documentClosed() {
+	cancel();
+	release();
+}
+
+/**
+ * @brief MatchCounter::message
+ * @param document
+ * @return the text to show in the statistics line of document, or an empty
+ * string if there is nothing to show for it
+ */
+QString MatchCounter::message(const DocumentWidget *document) const {
+
+	if (!counted_ || document != document_) {
+		return QString();
+	}
+
+	return tr("match %1 of %2").arg(std::min(count_.index + 1, count_.total)).arg(count_.total);
+}
+
+/**
+ * @brief MatchCounter::countFinished
+ */
+void MatchCounter::countFinished() {
+
+	// a stale result from a count we have since abandoned
+	if (!cancelled_ || cancelled_->load() || !document_) {
+		return;
+	}
+
+	count_   = watcher_.result();
+	counted_ = true;
+
+	Q_EMIT countChanged(document_);
+}
+
+/**
+ * @brief MatchCounter::modifiedCB
+ * @param pos
+ * @param nInserted
+ * @param nDeleted
+ * @param nRestyled
+ * @param deletedText
+ * @param user
+ */
+void MatchCounter::modifiedCB(TextCursor pos, int64_t nInserted, int64_t nDeleted, int64_t nRestyled, view::string_view deletedText, void *user) {
+
+	Q_UNUSED(pos)
+	Q_UNUSED(nRestyled)
+	Q_UNUSED(deletedText)
+
+	if (nInserted == 0 && nDeleted == 0) {
+		return;
+	}
+
+	auto counter = static_cast<MatchCounter *>(user);
+
+	// stop the worker and drop the now stale snapshot right away, but we can't
+	// remove ourselves from the buffer's callback list while it is being
+	// iterated, so the rest of the cleanup is deferred. If a new search has
+	// taken a fresh snapshot by then, there is nothing left to do
+	if (counter->cancelled_) {
+		counter->cancelled_->store(true);
+	}
+
+	counter->snapshot_ = nullptr;
+	counter->text_     = view::string_view();
+
+	if (!counter->releasePending_) {
+		counter->releasePending_ = true;
+
+		QTimer::singleShot(0, counter, [counter]() {
+			counter->releasePending_ = false;
+			if (!counter->snapshot_) {
+				counter->cancel();
+				counter->release();
+			}
+		});
+	}
+}
@@ -0,0 +1,64 @@
+
+#ifndef MATCH_COUNTER_H_
+#define MATCH_COUNTER_H_
+
+#include "SearchType.h"
+#include "TextCursor.h"
+#include "Util/string_view.h"
+
+#include <QFutureWatcher>
+#include <QObject>
+#include <QPointer>
+#include <QString>
+
+#include <atomic>
+#include <memory>
+
+class DocumentWidget;
+
+/*
+** Counts the matches of the most recent search on a worker thread, so that the
+** statistics line can show "match N of M" without blocking the GUI on large
+** files. The count is made against a snapshot of the buffer and is abandoned
+** as soon as the buffer changes or another search is started.
+*/
+class MatchCounter : public QObject {
+	Q_OBJECT
+
+public:
+	struct Count {
+		int64_t index = 0;
+		int64_t total = 0;
+	};
+
+public:
+	explicit MatchCounter(QObject *parent = nullptr);
+	~MatchCounter() override;
+
+Q_SIGNALS:
+	void countChanged(DocumentWidget *document);
+
+public:
+	void start(DocumentWidget *document, const QString &searchString, SearchType searchType, TextCursor matchStart);
+	void cancel();
+	QString message(const DocumentWidget *document) const;
+
+private:
+	static void modifiedCB(TextCursor pos, int64_t nInserted, int64_t nDeleted, int64_t nRestyled, view::string_view deletedText, void *user);
+	void countFinished();
+	void documentClosed();
+	void release();
+	void stop();
+
+private:
+	QPointer<DocumentWidget> document_;
+	QFutureWatcher<Count> watcher_;
+	std::shared_ptr<const void> snapshot_; // keeps the text being counted alive
+	view::string_view text_;
+	std::shared_ptr<std::atomic<bool>> cancelled_;
+	Count count_;
+	bool counted_        = false;
+	bool releasePending_ = false;
+};
+
+#endif
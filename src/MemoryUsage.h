@@ -0,0 +1,28 @@
+
+#ifndef MEMORY_USAGE_H_
+#define MEMORY_USAGE_H_
+
+#include <cstdint>
+
+// where the text of a document is kept
+enum class Residence {
+	Memory,     // in memory, as usual
+	Mapped,     // viewed straight from the file
+	NotRead,    // not read from the file yet
+	Hibernated, // to be read from the file again
+	Snapshot    // written to a temporary file
+};
+
+// how much memory a document takes up, in bytes
+struct MemoryUsage {
+	int64_t text     = 0; // the text itself
+	int64_t styles   = 0; // the syntax highlighting of the text
+	int64_t undo     = 0; // the undo and redo lists
+	int64_t snapshot = 0; // the temporary file the text is in while it's hibernated, on disk rather than in memory
+
+	int64_t total() const {
+		return text + styles + undo;
+	}
+};
+
+#endif
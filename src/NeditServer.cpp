@@ -373,6 +373,10 @@ void NeditServer::newConnection() {
 		if (document) {
 
 			if (lineNum > 0) {
+				// a file opened in the background hasn't been read yet, and one
+				// which was already open may have been hibernated since
+				document->makeResident();
+
 				// NOTE(eteran): this was previously window->lastFocus, but that
 				// is very inconvinient to get at this point in the code (now)
 				// firstPane() seems practical for now
@@ -1165,6 +1165,30 @@ bool GetPrefHonorSymlinks() {
 	return Settings::honorSymlinks;
 }
 
+bool GetPrefBackgroundSave() {
+	return Settings::backgroundSave;
+}
+
+bool GetPrefSyncOnSave() {
+	return Settings::syncOnSave;
+}
+
+bool GetPrefRecompressOnSave() {
+	return Settings::recompressOnSave;
+}
+
+bool GetPrefDeferredOpen() {
+	return Settings::deferredOpen;
+}
+
+bool GetPrefPrefetchDeferred() {
+	return Settings::prefetchDeferred;
+}
+
+int GetPrefDocumentMemoryLimit() {
+	return Settings::documentMemoryLimit;
+}
+
 TruncSubstitution GetPrefTruncSubstitution() {
 	return Settings::truncSubstitution;
 }
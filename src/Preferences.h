@@ -35,8 +35,10 @@ bool GetPrefAlwaysCheckRelTagsSpecs();
 bool GetPrefAppendLF();
 bool GetPrefAutoSave();
 bool GetPrefAutoScroll();
+bool GetPrefBackgroundSave();
 bool GetPrefBacklightChars();
 bool GetPrefBeepOnSearchWrap();
+bool GetPrefDeferredOpen();
 bool GetPrefFindReplaceUsesSelection();
 bool GetPrefFocusOnRaise();
 bool GetPrefForceOSConversion();
@@ -44,16 +46,20 @@ bool GetPrefHighlightSyntax();
 bool GetPrefHonorSymlinks();
 bool GetPrefKeepSearchDlogs();
 bool GetPrefOpenInTab();
+bool GetPrefPrefetchDeferred();
+bool GetPrefRecompressOnSave();
 bool GetPrefRepositionDialogs();
 bool GetPrefSaveOldVersion();
 bool GetPrefSearchDlogs();
 bool GetPrefSortTabs();
+bool GetPrefSyncOnSave();
 bool GetPrefTabBar();
 bool GetPrefUndoModifiesSelection();
 bool GetPrefWarnExit();
 bool GetPrefSmartHome();
 IndentStyle GetPrefAutoIndent(size_t langMode);
 int GetPrefCols();
+int GetPrefDocumentMemoryLimit();
 int GetPrefEmTabDist(size_t langMode);
 int GetPrefGlobalTabNavigate();
 int GetPrefInsertTabs(size_t langMode);
@@ -7,12 +7,16 @@
 #include "Regex.h"
 #include "TextBuffer.h"
 #include "TruncSubstitution.h"
+#include "Util/LiteralSearch.h"
 #include "Util/String.h"
 #include "Util/algorithm.h"
 #include "Util/utils.h"
 #include "WrapStyle.h"
 #include "userCmds.h"
 
+#include <QThread>
+#include <QtConcurrent>
+
 #include <gsl/gsl_util>
 
 #include <algorithm>
@@ -20,12 +24,16 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <memory>
 
 namespace {
 
 // Maximum length of search string history
 constexpr int MAX_SEARCH_HISTORY = 100;
 
+// Strings smaller than this many bytes per thread are searched sequentially
+constexpr int64_t FIND_ALL_CHUNK_SIZE = 4 * 1024 * 1024;
+
 // History mechanism for search and replace strings
 Search::HistoryEntry SearchReplaceHistory[MAX_SEARCH_HISTORY];
 int NHist     = 0;
@@ -164,6 +172,21 @@ boost::optional<Search::Result> searchRegex(view::string_view string, view::stri
 	Q_UNREACHABLE();
 }
 
+/**
+ * @brief makeLiteralResult
+ * @param pos
+ * @param length
+ * @return
+ */
+Search::Result makeLiteralResult(size_t pos, size_t length) {
+	Search::Result result;
+	result.start    = static_cast<int64_t>(pos);
+	result.end      = static_cast<int64_t>(pos + length);
+	result.extentBW = result.start;
+	result.extentFW = result.end;
+	return result;
+}
+
 /**
  * @brief searchLiteral
  * @param string
@@ -182,53 +205,26 @@ boost::optional<Search::Result> searchLiteral(view::string_view string, view::st
 
 	std::string lcString;
 	std::string ucString;
+	view::string_view upper = searchString;
+	view::string_view lower = searchString;
 
-	if (caseSensitivity == Qt::CaseSensitive) {
-		lcString = searchString.to_string();
-		ucString = searchString.to_string();
-	} else {
+	if (caseSensitivity == Qt::CaseInsensitive) {
 		ucString = to_upper(searchString);
 		lcString = to_lower(searchString);
+		upper    = ucString;
+		lower    = lcString;
 	}
 
-	const auto first = string.begin();
-	const auto mid   = first + beginPos;
-	const auto last  = string.end();
-
-	auto do_search = [&](view::string_view::iterator it) -> boost::optional<Search::Result> {
-		if (*it == ucString[0] || *it == lcString[0]) {
-			// matched first character
-			auto ucPtr   = ucString.begin();
-			auto lcPtr   = lcString.begin();
-			auto tempPtr = it;
-
-			while (tempPtr != last && (*tempPtr == *ucPtr || *tempPtr == *lcPtr)) {
-				++tempPtr;
-				++ucPtr;
-				++lcPtr;
-
-				if (ucPtr == ucString.end()) {
-					// matched whole string
-					Search::Result result;
-					result.start    = it - string.begin();
-					result.end      = tempPtr - string.begin();
-					result.extentBW = result.start;
-					result.extentFW = result.end;
-					return result;
-				}
-			}
-		}
-
-		return boost::none;
-	};
+	const size_t length = string.size();
 
 	if (direction == Direction::Forward) {
 
+		const auto mid = static_cast<size_t>(qBound<int64_t>(0, beginPos, static_cast<int64_t>(length)));
+
 		// search from beginPos to end of string
-		for (auto it = mid; it != last; ++it) {
-			if (boost::optional<Search::Result> result = do_search(it)) {
-				return result;
-			}
+		size_t pos = find_literal(string, upper, lower, mid, length);
+		if (pos != view::string_view::npos) {
+			return makeLiteralResult(pos, searchString.size());
 		}
 
 		if (wrap == WrapMode::NoWrap) {
@@ -236,10 +232,9 @@ boost::optional<Search::Result> searchLiteral(view::string_view string, view::st
 		}
 
 		// search from start of file to beginPos
-		for (auto it = first; it != mid; ++it) {
-			if (boost::optional<Search::Result> result = do_search(it)) {
-				return result;
-			}
+		pos = find_literal(string, upper, lower, 0, mid);
+		if (pos != view::string_view::npos) {
+			return makeLiteralResult(pos, searchString.size());
 		}
 
 		return boost::none;
@@ -248,11 +243,12 @@ boost::optional<Search::Result> searchLiteral(view::string_view string, view::st
 		// search from beginPos to start of file.  A negative begin pos
 		// says begin searching from the far end of the file
 
+		const auto mid = static_cast<size_t>(qBound<int64_t>(0, beginPos, static_cast<int64_t>(length)));
+
 		if (beginPos >= 0) {
-			for (auto it = mid; it >= first; --it) {
-				if (boost::optional<Search::Result> result = do_search(it)) {
-					return result;
-				}
+			const size_t pos = rfind_literal(string, upper, lower, 0, mid + 1);
+			if (pos != view::string_view::npos) {
+				return makeLiteralResult(pos, searchString.size());
 			}
 		}
 
@@ -261,10 +257,9 @@ boost::optional<Search::Result> searchLiteral(view::string_view string, view::st
 		}
 
 		// search from end of file to beginPos
-		for (auto it = last; it >= mid; --it) {
-			if (boost::optional<Search::Result> result = do_search(it)) {
-				return result;
-			}
+		const size_t pos = rfind_literal(string, upper, lower, mid, length + 1);
+		if (pos != view::string_view::npos) {
+			return makeLiteralResult(pos, searchString.size());
 		}
 
 		return boost::none;
@@ -293,43 +288,39 @@ boost::optional<Search::Result> searchLiteralWord(view::string_view string, view
 
 	std::string lcString;
 	std::string ucString;
-	bool cignore_L = false;
-	bool cignore_R = false;
-
-	const auto first = string.begin();
-	const auto mid   = first + beginPos;
-	const auto last  = string.end();
-
-	auto do_search_word = [&](const view::string_view::iterator it) -> boost::optional<Search::Result> {
-		if (*it == ucString[0] || *it == lcString[0]) {
-
-			// matched first character
-			auto ucPtr   = ucString.begin();
-			auto lcPtr   = lcString.begin();
-			auto tempPtr = it;
-
-			while (tempPtr != last && (*tempPtr == *ucPtr || *tempPtr == *lcPtr)) {
-				++tempPtr;
-				++ucPtr;
-				++lcPtr;
-
-				if (ucPtr == ucString.end() &&                                                        // matched whole string
-					(cignore_R || safe_ctype<isspace>(*tempPtr) || ::strchr(delimiters, *tempPtr)) && // next char right delimits word ?
-					(cignore_L || it == string.begin() ||                                             // border case
-					 safe_ctype<isspace>(it[-1]) || ::strchr(delimiters, it[-1]))) {                  // next char left delimits word ?
-
-					Search::Result result;
-					result.start    = it - string.begin();
-					result.end      = tempPtr - string.begin();
-					result.extentBW = result.start;
-					result.extentFW = result.end;
-					return result;
-				}
+	view::string_view upper = searchString;
+	view::string_view lower = searchString;
+	bool cignore_L          = false;
+	bool cignore_R          = false;
 
-				// NOTE(eteran): this doesn't seem possible, but just being careful
-				if (ucPtr == ucString.end()) {
-					break;
-				}
+	const size_t length = string.size();
+
+	// the literal search finds the candidates, here we only need to check
+	// that they are delimited as a whole word
+	auto is_word = [&](size_t pos) {
+		const size_t end = pos + searchString.size();
+
+		// the end of the text counts as a delimiter
+		const bool delimitedRight = cignore_R || end == length || safe_ctype<isspace>(string[end]) || ::strchr(delimiters, string[end]);
+		const bool delimitedLeft  = cignore_L || pos == 0 || safe_ctype<isspace>(string[pos - 1]) || ::strchr(delimiters, string[pos - 1]);
+
+		return delimitedRight && delimitedLeft;
+	};
+
+	auto find_word = [&](size_t first, size_t last) -> boost::optional<Search::Result> {
+		for (size_t pos = find_literal(string, upper, lower, first, last); pos != view::string_view::npos; pos = find_literal(string, upper, lower, pos + 1, last)) {
+			if (is_word(pos)) {
+				return makeLiteralResult(pos, searchString.size());
+			}
+		}
+
+		return boost::none;
+	};
+
+	auto rfind_word = [&](size_t first, size_t last) -> boost::optional<Search::Result> {
+		for (size_t pos = rfind_literal(string, upper, lower, first, last); pos != view::string_view::npos; pos = rfind_literal(string, upper, lower, first, pos)) {
+			if (is_word(pos)) {
+				return makeLiteralResult(pos, searchString.size());
 			}
 		}
 
@@ -350,21 +341,20 @@ boost::optional<Search::Result> searchLiteralWord(view::string_view string, view
 		cignore_R = true;
 	}
 
-	if (caseSensitivity == Qt::CaseSensitive) {
-		ucString = searchString.to_string();
-		lcString = searchString.to_string();
-	} else {
+	if (caseSensitivity == Qt::CaseInsensitive) {
 		ucString = to_upper(searchString);
 		lcString = to_lower(searchString);
+		upper    = ucString;
+		lower    = lcString;
 	}
 
+	const auto mid = static_cast<size_t>(qBound<int64_t>(0, beginPos, static_cast<int64_t>(length)));
+
 	if (direction == Direction::Forward) {
 
 		// search from beginPos to end of string
-		for (auto it = mid; it != last; ++it) {
-			if (boost::optional<Search::Result> result = do_search_word(it)) {
-				return result;
-			}
+		if (boost::optional<Search::Result> result = find_word(mid, length)) {
+			return result;
 		}
 
 		if (wrap == WrapMode::NoWrap) {
@@ -372,22 +362,15 @@ boost::optional<Search::Result> searchLiteralWord(view::string_view string, view
 		}
 
 		// search from start of file to beginPos
-		for (auto it = first; it != mid; ++it) {
-			if (boost::optional<Search::Result> result = do_search_word(it)) {
-				return result;
-			}
-		}
-		return boost::none;
+		return find_word(0, mid);
 	} else {
 		// Direction::Backward
 		// search from beginPos to start of file. A negative begin pos
 		// says begin searching from the far end of the file
 
 		if (beginPos >= 0) {
-			for (auto it = mid; it >= first; --it) {
-				if (boost::optional<Search::Result> result = do_search_word(it)) {
-					return result;
-				}
+			if (boost::optional<Search::Result> result = rfind_word(0, mid + 1)) {
+				return result;
 			}
 		}
 
@@ -396,12 +379,7 @@ boost::optional<Search::Result> searchLiteralWord(view::string_view string, view
 		}
 
 		// search from end of file to beginPos
-		for (auto it = last; it >= mid; --it) {
-			if (boost::optional<Search::Result> result = do_search_word(it)) {
-				return result;
-			}
-		}
-		return boost::none;
+		return rfind_word(mid, length + 1);
 	}
 }
 
@@ -450,6 +428,104 @@ bool replaceUsingRegex(view::string_view searchStr, view::string_view replaceStr
 	}
 }
 
+/**
+ * @brief nextSearchPos
+ * @param result
+ * @return where to continue a forward search for all matches after result
+ */
+int64_t nextSearchPos(const Search::Result &result) {
+	// start next after match unless match was empty, then endPos+1
+	return (result.start == result.end) ? result.end + 1 : result.end;
+}
+
+/*
+** Finds successive forward matches of a search string in a string. A regular
+** expression is compiled only once, rather than for every match. Only matches
+** which begin before "last" are reported, but they may extend beyond it, so
+** that the text can be scanned in independent pieces.
+*/
+class MatchFinder {
+public:
+	MatchFinder(view::string_view string, view::string_view searchString, SearchType searchType, const char *delimiters)
+		: string_(string), searchString_(searchString), searchType_(searchType), delimiters_(delimiters) {
+
+		if (Search::isRegexType(searchType)) {
+			try {
+				regex_ = std::make_unique<Regex>(searchString, Search::defaultRegexFlags(searchType));
+			} catch (const RegexError &e) {
+				Q_UNUSED(e)
+			}
+		}
+	}
+
+public:
+	boost::optional<Search::Result> find(int64_t pos, int64_t last) const {
+
+		const auto length = static_cast<int64_t>(string_.size());
+		if (pos >= last || pos > length) {
+			return boost::none;
+		}
+
+		boost::optional<Search::Result> result;
+
+		if (Search::isRegexType(searchType_)) {
+			if (!regex_) {
+				return boost::none;
+			}
+
+			try {
+				const auto end = static_cast<size_t>(std::min(last, length));
+				const int prev = (pos == 0) ? -1 : string_[static_cast<size_t>(pos - 1)];
+
+				if (!regex_->execute(string_, static_cast<size_t>(pos), end, prev, -1, delimiters_, false)) {
+					return boost::none;
+				}
+			} catch (const RegexError &e) {
+				Q_UNUSED(e)
+				return boost::none;
+			}
+
+			result           = Search::Result();
+			result->start    = regex_->startp[0] - &string_[0];
+			result->end      = regex_->endp[0] - &string_[0];
+			result->extentFW = regex_->extentpFW - &string_[0];
+			result->extentBW = regex_->extentpBW - &string_[0];
+		} else {
+			// a literal match which starts before last can't extend further
+			// than this, but we keep one more character so that whole word
+			// searches can still see the delimiter which follows it
+			const auto limit = static_cast<size_t>(std::min(length, last + static_cast<int64_t>(searchString_.size())));
+			result           = SearchStringEx(string_.substr(0, limit), searchString_, Direction::Forward, searchType_, WrapMode::NoWrap, pos, delimiters_);
+		}
+
+		if (!result || result->start >= last) {
+			return boost::none;
+		}
+
+		return result;
+	}
+
+	std::vector<Search::Result> findAll(int64_t first, int64_t last) const {
+
+		std::vector<Search::Result> results;
+
+		int64_t pos = first;
+		while (boost::optional<Search::Result> result = find(pos, last)) {
+			results.push_back(*result);
+			pos = nextSearchPos(*result);
+		}
+
+		return results;
+	}
+
+private:
+	view::string_view string_;
+	view::string_view searchString_;
+	SearchType searchType_;
+	const char *delimiters_;
+	std::unique_ptr<Regex> regex_;
+};
+
 }
 
 /*
@@ -588,6 +664,129 @@ boost::optional<std::string> Search::ReplaceAllInString(view::string_view inStri
 	return outString;
 }
 
+/*
+** Finds every match of "searchString" in "string", in the same order and with
+** the same handling of overlapping and empty matches as repeatedly searching
+** forward from the end of the previous match would.
+**
+** Large strings are split into chunks which are scanned concurrently, each
+** collecting the matches which begin within it. A match may run past the end
+** of its chunk, in which case the next chunk may have found matches which
+** overlap it, so at each seam the sequential scan is continued until it falls
+** back in step with the matches found for the chunk.
+*/
+std::vector<Search::Result> Search::FindAll(view::string_view string, const QString &searchString, SearchType searchType, const QString &delimiters) {
+
+	if (searchString.isEmpty()) {
+		return {};
+	}
+
+	const std::string search         = searchString.toStdString();
+	const QByteArray delimiterString = delimiters.toLatin1();
+	const char *delims               = delimiters.isNull() ? nullptr : delimiterString.data();
+	const MatchFinder finder(string, search, searchType, delims);
+
+	const auto length     = static_cast<int64_t>(string.size());
+	const int64_t nChunks = std::min<int64_t>(QThread::idealThreadCount(), length / FIND_ALL_CHUNK_SIZE);
+
+	// the last chunk also takes in a possible empty match at the very end
+	if (nChunks < 2) {
+		return finder.findAll(0, length + 1);
+	}
+
+	std::vector<int64_t> bounds;
+	for (int64_t i = 0; i < nChunks; ++i) {
+		bounds.push_back(i * (length / nChunks));
+	}
+	bounds.push_back(length + 1);
+
+	std::vector<QFuture<std::vector<Result>>> futures;
+	for (size_t i = 0; i + 1 < bounds.size(); ++i) {
+		const int64_t first = bounds[i];
+		const int64_t last  = bounds[i + 1];
+
+		futures.push_back(QtConcurrent::run([string, &search, searchType, delims, first, last]() {
+			const MatchFinder chunkFinder(string, search, searchType, delims);
+			return chunkFinder.findAll(first, last);
+		}));
+	}
+
+	std::vector<Result> results;
+
+	for (size_t i = 0; i < futures.size(); ++i) {
+		const std::vector<Result> chunk = futures[i].result();
+		auto it                         = chunk.begin();
+
+		if (!results.empty() && nextSearchPos(results.back()) > bounds[i]) {
+			int64_t pos = nextSearchPos(results.back());
+
+			for (;;) {
+				boost::optional<Result> result = finder.find(pos, bounds[i + 1]);
+				if (!result) {
+					it = chunk.end();
+					break;
+				}
+
+				it = std::find_if(it, chunk.end(), [&result](const Result &r) {
+					return r.start >= result->start;
+				});
+
+				// from here on, the chunk's matches are exactly what the
+				// sequential scan would find
+				if (it != chunk.end() && it->start == result->start && it->end == result->end) {
+					break;
+				}
+
+				results.push_back(*result);
+				pos = nextSearchPos(*result);
+			}
+		}
+
+		results.insert(results.end(), it, chunk.end());
+	}
+
+	return results;
+}
+
+/*
+** Counts the matches of "searchString" in "string", and how many of them begin
+** before "pos", finding them the same way as FindAll but without keeping them.
+** The regular expression is compiled only once. Stops early, with a partial
+** count, once "cancelled" is set.
+*/
+Search::MatchCount Search::CountMatches(view::string_view string, const QString &searchString, SearchType searchType, const QString &delimiters, int64_t pos, const std::atomic<bool> &cancelled) {
+
+	MatchCount count;
+
+	if (searchString.isEmpty()) {
+		return count;
+	}
+
+	const std::string search         = searchString.toStdString();
+	const QByteArray delimiterString = delimiters.toLatin1();
+	const char *delims               = delimiters.isNull() ? nullptr : delimiterString.data();
+	const MatchFinder finder(string, search, searchType, delims);
+
+	const auto last = static_cast<int64_t>(string.size()) + 1;
+	int64_t next    = 0;
+
+	while (!cancelled.load(std::memory_order_relaxed)) {
+		boost::optional<Result> result = finder.find(next, last);
+		if (!result) {
+			break;
+		}
+
+		if (result->start < pos) {
+			++count.before;
+		}
+
+		++count.total;
+		next = nextSearchPos(*result);
+	}
+
+	return count;
+}
+
 /**
  * @brief Search::SearchString
  * @param string
@@ -9,6 +9,8 @@
 
 #include <QString>
 #include <boost/optional.hpp>
+#include <atomic>
+#include <vector>
 
 class DocumentWidget;
 class MainWindow;
@@ -30,12 +32,19 @@ struct Result {
 	int64_t extentFW = 0;
 };
 
+struct MatchCount {
+	int64_t before = 0; // matches which start before the position asked about
+	int64_t total  = 0;
+};
+
 bool isRegexType(SearchType searchType);
 bool replaceUsingRE(const QString &searchStr, const QString &replaceStr, view::string_view sourceStr, int64_t beginPos, std::string &dest, int prevChar, const QString &delimiters, int defaultFlags);
 bool SearchString(view::string_view string, const QString &searchString, Direction direction, SearchType searchType, WrapMode wrap, int64_t beginPos, Result *result, const QString &delimiters);
 boost::optional<Result> SearchString(view::string_view string, const QString &searchString, Direction direction, SearchType searchType, WrapMode wrap, int64_t beginPos, const QString &delimiters);
+MatchCount CountMatches(view::string_view string, const QString &searchString, SearchType searchType, const QString &delimiters, int64_t pos, const std::atomic<bool> &cancelled);
 int defaultRegexFlags(SearchType searchType);
 int historyIndex(int nCycles);
+std::vector<Result> FindAll(view::string_view string, const QString &searchString, SearchType searchType, const QString &delimiters);
 boost::optional<std::string> ReplaceAllInString(view::string_view inString, const QString &searchString, const QString &replaceString, SearchType searchType, int64_t *copyStart, int64_t *copyEnd, const QString &delimiters);
 void saveSearchHistory(const QString &searchString, QString replaceString, SearchType searchType, bool isIncremental);
 HistoryEntry *HistoryByIndex(int index);
@@ -0,0 +1,206 @@
+
+#include "TagTable.h"
+
+#include <algorithm>
+
+/**
+ * @brief TagTable::nameOf
+ * @param entry
+ * @return
+ */
+view::string_view TagTable::nameOf(const Entry &entry) const {
+	return view::string_view(&arena_[entry.name], entry.nameLength);
+}
+
+/**
+ * @brief TagTable::lowerBound
+ * @param name
+ * @return the first entry whose name isn't less than name
+ */
+std::vector<TagTable::Entry>::const_iterator TagTable::lowerBound(view::string_view name) const {
+	return std::lower_bound(entries_.begin(), entries_.end(), name, [this](const Entry &entry, view::string_view value) {
+		return nameOf(entry).compare(value) < 0;
+	});
+}
+
+/**
+ * @brief TagTable::location
+ * @param file the source file as written in the tags file
+ * @param path the directory of the tags file
+ * @return the number by which entries refer to file and path, which is the
+ * same for every tag found in the same file
+ */
+int TagTable::location(view::string_view file, const QString &path) {
+
+	QHash<QByteArray, int> &ids = locationIds_[path];
+
+	const QByteArray key = QByteArray::fromRawData(file.data(), static_cast<int>(file.size()));
+
+	auto it = ids.find(key);
+	if (it != ids.end()) {
+		return *it;
+	}
+
+	const int id = static_cast<int>(locations_.size());
+	locations_.push_back({QString::fromLocal8Bit(file.data(), static_cast<int>(file.size())), path});
+
+	// the key has to own its data, unlike the one used to look it up
+	ids.insert(QByteArray(file.data(), static_cast<int>(file.size())), id);
+	return id;
+}
+
+/**
+ * @brief TagTable::insert
+ * @param name
+ * @param location as returned by TagTable::location
+ * @param language
+ * @param search
+ * @param posInf
+ * @param line the line number of the tag, if known
+ */
+void TagTable::insert(view::string_view name, int location, size_t language, view::string_view search, int64_t posInf, int64_t line) {
+
+	Entry entry;
+	entry.name         = arena_.size();
+	entry.nameLength   = static_cast<uint32_t>(name.size());
+	entry.search       = entry.name + name.size();
+	entry.searchLength = static_cast<uint32_t>(search.size());
+	entry.language     = language;
+	entry.posInf       = posInf;
+	entry.line         = static_cast<uint32_t>(line);
+	entry.location     = location;
+
+	arena_.append(name.data(), name.size());
+	arena_.append(search.data(), search.size());
+
+	if (sorted_ && !entries_.empty() && nameOf(entries_.back()).compare(name) > 0) {
+		sorted_ = false;
+	}
+
+	entries_.push_back(entry);
+}
+
+/**
+ * @brief TagTable::sort
+ */
+void TagTable::sort() {
+
+	if (sorted_) {
+		return;
+	}
+
+	// keep the tags of the same name in the order they were found in
+	std::stable_sort(entries_.begin(), entries_.end(), [this](const Entry &lhs, const Entry &rhs) {
+		return nameOf(lhs).compare(nameOf(rhs)) < 0;
+	});
+
+	sorted_ = true;
+}
+
+/**
+ * @brief TagTable::merge
+ * @param other the tags found after all of the ones in this table, usually
+ * read from the next part of the same tags file
+ */
+void TagTable::merge(TagTable &&other) {
+
+	if (entries_.empty() && locations_.empty()) {
+		const int64_t time = loadTime;
+		*this              = std::move(other);
+		loadTime += time;
+		return;
+	}
+
+	sort();
+	other.sort();
+
+	const size_t offset = arena_.size();
+	arena_.append(other.arena_);
+
+	std::vector<int> ids;
+	ids.reserve(other.locations_.size());
+	for (const Location &loc : other.locations_) {
+		const QByteArray file = loc.file.toLocal8Bit();
+		ids.push_back(location(view::string_view(file.data(), static_cast<size_t>(file.size())), loc.path));
+	}
+
+	const size_t middle = entries_.size();
+	entries_.reserve(entries_.size() + other.entries_.size());
+
+	for (Entry entry : other.entries_) {
+		entry.name += offset;
+		entry.search += offset;
+		entry.location = ids[static_cast<size_t>(entry.location)];
+		entries_.push_back(entry);
+	}
+
+	std::inplace_merge(entries_.begin(), entries_.begin() + static_cast<ptrdiff_t>(middle), entries_.end(), [this](const Entry &lhs, const Entry &rhs) {
+		return nameOf(lhs).compare(nameOf(rhs)) < 0;
+	});
+
+	loadTime += other.loadTime;
+
+	other = TagTable();
+}
+
+/**
+ * @brief TagTable::contains
+ * @param name
+ * @return
+ */
+bool TagTable::contains(view::string_view name) {
+	sort();
+
+	auto it = lowerBound(name);
+	return it != entries_.end() && nameOf(*it) == name;
+}
+
+/**
+ * @brief TagTable::values
+ * @param name
+ * @param index the index of the tags file this table was read from
+ * @param tags the list the tags called name are added to
+ */
+void TagTable::values(view::string_view name, int index, QList<Tags::Tag> *tags) {
+	sort();
+
+	for (auto it = lowerBound(name); it != entries_.end() && nameOf(*it) == name; ++it) {
+		const Location &loc = locations_[static_cast<size_t>(it->location)];
+
+		Tags::Tag tag = {
+			QString::fromLocal8Bit(&arena_[it->name], static_cast<int>(it->nameLength)),
+			loc.file,
+			QString::fromLocal8Bit(&arena_[it->search], static_cast<int>(it->searchLength)),
+			loc.path,
+			it->language,
+			it->posInf,
+			index,
+			it->line};
+
+		tags->push_back(tag);
+	}
+}
+
+/**
+ * @brief TagTable::size
+ * @return the number of tags in the table
+ */
+size_t TagTable::size() const {
+	return entries_.size();
+}
+
+/**
+ * @brief TagTable::memoryUsage
+ * @return roughly how many bytes the table takes up
+ */
+size_t TagTable::memoryUsage() const {
+
+	size_t usage = sizeof(TagTable) + arena_.capacity() + entries_.capacity() * sizeof(Entry) + locations_.capacity() * sizeof(Location);
+
+	for (const Location &loc : locations_) {
+		// the key stored for the location holds another copy of the name
+		usage += static_cast<size_t>(loc.file.size()) * sizeof(QChar) + static_cast<size_t>(loc.file.size());
+	}
+
+	return usage;
+}
@@ -0,0 +1,67 @@
+
+#ifndef TAG_TABLE_H_
+#define TAG_TABLE_H_
+
+#include "Tags.h"
+#include "Util/string_view.h"
+
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QString>
+
+#include <string>
+#include <vector>
+
+/*
+** The tags read from a single tags or calltips file. Instead of a Tag, with
+** four strings of its own, every entry is a handful of numbers: the names and
+** search strings are stored one after the other in a single arena, and the
+** names of the source files, which are the same for all of the tags found in
+** a file, are stored only once. The entries are sorted by name and looked up
+** with a binary search.
+*/
+class TagTable {
+public:
+	bool contains(view::string_view name);
+	int location(view::string_view file, const QString &path);
+	size_t memoryUsage() const;
+	size_t size() const;
+	void insert(view::string_view name, int location, size_t language, view::string_view search, int64_t posInf, int64_t line = 0);
+	void merge(TagTable &&other);
+	void sort();
+	void values(view::string_view name, int index, QList<Tags::Tag> *tags);
+
+public:
+	int64_t loadTime = 0;
+
+private:
+	struct Entry {
+		size_t name;
+		size_t search;
+		size_t language;
+		int64_t posInf;
+		uint32_t nameLength;
+		uint32_t searchLength;
+		uint32_t line;
+		int location;
+	};
+
+	struct Location {
+		QString file;
+		QString path;
+	};
+
+private:
+	view::string_view nameOf(const Entry &entry) const;
+	std::vector<Entry>::const_iterator lowerBound(view::string_view name) const;
+
+private:
+	std::string arena_;
+	std::vector<Entry> entries_;
+	std::vector<Location> locations_;
+	QHash<QString, QHash<QByteArray, int>> locationIds_;
+	bool sorted_ = true;
+};
+
+#endif
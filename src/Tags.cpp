@@ -5,21 +5,29 @@
 #include "MainWindow.h"
 #include "Preferences.h"
 #include "Search.h"
+#include "TagTable.h"
 #include "TextArea.h"
 #include "TextBuffer.h"
 #include "Util/FileSystem.h"
 #include "Util/Input.h"
+#include "Util/LiteralSearch.h"
 #include "Util/User.h"
 
 #include <gsl/gsl_util>
 
 #include <QApplication>
 #include <QDir>
+#include <QElapsedTimer>
 #include <QFile>
 #include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QFutureWatcher>
 #include <QMessageBox>
 #include <QRegularExpression>
 #include <QTextStream>
+#include <QThread>
+#include <QTimer>
+#include <QtConcurrent>
 
 #include <array>
 #include <cctype>
@@ -29,6 +37,7 @@
 #include <deque>
 #include <fstream>
 #include <iostream>
+#include <map>
 #include <memory>
 #include <sstream>
 #include <unordered_map>
@@ -42,6 +51,7 @@ namespace Tags {
 namespace {
 
 int loadTagsFile(const QString &tagSpec, int index, int recLevel);
+QFileSystemWatcher *tagsFileWatcher();
 
 struct CalltipAlias {
 	QString dest;
@@ -58,6 +68,12 @@ enum TFT {
 constexpr int MAX_LINE                        = 2048;
 constexpr int MAX_TAG_INCLUDE_RECURSION_LEVEL = 5;
 
+// ctags files smaller than this are not worth splitting up between threads
+constexpr size_t MIN_PARSE_CHUNK_SIZE = 1024 * 1024;
+
+// how long (msec) to wait after a tags file changes before reloading it
+constexpr int RELOAD_DELAY = 500;
+
 /* Take this many lines when making a tip from a tag.
    (should probably be a language-dependent option, but...) */
 constexpr int TIP_DEFAULT_LINES = 4;
@@ -65,8 +81,36 @@ constexpr int TIP_DEFAULT_LINES = 4;
 // used  in AddRelTagsFile and AddTagsFile
 int16_t tagFileIndex = 0;
 
-QMultiHash<QString, Tag> LoadedTags;
-QMultiHash<QString, Tag> LoadedTips;
+// the tags read from each tags/tips file, by the index of its File entry
+std::map<int, TagTable> LoadedTags;
+std::map<int, TagTable> LoadedTips;
+
+/*
+** The fields of a line of a ctags file, still pointing into the file
+*/
+struct CTagsLine {
+	view::string_view name;
+	view::string_view file;
+	view::string_view searchString;
+	int64_t posInf;
+	int64_t line;
+};
+
+/*
+** A sorted ctags file, which rather than being loaded up front is kept open
+** and binary searched every time a tag is looked up.
+*/
+struct SortedTagsFile {
+	QFile file;
+	QString tagPath;
+};
+
+// the sorted tags files in use, by the index of their entry in TagsFileList
+std::unordered_map<int, std::unique_ptr<SortedTagsFile>> SortedTagsFiles;
+
+// the tags files which are being reloaded in the background, by index, with
+// a count of their changes so that only the latest reload is used
+std::unordered_map<int, int> PendingReloads;
 
 // Check if a line has non-ws characters
 bool lineEmpty(const QString &line) {
@@ -88,8 +132,20 @@ QString rstrip(QString s) {
 	return s.replace(re, QString());
 }
 
-QList<Tag> getTagFromTable(QMultiHash<QString, Tag> &table, const QString &name) {
-	return table.values(name);
+view::string_view toView(const QByteArray &bytes) {
+	return view::string_view(bytes.data(), static_cast<size_t>(bytes.size()));
+}
+
+/*
+** The file a tag is found in, normalized so that tags found in the same file
+** through different tags files compare equal
+*/
+QString tagFullPath(const Tag &tag) {
+	if (QFileInfo(tag.file).isAbsolute()) {
+		return NormalizePathname(tag.file);
+	}
+
+	return NormalizePathname(tr("%1%2").arg(tag.path, tag.file));
 }
 
 /*
@@ -114,12 +170,115 @@ int64_t moveAheadNLines(view::string_view str, int64_t &pos, int64_t n) {
 	}
 }
 
+/*
+** Looks for the text a tag's search string describes as a plain string,
+** starting at <hint> and taking the closest match in either direction. This
+** is much quicker than the regular expression fakeRegExSearch builds, but
+** only finds the definition if its line hasn't changed at all, not even its
+** white space, so a miss here has to be retried with fakeRegExSearch.
+*/
+bool literalTagSearch(view::string_view buffer, const QString &searchString, int64_t hint, int64_t *startPos, int64_t *endPos) {
+
+	QString literal  = searchString;
+	bool atLineStart = false;
+	bool atLineEnd   = false;
+
+	// ctags search expressions are /^line$ or ?^line$, see parseCTagsLine
+	if (literal.startsWith(QLatin1Char('/')) || literal.startsWith(QLatin1Char('?'))) {
+		literal.remove(0, 1);
+
+		if (literal.startsWith(QLatin1Char('^'))) {
+			literal.remove(0, 1);
+			atLineStart = true;
+		}
+
+		if (literal.endsWith(QLatin1Char('$')) && !literal.endsWith(QLatin1String("\\$"))) {
+			literal.chop(1);
+			atLineEnd = true;
+		}
+
+		// ctags escapes slashes and backslashes, anything else is unexpected
+		QString unescaped;
+		unescaped.reserve(literal.size());
+
+		for (int i = 0; i < literal.size(); ++i) {
+			if (literal[i] == QLatin1Char('\\')) {
+				if (++i == literal.size() || (literal[i] != QLatin1Char('/') && literal[i] != QLatin1Char('\\'))) {
+					return false;
+				}
+			}
+			unescaped.append(literal[i]);
+		}
+
+		literal = unescaped;
+
+		// standard ctags leaves the CR of DOS line endings in the expression
+		if (literal.endsWith(QLatin1Char('\r'))) {
+			literal.chop(1);
+		}
+	}
+
+	const std::string text = literal.toStdString();
+	if (text.empty()) {
+		return false;
+	}
+
+	const view::string_view pattern = text;
+
+	auto matches = [&](size_t pos) {
+		const size_t end = pos + pattern.size();
+		return (!atLineStart || pos == 0 || buffer[pos - 1] == '\n') && (!atLineEnd || end == buffer.size() || buffer[end] == '\n');
+	};
+
+	const size_t from = static_cast<size_t>(qBound<int64_t>(0, hint, static_cast<int64_t>(buffer.size())));
+
+	size_t forward = view::string_view::npos;
+	for (size_t pos = from; (pos = find_literal(buffer, pattern, pattern, pos, buffer.size())) != view::string_view::npos; ++pos) {
+		if (matches(pos)) {
+			forward = pos;
+			break;
+		}
+	}
+
+	size_t backward = view::string_view::npos;
+	for (size_t last = from; last > 0;) {
+		const size_t pos = rfind_literal(buffer, pattern, pattern, 0, last);
+		if (pos == view::string_view::npos) {
+			break;
+		}
+
+		if (matches(pos)) {
+			backward = pos;
+			break;
+		}
+
+		last = pos;
+	}
+
+	size_t found;
+	if (forward == view::string_view::npos) {
+		found = backward;
+	} else if (backward == view::string_view::npos) {
+		found = forward;
+	} else {
+		found = (forward - from <= from - backward) ? forward : backward;
+	}
+
+	if (found == view::string_view::npos) {
+		return false;
+	}
+
+	*startPos = static_cast<int64_t>(found);
+	*endPos   = static_cast<int64_t>(found + pattern.size());
+	return true;
+}
+
 /**
- * @brief hashTableByType
+ * @brief tagTablesByType
  * @param mode
  * @return
  */
-QMultiHash<QString, Tag> *hashTableByType(SearchMode mode) {
+std::map<int, TagTable> *tagTablesByType(SearchMode mode) {
 	if (mode == SearchMode::TIP) {
 		return &LoadedTips;
 	} else {
@@ -140,66 +299,65 @@ std::deque<File> *tagListByType(SearchMode mode) {
 	}
 }
 
-/*  Delete a tag from the cache.
- *  Search is limited to valid matches of 'name','file', 'search', posInf, and 'index'.
- *  EX: delete all tags matching index 2 ==>
- *                      delTag(tagname,nullptr,-2,nullptr,-2,2);
- *  (posInf = -2 is an invalid match, posInf range: -1 .. +MAXINT,
-	 lang = -2 is also an invalid match)
+/*  Delete the tags read from the tags file with the given index from the
+ *  cache.
  */
 bool delTag(int index) {
-	int del = 0;
-
-	QMultiHash<QString, Tag> *table = hashTableByType(searchMode);
-
-	if (table->isEmpty()) {
-		return false;
-	}
+	std::map<int, TagTable> *tables = tagTablesByType(searchMode);
+	return tables->erase(index) != 0;
+}
 
-	for (auto it = table->begin(); it != table->end();) {
-		if (it->index == index) {
-			it = table->erase(it);
-			++del;
-		} else {
-			++it;
+/*
+** Reads the digits at the start of <text>
+*/
+int64_t parseLineNumber(view::string_view text) {
+	int64_t n = 0;
+	for (char ch : text) {
+		if (ch < '0' || ch > '9') {
+			break;
 		}
+		n = n * 10 + (ch - '0');
 	}
-
-	return del > 0;
+	return n;
 }
 
 /*
-** Scans one <line> from a ctags tags file (<index>) in tagPath.
-** Return value: Number of tag specs added.
+** Splits one <line> from a ctags tags file into its fields.
+** Return value: false if it isn't a tag specification.
 */
-int scanCTagsLine(const QString &line, const QString &tagPath, int index) {
+bool parseCTagsLine(view::string_view line, CTagsLine *tag) {
 
-	QRegExp regex(QLatin1String(R"(^([^\t]+)\t([^\t]+)\t([^\n]+)\n$)"));
-	if (!regex.exactMatch(line)) {
-		return 0;
+	if (!line.empty() && line.back() == '\r') {
+		line.remove_suffix(1);
 	}
 
-	if (regex.captureCount() != 3) {
-		return 0;
+	const size_t nameEnd = line.find('\t');
+	if (nameEnd == view::string_view::npos || nameEnd == 0) {
+		return false;
 	}
 
-	QString name         = regex.cap(1);
-	QString file         = regex.cap(2);
-	QString searchString = regex.cap(3);
+	const size_t fileEnd = line.find('\t', nameEnd + 1);
+	if (fileEnd == view::string_view::npos || fileEnd == nameEnd + 1 || fileEnd + 1 == line.size()) {
+		return false;
+	}
 
-	if (name.startsWith(QLatin1Char('!'))) {
-		return 0;
+	if (line[0] == '!') {
+		return false;
 	}
 
-	int pos;
+	view::string_view searchString = line.substr(fileEnd + 1);
+
+	tag->name = line.substr(0, nameEnd);
+	tag->line = 0;
+	tag->file = line.substr(nameEnd + 1, fileEnd - nameEnd - 1);
 
 	/*
 	** Guess the end of searchString:
 	** Try to handle original ctags and exuberant ctags format:
 	*/
-	if (searchString.startsWith(QLatin1Char('/')) || searchString.startsWith(QLatin1Char('?'))) {
+	if (searchString[0] == '/' || searchString[0] == '?') {
 
-		pos = -1; // "search expr without pos info"
+		tag->posInf = -1; // "search expr without pos info"
 
 		/* Situations: /<ANY expr>/\0
 		**             ?<ANY expr>?\0          --> original ctags
@@ -207,15 +365,22 @@ int scanCTagsLine(const QString &line, const QString &tagPath, int index) {
 		**             ?<ANY expr>?;"  <flags> --> exuberant ctags
 		*/
 
-		int posTagREEnd = searchString.lastIndexOf(QLatin1Char(';'));
+		const size_t posTagREEnd = searchString.rfind(';');
 
-		if (posTagREEnd == -1 ||
-			searchString.mid(posTagREEnd, 2) != QLatin1String(";\"") ||
-			searchString.startsWith(searchString.right(1))) {
+		if (posTagREEnd == view::string_view::npos ||
+			searchString.compare(posTagREEnd, 2, ";\"") != 0 ||
+			searchString.front() == searchString.back()) {
 			//  -> original ctags format = exuberant ctags format 1
 		} else {
-			// looks like exuberant ctags format 2
-			searchString = searchString.left(posTagREEnd);
+			// looks like exuberant ctags format 2, which may give the line
+			static const view::string_view lineField = "\tline:";
+
+			const size_t posLine = searchString.find(lineField, posTagREEnd);
+			if (posLine != view::string_view::npos) {
+				tag->line = parseLineNumber(searchString.substr(posLine + lineField.size()));
+			}
+
+			searchString = searchString.substr(0, posTagREEnd);
 		}
 
 		/*
@@ -224,23 +389,132 @@ int scanCTagsLine(const QString &line, const QString &tagPath, int index) {
 		**   ?<expression>?    becomes   ?<expression>
 		** This will save a little work in fakeRegExSearch.
 		*/
-		if (searchString.startsWith(searchString.right(1))) {
-			searchString.chop(1);
+		if (searchString.size() > 1 && searchString.front() == searchString.back()) {
+			searchString.remove_suffix(1);
 		}
+
+		tag->searchString = searchString;
 	} else {
-		pos = searchString.toInt();
-		searchString.clear();
-	}
-
-	// No ability to read language mode right now
-	return addTag(
-		name,
-		file,
-		PLAIN_LANGUAGE_MODE,
-		searchString,
-		pos,
-		tagPath,
-		index);
+		// a line number, possibly followed by ;" and the exuberant ctags flags
+		tag->posInf       = parseLineNumber(searchString);
+		tag->line         = tag->posInf;
+		tag->searchString = view::string_view();
+	}
+
+	return true;
+}
+
+/*
+** Parses the ctags lines in text[begin, end) into a table of their own.
+*/
+void parseCTagsLines(view::string_view text, size_t begin, size_t end, const QString &tagPath, TagTable *table) {
+
+	while (begin < end) {
+		size_t lineEnd = text.find('\n', begin);
+		if (lineEnd == view::string_view::npos) {
+			lineEnd = text.size();
+		}
+
+		CTagsLine tag;
+		if (parseCTagsLine(text.substr(begin, lineEnd - begin), &tag)) {
+			// No ability to read language mode right now
+			table->insert(tag.name, table->location(tag.file, tagPath), PLAIN_LANGUAGE_MODE, tag.searchString, tag.posInf, tag.line);
+		}
+
+		begin = lineEnd + 1;
+	}
+
+	table->sort();
+}
+
+/*
+** Parses the ctags file <text> into <table>, on as many threads as there are
+** cores. This doesn't touch any of the global tables, so it can be done in
+** the background.
+*/
+void parseCTagsFile(view::string_view text, const QString &tagPath, TagTable *table) {
+
+	const size_t threads = std::max<size_t>(1, std::min<size_t>(static_cast<size_t>(QThread::idealThreadCount()), text.size() / MIN_PARSE_CHUNK_SIZE));
+	const size_t chunk   = text.size() / threads;
+
+	struct Part {
+		size_t begin;
+		size_t end;
+		TagTable table;
+	};
+
+	// split the file at line boundaries, so that every line is parsed once
+	std::vector<Part> parts;
+	size_t begin = 0;
+
+	for (size_t i = 0; i < threads && begin < text.size(); ++i) {
+		size_t end = text.size();
+		if (i + 1 != threads) {
+			end = text.find('\n', std::max(begin, (i + 1) * chunk));
+			end = (end == view::string_view::npos) ? text.size() : end + 1;
+		}
+
+		parts.push_back({begin, end, TagTable()});
+		begin = end;
+	}
+
+	QtConcurrent::blockingMap(parts, [text, &tagPath](Part &part) {
+		parseCTagsLines(text, part.begin, part.end, tagPath, &part.table);
+	});
+
+	// the parts are merged in order, so tags with the same name stay in the
+	// order they have in the file
+	for (Part &part : parts) {
+		table->merge(std::move(part.table));
+	}
+}
+
+/*
+** Loads the ctags file <text> into the table for <index>.
+** Returns the number of added tag specifications.
+*/
+int loadCTagsFile(view::string_view text, const QString &tagPath, int index) {
+
+	TagTable &table       = (*tagTablesByType(searchMode))[index];
+	const size_t previous = table.size();
+
+	parseCTagsFile(text, tagPath, &table);
+
+	return static_cast<int>(table.size() - previous);
+}
+
+/*
+** Reads the ctags file tagSpec into <table>. Safe to call from any thread.
+** Returns false if it can't be read, or turns out to be an etags file.
+*/
+bool readCTagsFile(const QString &tagSpec, TagTable *table) {
+
+	QFileInfo fi(tagSpec);
+	QString resolvedTagsFile = fi.canonicalFilePath();
+	if (resolvedTagsFile.isEmpty()) {
+		return false;
+	}
+
+	QFile f(resolvedTagsFile);
+	if (!f.open(QIODevice::ReadOnly)) {
+		return false;
+	}
+
+	char first;
+	if (f.peek(&first, 1) != 1 || first == 0x0c) { // <np>
+		return false;
+	}
+
+	/* read rather than map the file, the reload was started because ctags is
+	   rewriting it, and a mapping which is truncated under us would crash
+	   this thread as soon as it touched the missing pages */
+	const QByteArray data = f.readAll();
+	if (f.error() != QFileDevice::NoError) {
+		return false;
+	}
+
+	parseCTagsFile(toView(data), parseFilename(resolvedTagsFile).pathname, table);
+	return true;
 }
 
 /*
@@ -322,7 +596,7 @@ int scanETagsLine(const QString &line, const QString &tagPath, int index, QStrin
 }
 
 /*
-** Loads tagsFile into the hash table.
+** Loads tagsFile into the tag table.
 ** Returns the number of added tag specifications.
 */
 int loadTagsFile(const QString &tagSpec, int index, int recLevel) {
@@ -355,27 +629,27 @@ int loadTagsFile(const QString &tagSpec, int index, int recLevel) {
 	   doesn't think we died. */
 	MainWindow::allDocumentsBusy(tr("Loading tags file..."));
 
-	QString filename;
-
-	QTextStream stream(&f);
-
-	while (!stream.atEnd()) {
-		QString line = stream.readLine();
+	/* the first character in the file decides if the file is treat as
+	   etags or ctags file.
+	 */
+	char first;
+	if (f.peek(&first, 1) == 1) {
+		tagFileType = (first == 0x0c) ? TFT_ETAGS : TFT_CTAGS; // <np>
+	}
 
-		/* the first character in the file decides if the file is treat as
-		   etags or ctags file.
-		 */
-		if (tagFileType == TFT_CHECK) {
-			if (line.startsWith(0x0c)) { // <np>
-				tagFileType = TFT_ETAGS;
-			} else {
-				tagFileType = TFT_CTAGS;
-			}
+	if (tagFileType == TFT_CTAGS) {
+		// ctags files have a tag per line, so they can be parsed in parallel
+		const QByteArray data = f.readAll();
+		if (f.error() == QFileDevice::NoError) {
+			nTagsAdded = loadCTagsFile(toView(data), tagPathInfo.pathname, index);
 		}
+	} else if (tagFileType == TFT_ETAGS) {
+		QString filename;
 
-		if (tagFileType == TFT_CTAGS) {
-			nTagsAdded += scanCTagsLine(line, tagPathInfo.pathname, index);
-		} else {
+		QTextStream stream(&f);
+
+		while (!stream.atEnd()) {
+			QString line = stream.readLine();
 			nTagsAdded += scanETagsLine(line, tagPathInfo.pathname, index, filename, recLevel);
 		}
 	}
@@ -384,6 +658,158 @@ int loadTagsFile(const QString &tagSpec, int index, int recLevel) {
 	return nTagsAdded;
 }
 
+/*
+** Returns the name of the tag on the line of text starting at <lineStart>,
+** and sets <lineEnd> to the position of its terminating newline.
+*/
+view::string_view tagNameAt(view::string_view text, size_t lineStart, size_t *lineEnd) {
+
+	size_t end = text.find('\n', lineStart);
+	if (end == view::string_view::npos) {
+		end = text.size();
+	}
+
+	*lineEnd = end;
+
+	const view::string_view line = text.substr(lineStart, end - lineStart);
+	return line.substr(0, line.find('\t'));
+}
+
+/*
+** Returns the start of the line of <file> containing <pos>, looking no further
+** back than <low>, which has to be the start of a line. Returns -1 if the file
+** can't be read, which happens when ctags cuts it short while rewriting it.
+*/
+qint64 tagsLineStart(QFile &file, qint64 low, qint64 pos) {
+
+	// tags lines are short, so this rarely has to read more than once
+	constexpr qint64 BlockSize = 4096;
+
+	while (pos > low) {
+		const qint64 from = std::max(low, pos - BlockSize);
+		if (!file.seek(from)) {
+			return -1;
+		}
+
+		const QByteArray block = file.read(pos - from);
+		if (block.size() != pos - from) {
+			return -1;
+		}
+
+		const int newline = block.lastIndexOf('\n');
+		if (newline != -1) {
+			return from + newline + 1;
+		}
+
+		pos = from;
+	}
+
+	return low;
+}
+
+/*
+** Opens tagSpec if it is a ctags file which says it is sorted (without folding
+** case), so that it can be binary searched. Returns nullptr for any other
+** file, which then has to be loaded the usual way.
+**
+** The file is read a line at a time rather than mapped, so that ctags cutting
+** it short while rewriting it can't crash us, it just stops the lookups from
+** finding anything until the tags file is reloaded.
+*/
+std::unique_ptr<SortedTagsFile> openSortedTagsFile(const QString &tagSpec) {
+
+	QFileInfo fi(tagSpec);
+	QString resolvedTagsFile = fi.canonicalFilePath();
+	if (resolvedTagsFile.isEmpty()) {
+		return nullptr;
+	}
+
+	auto sorted = std::make_unique<SortedTagsFile>();
+	sorted->file.setFileName(resolvedTagsFile);
+
+	if (!sorted->file.open(QIODevice::ReadOnly)) {
+		return nullptr;
+	}
+
+	sorted->tagPath = parseFilename(resolvedTagsFile).pathname;
+
+	// the pseudo tags describing the file come first, look for the sort order
+	static const QByteArray pseudoTag = QByteArrayLiteral("!_TAG_");
+	static const QByteArray sortedTag = QByteArrayLiteral("!_TAG_FILE_SORTED\t1");
+
+	QByteArray line;
+	while (!(line = sorted->file.readLine()).isEmpty() && line.startsWith(pseudoTag)) {
+		if (line.startsWith(sortedTag)) {
+			return sorted;
+		}
+	}
+
+	return nullptr;
+}
+
+/*
+** Binary searches a sorted tags file for the lines defining <name>, and adds
+** them to the tag table, where they stay until the tags file is unloaded.
+** Returns the number of tag specifications found.
+*/
+int lookupSortedTagsFile(SortedTagsFile &sorted, const QString &name, int index) {
+
+	const QByteArray key          = name.toLocal8Bit();
+	const view::string_view value = toView(key);
+
+	TagTable &table = (*tagTablesByType(searchMode))[index];
+	if (table.contains(value)) {
+		return 0;
+	}
+
+	QFile &file = sorted.file;
+	QByteArray line;
+
+	/* Find the first line whose tag isn't less than name. The line containing
+	   the midpoint is always either moved past or made the new upper bound, so
+	   this takes no more than a few dozen reads even for huge files. The size
+	   is asked for again every time, in case ctags is rewriting the file */
+	qint64 low  = 0;
+	qint64 high = file.size();
+
+	while (low < high) {
+		const qint64 lineStart = tagsLineStart(file, low, low + (high - low) / 2);
+		if (lineStart == -1 || !file.seek(lineStart) || (line = file.readLine()).isEmpty()) {
+			return 0;
+		}
+
+		size_t lineEnd;
+		if (tagNameAt(toView(line), 0, &lineEnd).compare(value) < 0) {
+			low = lineStart + line.size();
+		} else {
+			high = lineStart;
+		}
+	}
+
+	if (!file.seek(low)) {
+		return 0;
+	}
+
+	int nTagsFound = 0;
+
+	while (!(line = file.readLine()).isEmpty()) {
+		const view::string_view text = toView(line);
+
+		size_t lineEnd;
+		if (!(tagNameAt(text, 0, &lineEnd) == value)) {
+			break;
+		}
+
+		CTagsLine tag;
+		if (parseCTagsLine(text.substr(0, lineEnd), &tag)) {
+			table.insert(tag.name, table.location(tag.file, sorted.tagPath), PLAIN_LANGUAGE_MODE, tag.searchString, tag.posInf, tag.line);
+			++nTagsFound;
+		}
+	}
+
+	return nTagsFound;
+}
+
 /*
 ** Get the next block from a tips file.  A block is a \n\n+ delimited set of
 ** lines in a calltips file.  All of the parameters except <fp> are return
@@ -705,6 +1131,130 @@ int loadTipsFile(const QString &tipsFile, int index, int recLevel) {
 	return nTipsAdded;
 }
 
+/*
+** Finds the entry of TagsFileList with the given index
+*/
+std::deque<File>::iterator findTagsFile(int index) {
+	return std::find_if(TagsFileList.begin(), TagsFileList.end(), [index](const File &tf) {
+		return tf.index == index;
+	});
+}
+
+/*
+** Puts the tags read in the background in place of the old ones, unless the
+** file has changed again or been unloaded in the meantime.
+*/
+void finishTagsFileReload(int index, int generation, const QDateTime &timestamp, const std::shared_ptr<TagTable> &table) {
+
+	auto pending = PendingReloads.find(index);
+	if (pending == PendingReloads.end() || pending->second != generation) {
+		return;
+	}
+
+	PendingReloads.erase(pending);
+
+	auto tf = findTagsFile(index);
+	if (tf == TagsFileList.end()) {
+		return;
+	}
+
+	if (!table) {
+		// not something that can be read in the background, so leave it to
+		// the next lookup to load it the usual way
+		LoadedTags.erase(index);
+		tf->loaded = false;
+		return;
+	}
+
+	LoadedTags[index] = std::move(*table);
+	tf->date          = timestamp;
+}
+
+/*
+** Reads a changed tags file on the thread pool. Until it is done, lookups
+** keep using the tags read before.
+*/
+void startTagsFileReload(const QString &filename, int index, int generation) {
+
+	auto pending = PendingReloads.find(index);
+	if (pending == PendingReloads.end() || pending->second != generation) {
+		// it has changed again since, and a later reload will take care of it
+		return;
+	}
+
+	const QDateTime timestamp = QFileInfo(filename).lastModified();
+
+	auto watcher = new QFutureWatcher<std::shared_ptr<TagTable>>(qApp);
+
+	QObject::connect(watcher, &QFutureWatcherBase::finished, watcher, [watcher, index, generation, timestamp]() {
+		finishTagsFileReload(index, generation, timestamp, watcher->result());
+		watcher->deleteLater();
+	});
+
+	watcher->setFuture(QtConcurrent::run([filename]() {
+		QElapsedTimer timer;
+		timer.start();
+
+		auto table = std::make_shared<TagTable>();
+		if (!readCTagsFile(filename, table.get())) {
+			return std::shared_ptr<TagTable>();
+		}
+
+		table->loadTime = timer.elapsed();
+		return table;
+	}));
+}
+
+/*
+** Called when a watched tags file changes on disk
+*/
+void tagsFileChanged(const QString &filename) {
+
+	// files which are replaced rather than rewritten drop out of the watcher
+	if (QFileInfo::exists(filename) && !tagsFileWatcher()->files().contains(filename)) {
+		tagsFileWatcher()->addPath(filename);
+	}
+
+	auto tf = std::find_if(TagsFileList.begin(), TagsFileList.end(), [&filename](const File &file) {
+		return file.filename == filename;
+	});
+
+	if (tf == TagsFileList.end() || !tf->loaded) {
+		return;
+	}
+
+	const int index = tf->index;
+
+	if (SortedTagsFiles.erase(index) != 0) {
+		// opening it again is cheap enough to leave to the next lookup
+		LoadedTags.erase(index);
+		tf->loaded = false;
+		return;
+	}
+
+	// ctags writes big files a piece at a time, so wait for it to finish
+	const int generation = ++PendingReloads[index];
+
+	QTimer::singleShot(RELOAD_DELAY, qApp, [filename, index, generation]() {
+		startTagsFileReload(filename, index, generation);
+	});
+}
+
+/*
+** The watcher which notices when loaded tags files change
+*/
+QFileSystemWatcher *tagsFileWatcher() {
+
+	static QFileSystemWatcher *watcher = nullptr;
+
+	if (!watcher) {
+		watcher = new QFileSystemWatcher(qApp);
+		QObject::connect(watcher, &QFileSystemWatcher::fileChanged, watcher, tagsFileChanged);
+	}
+
+	return watcher;
+}
+
 }
 
 /*
@@ -726,6 +1276,7 @@ QString tagName;
 QString tagFiles[MaxDupTags];
 QString tagSearch[MaxDupTags];
 int64_t tagPosInf[MaxDupTags];
+int64_t tagLine[MaxDupTags];
 
 bool globAnchored;
 CallTipPosition globPos;
@@ -733,60 +1284,22 @@ TipHAlignMode globHAlign;
 TipVAlignMode globVAlign;
 TipAlignMode globAlignMode;
 
-/* Add a tag specification to the hash table
-**   Return Value:  false ... tag already existing, spec not added
-**                  true  ... tag spec is new, added.
+/* Add a tag specification to the table of the tags file <index>
+**   Return Value:  the number of tag specs added, which is always 1. Specs
+**                  which repeat one already read are only dropped when the
+**                  tag is looked up, see getTag.
 **   (We don't return boolean as the return value is used as counter increment!)
 **
 */
 int addTag(const QString &name, const QString &file, size_t lang, const QString &search, int64_t posInf, const QString &path, int index) {
 
-	QMultiHash<QString, Tag> *const table = hashTableByType(searchMode);
-
-	QString newFile;
-	if (QFileInfo(file).isAbsolute()) {
-		newFile = file;
-	} else {
-		newFile = tr("%1%2").arg(path, file);
-	}
-
-	newFile = NormalizePathname(newFile);
+	TagTable &table = (*tagTablesByType(searchMode))[index];
 
-	QList<Tag> tags = table->values(name);
-	for (const Tag &t : tags) {
-
-		if (lang != t.language) {
-			continue;
-		}
+	const QByteArray nameBytes   = name.toLocal8Bit();
+	const QByteArray fileBytes   = file.toLocal8Bit();
+	const QByteArray searchBytes = search.toLocal8Bit();
 
-		if (search != t.searchString) {
-			continue;
-		}
-
-		if (posInf != t.posInf) {
-			continue;
-		}
-
-		if (QFileInfo(t.file).isAbsolute() && (newFile != t.file)) {
-			continue;
-		}
-
-		if (QFileInfo(t.file).isAbsolute()) {
-
-			auto tmpFile = tr("%1%2").arg(t.path, t.file);
-
-			tmpFile = NormalizePathname(tmpFile);
-
-			if (newFile != tmpFile) {
-				continue;
-			}
-		}
-		return 0;
-	}
-
-	Tag t = {name, file, search, path, lang, posInf, index};
-
-	table->insert(name, t);
+	table.insert(toView(nameBytes), table.location(toView(fileBytes), path), lang, toView(searchBytes), posInf);
 	return 1;
 }
 
@@ -971,6 +1484,14 @@ bool deleteTagsFile(const QString &tagSpec, SearchMode mode, bool force_unload)
 
 			if (t.loaded) {
 				delTag(t.index);
+				SortedTagsFiles.erase(t.index);
+			}
+
+			if (searchMode == SearchMode::TAG) {
+				PendingReloads.erase(t.index);
+				if (tagsFileWatcher()->files().contains(t.filename)) {
+					tagsFileWatcher()->removePath(t.filename);
+				}
 			}
 
 			it = FileList->erase(it);
@@ -995,6 +1516,7 @@ QList<Tag> lookupTagFromList(std::deque<File> *FileList, const QString &name, Se
 	**   - load them (if not already loaded)
 	**   - check for update of the tags file and reload it in that case
 	**   - save the modification date of the tags file
+	**   - binary search the sorted ones, which are never loaded as a whole
 	**
 	** Do this only as long as name != nullptr, not for sucessive calls
 	** to find multiple tags specs.
@@ -1007,6 +1529,11 @@ QList<Tag> lookupTagFromList(std::deque<File> *FileList, const QString &name, Se
 
 			if (tf.loaded) {
 
+				if (PendingReloads.find(tf.index) != PendingReloads.end()) {
+					// the new tags are on their way, use the old ones until then
+					continue;
+				}
+
 				QFileInfo fileInfo(tf.filename);
 				QDateTime timestamp = fileInfo.lastModified();
 
@@ -1021,11 +1548,19 @@ QList<Tag> lookupTagFromList(std::deque<File> *FileList, const QString &name, Se
 
 				// tags file has been modified, delete it's entries and reload it
 				delTag(tf.index);
+				SortedTagsFiles.erase(tf.index);
 			}
 
 			// If we get here we have to try to (re-) load the tags file
+			QElapsedTimer timer;
+			timer.start();
+
 			if (FileList == &TipsFileList) {
 				load_status = loadTipsFile(tf.filename, tf.index, 0);
+			} else if (std::unique_ptr<SortedTagsFile> sorted = openSortedTagsFile(tf.filename)) {
+				// sorted tags files are searched on demand instead
+				SortedTagsFiles[tf.index] = std::move(sorted);
+				load_status               = 1;
 			} else {
 				load_status = loadTagsFile(tf.filename, tf.index, 0);
 			}
@@ -1044,15 +1579,62 @@ QList<Tag> lookupTagFromList(std::deque<File> *FileList, const QString &name, Se
 					tf.date = timestamp;
 				}
 				tf.loaded = true;
+
+				std::map<int, TagTable> *tables = tagTablesByType(searchMode);
+
+				auto it = tables->find(tf.index);
+				if (it != tables->end()) {
+					it->second.loadTime = timer.elapsed();
+				}
+
+				// pick up changes to tags files as soon as they happen
+				if (FileList == &TagsFileList && !tagsFileWatcher()->files().contains(tf.filename)) {
+					tagsFileWatcher()->addPath(tf.filename);
+				}
 			} else {
 				tf.loaded = false;
 			}
 		}
+
+		for (const File &tf : *FileList) {
+			auto it = SortedTagsFiles.find(tf.index);
+			if (it != SortedTagsFiles.end()) {
+				lookupSortedTagsFile(*it->second, name, tf.index);
+			}
+		}
 	}
 
 	return getTag(name, mode);
 }
 
+/*
+** Describes how much a loaded tags or tips file cost to load, and how much
+** memory its tags take up. Returns an empty string if it isn't loaded.
+*/
+QString tagsFileStatistics(const File &tf) {
+
+	if (!tf.loaded) {
+		return QString();
+	}
+
+	if (SortedTagsFiles.find(tf.index) != SortedTagsFiles.end()) {
+		return tr("sorted, searched on demand");
+	}
+
+	for (const std::map<int, TagTable> *tables : {&LoadedTags, &LoadedTips}) {
+		auto it = tables->find(tf.index);
+		if (it != tables->end()) {
+			const TagTable &table = it->second;
+			return tr("%1 tags, %2 KB, loaded in %3 ms")
+				.arg(table.size())
+				.arg(table.memoryUsage() / 1024)
+				.arg(table.loadTime);
+		}
+	}
+
+	return QString();
+}
+
 /*
 ** Given a tag name, lookup the file and path of the definition
 ** and the proper search string.
@@ -1189,6 +1771,34 @@ bool fakeRegExSearch(view::string_view buffer, const QString &searchString, int6
 	}
 }
 
+/*
+** Finds the definition a tag's search string describes in <buffer>. Where the
+** tags file gives a position (etags) or a line number (exuberant ctags) the
+** search starts there, looking for the text of the line as a plain string,
+** and only falls back to the regular expression fakeRegExSearch builds if
+** the line has changed. <startPos> is as for fakeRegExSearch.
+*/
+bool findTagLocation(view::string_view buffer, const QString &searchString, int64_t line, int64_t *startPos, int64_t *endPos) {
+
+	int64_t hint;
+	if (*startPos != -1) {
+		hint = *startPos;
+	} else if (line > 0) {
+		hint = 0;
+		moveAheadNLines(buffer, hint, line - 1);
+	} else if (searchString.startsWith(QLatin1Char('?'))) {
+		hint = static_cast<int64_t>(buffer.size());
+	} else {
+		hint = 0;
+	}
+
+	if (literalTagSearch(buffer, searchString, hint, startPos, endPos)) {
+		return true;
+	}
+
+	return fakeRegExSearch(buffer, searchString, startPos, endPos);
+}
+
 /*
 ** Show the calltip specified by tagFiles[i], tagSearch[i], tagPosInf[i]
 ** This reads from either a source code file (if searchMode == TIP_FROM_TAG)
@@ -1226,7 +1836,7 @@ void showMatchingCalltip(QWidget *parent, TextArea *area, int id) {
 			}
 		} else {
 			startPos = tagPosInf[id];
-			if (!fakeRegExSearch(fileString, tagSearch[id], &startPos, &endPos)) {
+			if (!findTagLocation(fileString, tagSearch[id], tagLine[id], &startPos, &endPos)) {
 				QMessageBox::critical(
 					parent,
 					tr("Tag not found"),
@@ -1307,11 +1917,39 @@ bool searchLine(const QString &line, const QRegularExpression &re) {
  */
 QList<Tag> getTag(const QString &name, SearchMode mode) {
 
-	if (mode == SearchMode::TIP) {
-		return getTagFromTable(LoadedTips, name);
-	} else {
-		return getTagFromTable(LoadedTags, name);
+	std::map<int, TagTable> *tables = tagTablesByType(mode);
+
+	const QByteArray key = name.toLocal8Bit();
+
+	// the most recently added tags files come first
+	QList<Tag> found;
+	for (auto it = tables->rbegin(); it != tables->rend(); ++it) {
+		it->second.values(toView(key), it->first, &found);
 	}
+
+	// drop the specs which repeat one from the same or another tags file
+	QList<Tag> tags;
+	QStringList paths;
+
+	for (const Tag &tag : found) {
+		const QString fullPath = tagFullPath(tag);
+
+		bool duplicate = false;
+		for (int i = 0; i < tags.size(); ++i) {
+			const Tag &t = tags[i];
+			if (t.language == tag.language && t.posInf == tag.posInf && t.searchString == tag.searchString && paths[i] == fullPath) {
+				duplicate = true;
+				break;
+			}
+		}
+
+		if (!duplicate) {
+			tags.push_back(tag);
+			paths.push_back(fullPath);
+		}
+	}
+
+	return tags;
 }
 
 /**
@@ -45,6 +45,7 @@ struct Tag {
 	size_t language;
 	int64_t posInf;
 	int index;
+	int64_t line; // line number recorded by exuberant ctags, 0 if unknown
 };
 
 enum CalltipToken {
@@ -59,6 +60,8 @@ enum CalltipToken {
 };
 
 QList<Tag> lookupTag(const QString &name, SearchMode mode);
+QString tagsFileStatistics(const File &tf);
+bool findTagLocation(view::string_view buffer, const QString &searchString, int64_t line, int64_t *startPos, int64_t *endPos);
 bool addRelTagsFile(const QString &tagSpec, const QString &windowPath, SearchMode mode);
 bool addTagsFile(const QString &tagSpec, SearchMode mode);
 bool deleteTagsFile(const QString &tagSpec, SearchMode mode, bool force_unload);
@@ -80,6 +83,7 @@ extern QString tagName;
 extern QString tagFiles[MaxDupTags];
 extern QString tagSearch[MaxDupTags];
 extern int64_t tagPosInf[MaxDupTags];
+extern int64_t tagLine[MaxDupTags];
 
 extern bool globAnchored;
 extern CallTipPosition globPos;
@@ -14,6 +14,7 @@
 #include <deque>
 #include <memory>
 #include <string>
+#include <utility>
 
 #include <boost/optional.hpp>
 
@@ -104,12 +105,14 @@ public:
 	boost::optional<SelectionPos> BufGetSelectionPos() const noexcept;
 	bool BufGetSyncXSelection() const;
 	bool BufGetUseTabs() const noexcept;
+	bool BufIsBorrowed() const noexcept;
 	bool BufIsEmpty() const noexcept;
 	bool BufSetSyncXSelection(bool sync);
 	boost::optional<TextCursor> searchBackward(TextCursor startPos, view_type searchChars) const noexcept;
 	boost::optional<TextCursor> searchForward(TextCursor startPos, view_type searchChars) const noexcept;
 	Ch BufGetCharacter(TextCursor pos) const noexcept;
 	int64_t BufCountDispChars(TextCursor lineStartPos, TextCursor targetPos) const noexcept;
+	int64_t BufCapacity() const noexcept;
 	int64_t BufCountLines(TextCursor startPos, TextCursor endPos) const noexcept;
 	int64_t length() const noexcept;
 	int compare(TextCursor pos, Ch ch) const noexcept;
@@ -132,6 +135,7 @@ public:
 	TextCursor BufEndOfBuffer() const noexcept;
 	constexpr TextCursor BufStartOfBuffer() const noexcept { return {}; }
 	view_type BufAsString() noexcept;
+	std::pair<view_type, view_type> BufAsSegments() const noexcept;
 	void BufAddHighPriorityModifyCB(modify_callback_type bufModifiedCB, void *user);
 	void BufAddModifyCB(modify_callback_type bufModifiedCB, void *user);
 	void BufAddPreDeleteCB(pre_delete_callback_type bufPreDeleteCB, void *user);
@@ -140,6 +144,8 @@ public:
 	void BufCheckDisplay(TextCursor start, TextCursor end) const noexcept;
 	void BufClearRect(TextCursor start, TextCursor end, int64_t rectStart, int64_t rectEnd) noexcept;
 	void BufCopyFromBuf(BasicTextBuffer *fromBuf, TextCursor fromStart, TextCursor fromEnd, TextCursor toPos) noexcept;
+	void BufDetach();
+	void BufDiscardAll();
 	void BufHighlight(TextCursor start, TextCursor end) noexcept;
 	void BufInsertCol(int64_t column, TextCursor startPos, view_type text, int64_t *charsInserted, int64_t *charsDeleted) noexcept;
 	void BufInsert(TextCursor pos, Ch ch) noexcept;
@@ -160,6 +166,7 @@ public:
 	void BufReplaceRect(TextCursor start, TextCursor end, int64_t rectStart, int64_t rectEnd, view_type text);
 	void BufReplaceSecSelect(view_type text) noexcept;
 	void BufReplaceSelected(view_type text) noexcept;
+	void BufReserve(int64_t length);
 	void BufSecondarySelect(TextCursor start, TextCursor end) noexcept;
 	void BufSecondaryUnselect() noexcept;
 	void BufSecRectSelect(TextCursor start, TextCursor end, int64_t rectStart, int64_t rectEnd) noexcept;
@@ -167,6 +174,7 @@ public:
 	void BufSelect(TextCursor start, TextCursor end) noexcept;
 	void BufSelect(std::pair<TextCursor, TextCursor> range) noexcept;
 	void BufSetAll(view_type text);
+	void BufSetAllBorrowed(Ch *text, int64_t length);
 	void BufSetTabDistance(int distance, bool notify) noexcept;
 	void BufSetUseTabs(bool useTabs) noexcept;
 	void BufUnhighlight() noexcept;
@@ -61,6 +61,16 @@ auto BasicTextBuffer<Ch, Tr>::BufAsString() noexcept -> view_type {
 	return buffer_.to_view();
 }
 
+/*
+** Get the entire contents of a text buffer as the two runs of characters
+** either side of the gap, which is left where it is. Unlike BufAsString this
+** never moves any text, but the views are only valid until the next change.
+*/
+template <class Ch, class Tr>
+auto BasicTextBuffer<Ch, Tr>::BufAsSegments() const noexcept -> std::pair<view_type, view_type> {
+	return std::make_pair(buffer_.before_gap(), buffer_.after_gap());
+}
+
 /*
 ** Replace the entire contents of the text buffer
 */
@@ -84,6 +94,72 @@ void BasicTextBuffer<Ch, Tr>::BufSetAll(view_type text) {
 	callModifyCBs(BufStartOfBuffer(), deleteLength, insertLength, 0, deletedText);
 }
 
+/*
+** Replace the entire contents of the text buffer with "length" characters of
+** memory which the buffer borrows rather than copies, such as a file mapped
+** into memory. The memory has to stay valid until BufIsBorrowed() returns
+** false, which it does once the text is changed or BufDetach() is called.
+*/
+template <class Ch, class Tr>
+void BasicTextBuffer<Ch, Tr>::BufSetAllBorrowed(Ch *text, int64_t length) {
+
+	callPreDeleteCBs(BufStartOfBuffer(), buffer_.size());
+
+	// Save information for redisplay, and get rid of the old buffer
+	const string_type deletedText = BufGetAll();
+	const auto deleteLength       = static_cast<int64_t>(deletedText.size());
+
+	buffer_.borrow(text, length);
+
+	// Zero all of the existing selections
+	updateSelections(BufStartOfBuffer(), deleteLength, 0);
+
+	// Call the saved display routine(s) to update the screen
+	callModifyCBs(BufStartOfBuffer(), deleteLength, length, 0, deletedText);
+}
+
+/*
+** Whether the text is still the memory given to BufSetAllBorrowed
+*/
+template <class Ch, class Tr>
+bool BasicTextBuffer<Ch, Tr>::BufIsBorrowed() const noexcept {
+	return buffer_.is_borrowed();
+}
+
+/*
+** Copy borrowed text into the buffer's own storage, so that the memory it was
+** borrowed from can be released
+*/
+template <class Ch, class Tr>
+void BasicTextBuffer<Ch, Tr>::BufDetach() {
+	buffer_.detach();
+}
+
+/*
+** Empty the buffer and give back the memory the text took up. Unlike
+** BufSetAll(""), which leaves the old allocation in place as one big gap, the
+** buffer starts again with a fresh one of PreferredGapSize. The old text isn't
+** copied for the modify callbacks either, they are shown it where it is, and
+** it is freed once they have returned.
+*/
+template <class Ch, class Tr>
+void BasicTextBuffer<Ch, Tr>::BufDiscardAll() {
+
+	callPreDeleteCBs(BufStartOfBuffer(), buffer_.size());
+
+	gap_buffer<Ch> deleted;
+	buffer_.swap(deleted);
+
+	const view_type deletedText = deleted.to_view();
+	const auto deleteLength     = static_cast<int64_t>(deletedText.size());
+
+	// Zero all of the existing selections
+	updateSelections(BufStartOfBuffer(), deleteLength, 0);
+
+	// Call the saved display routine(s) to update the screen
+	callModifyCBs(BufStartOfBuffer(), deleteLength, 0, 0, deletedText);
+}
+
 /*
 ** Return a copy of the text between "start" and "end" character positions
 ** Positions start at 0, and the range does not include the character pointed to by "end"
@@ -942,22 +1018,26 @@ TextCursor BasicTextBuffer<Ch, Tr>::BufCountForwardDispChars(TextCursor lineStar
 template <class Ch, class Tr>
 int64_t BasicTextBuffer<Ch, Tr>::BufCountLines(TextCursor startPos, TextCursor endPos) const noexcept {
 
-	int64_t lineCount = 0;
+	const int64_t start = to_integer(startPos);
+	const int64_t end   = std::min(to_integer(endPos), length());
 
-	TextCursor pos = startPos;
-	TextCursor end = BufEndOfBuffer();
+	if (start >= end) {
+		return 0;
+	}
 
-	while (pos < end) {
-		if (pos == endPos) {
-			return lineCount;
+	// count the part of the range on either side of the gap in one go, rather than a character at a time
+	auto countNewlines = [start, end](view_type segment, int64_t offset) -> int64_t {
+		const int64_t from = std::max<int64_t>(start - offset, 0);
+		const int64_t to   = std::min<int64_t>(end - offset, static_cast<int64_t>(segment.size()));
+		if (from >= to) {
+			return 0;
 		}
 
-		if (buffer_[to_integer(pos++)] == Ch('\n')) {
-			++lineCount;
-		}
-	}
+		return std::count(segment.data() + from, segment.data() + to, Ch('\n'));
+	};
 
-	return lineCount;
+	const std::pair<view_type, view_type> segments = BufAsSegments();
+	return countNewlines(segments.first, 0) + countNewlines(segments.second, static_cast<int64_t>(segments.first.size()));
 }
 
 /*
@@ -1593,6 +1673,24 @@ void BasicTextBuffer<Ch, Tr>::BufAppend(Ch ch) noexcept {
 	BufInsert(TextCursor(length()), ch);
 }
 
+/*
+** Make room for the buffer to grow to "length" characters without having to
+** reallocate, such as before appending a file which is read a piece at a time
+*/
+template <class Ch, class Tr>
+void BasicTextBuffer<Ch, Tr>::BufReserve(int64_t length) {
+	buffer_.reserve(length);
+}
+
+/*
+** The number of characters the buffer has room for, which is how much memory
+** it takes up, unless the text is borrowed
+*/
+template <class Ch, class Tr>
+int64_t BasicTextBuffer<Ch, Tr>::BufCapacity() const noexcept {
+	return static_cast<int64_t>(buffer_.capacity());
+}
+
 template <class Ch, class Tr>
 bool BasicTextBuffer<Ch, Tr>::BufIsEmpty() const noexcept {
 	return length() == 0;
@@ -78,17 +78,25 @@ public:
 	string_type to_string(size_type start, size_type end) const;
 	view_type to_view() noexcept;
 	view_type to_view(size_type start, size_type end) noexcept;
+	view_type before_gap() const noexcept;
+	view_type after_gap() const noexcept;
 
 public:
 	void append(view_type str);
 	void append(Ch ch);
 	void insert(size_type pos, view_type str);
 	void insert(size_type pos, Ch ch);
-	size_type erase(size_type start, size_type end) noexcept;
+	size_type erase(size_type start, size_type end);
 	void replace(size_type start, size_type end, view_type str);
 	void replace(size_type start, size_type end, Ch ch);
 	void assign(view_type str);
-	void clear() noexcept;
+	void clear();
+	void reserve(size_type new_capacity);
+
+public:
+	void borrow(Ch *text, size_type length) noexcept;
+	bool is_borrowed() const noexcept;
+	void detach();
 
 private:
 	void move_gap(size_type pos) noexcept;
@@ -96,7 +104,8 @@ private:
 	void delete_range(size_type start, size_type end) noexcept;
 
 private:
-	std::unique_ptr<Ch[]> buf_; // points to the internal buffer
+	std::unique_ptr<Ch[]> buf_; // points to the internal buffer, if it has one
+	Ch *data_ = nullptr;        // points to the text, which is either in the internal buffer or borrowed
 	size_type gap_start_;       // points to the first character of the gap
 	size_type gap_end_;         // points to the first char after the gap
 	size_type size_;            // length of the text in the buffer (the length of the buffer itself must be calculated: gapEnd - gapStart + length)
@@ -117,10 +126,11 @@ template <class Ch, class Tr>
 gap_buffer<Ch, Tr>::gap_buffer(size_type reserve_size)
 	: gap_start_(0), gap_end_(PreferredGapSize), size_(0) {
 
-	buf_ = std::make_unique<Ch[]>(reserve_size + PreferredGapSize);
+	buf_  = std::make_unique<Ch[]>(reserve_size + PreferredGapSize);
+	data_ = buf_.get();
 
 #ifdef PURIFY
-	std::fill(&buf_[gap_start_], &buf_[gap_end_], Ch('.'));
+	std::fill(&data_[gap_start_], &data_[gap_end_], Ch('.'));
 #endif
 }
 
@@ -131,10 +141,10 @@ template <class Ch, class Tr>
 Ch gap_buffer<Ch, Tr>::operator[](size_type n) const noexcept {
 
 	if (n < gap_start_) {
-		return buf_[n];
+		return data_[n];
 	}
 
-	return buf_[n + gap_size()];
+	return data_[n + gap_size()];
 }
 
 /**
@@ -144,10 +154,10 @@ template <class Ch, class Tr>
 Ch &gap_buffer<Ch, Tr>::operator[](size_type n) noexcept {
 
 	if (n < gap_start_) {
-		return buf_[n];
+		return data_[n];
 	}
 
-	return buf_[n + gap_size()];
+	return data_[n + gap_size()];
 }
 
 /**
@@ -161,10 +171,10 @@ Ch gap_buffer<Ch, Tr>::at(size_type n) const {
 	}
 
 	if (n < gap_start_) {
-		return buf_[n];
+		return data_[n];
 	}
 
-	return buf_[n + gap_size()];
+	return data_[n + gap_size()];
 }
 
 /**
@@ -178,10 +188,10 @@ Ch &gap_buffer<Ch, Tr>::at(size_type n) {
 	}
 
 	if (n < gap_start_) {
-		return buf_[n];
+		return data_[n];
 	}
 
-	return buf_[n + gap_size()];
+	return data_[n + gap_size()];
 }
 
 /**
@@ -205,17 +215,17 @@ int gap_buffer<Ch, Tr>::compare(size_type pos, view_type str) const noexcept {
 	}
 
 	if (posEnd <= gap_start_) {
-		return Tr::compare(&buf_[pos], str.data(), str.size());
+		return Tr::compare(&data_[pos], str.data(), str.size());
 	} else if (pos >= gap_start_) {
-		return Tr::compare(&buf_[pos + gap_size()], str.data(), str.size());
+		return Tr::compare(&data_[pos + gap_size()], str.data(), str.size());
 	} else {
 		const auto part1Length = static_cast<size_t>(gap_start_ - pos);
-		const int result       = Tr::compare(&buf_[pos], str.data(), part1Length);
+		const int result       = Tr::compare(&data_[pos], str.data(), part1Length);
 		if (result != 0) {
 			return result;
 		}
 
-		return Tr::compare(&buf_[gap_end_], &str[part1Length], static_cast<size_t>(str.size() - part1Length));
+		return Tr::compare(&data_[gap_end_], &str[part1Length], static_cast<size_t>(str.size() - part1Length));
 	}
 }
 
@@ -243,8 +253,8 @@ template <class Ch, class Tr>
 auto gap_buffer<Ch, Tr>::to_string() const -> string_type {
 	string_type text;
 	text.reserve(static_cast<size_t>(size()));
-	text.append(&buf_[0], &buf_[gap_start_]);
-	text.append(&buf_[gap_end_], &buf_[gap_size() + size()]);
+	text.append(&data_[0], &data_[gap_start_]);
+	text.append(&data_[gap_end_], &data_[gap_size() + size()]);
 	return text;
 }
 
@@ -264,14 +274,14 @@ auto gap_buffer<Ch, Tr>::to_string(size_type start, size_type end) const -> stri
 
 	// Copy the text from the buffer to the returned string
 	if (end <= gap_start_) {
-		text.append(&buf_[start], &buf_[end]);
+		text.append(&data_[start], &data_[end]);
 	} else if (start >= gap_start_) {
-		text.append(&buf_[start + gap_size()], length);
+		text.append(&data_[start + gap_size()], length);
 	} else {
 		const difference_type part1Length = gap_start_ - start;
 
-		text.append(&buf_[start], part1Length);
-		text.append(&buf_[gap_end_], length - part1Length);
+		text.append(&data_[start], part1Length);
+		text.append(&data_[gap_end_], length - part1Length);
 	}
 
 	return text;
@@ -294,11 +304,28 @@ auto gap_buffer<Ch, Tr>::to_view() noexcept -> view_type {
 	}
 
 	// get the start position of the actual data
-	Ch *const text = &buf_[(leftLen == 0) ? gap_end_ : 0];
+	Ch *const text = &data_[(leftLen == 0) ? gap_end_ : 0];
 
 	return view_type(text, static_cast<size_t>(bufLen));
 }
 
+/**
+ * the text before the gap, which together with after_gap() is the whole
+ * text, without having to move the gap out of the way like to_view() does
+ */
+template <class Ch, class Tr>
+auto gap_buffer<Ch, Tr>::before_gap() const noexcept -> view_type {
+	return view_type(data_, static_cast<size_t>(gap_start_));
+}
+
+/**
+ * the text after the gap
+ */
+template <class Ch, class Tr>
+auto gap_buffer<Ch, Tr>::after_gap() const noexcept -> view_type {
+	return view_type(data_ + gap_end_, static_cast<size_t>(size_ - gap_start_));
+}
+
 /**
  *
  */
@@ -320,7 +347,7 @@ auto gap_buffer<Ch, Tr>::to_view(size_type start, size_type end) noexcept -> vie
 	}
 
 	// get the start position of the actual data
-	Ch *const text = &buf_[(leftLen == 0) ? gap_end_ : 0];
+	Ch *const text = &data_[(leftLen == 0) ? gap_end_ : 0];
 
 	return view_type(text + start, static_cast<size_t>(end - start));
 }
@@ -349,6 +376,10 @@ void gap_buffer<Ch, Tr>::insert(size_type pos, view_type str) {
 
 	assert(pos <= size() && pos >= 0);
 
+	if (is_borrowed()) {
+		detach();
+	}
+
 	const auto length = static_cast<size_type>(str.size());
 
 	/* Prepare the buffer to receive the new text.  If the new text fits in
@@ -363,7 +394,7 @@ void gap_buffer<Ch, Tr>::insert(size_type pos, view_type str) {
 	}
 
 	// Insert the new text (pos now corresponds to the start of the gap)
-	std::copy(str.begin(), str.end(), &buf_[pos]);
+	std::copy(str.begin(), str.end(), &data_[pos]);
 
 	gap_start_ += length;
 	size_ += length;
@@ -377,6 +408,10 @@ void gap_buffer<Ch, Tr>::insert(size_type pos, Ch ch) {
 
 	assert(pos <= size() && pos >= 0);
 
+	if (is_borrowed()) {
+		detach();
+	}
+
 	const size_type length = 1;
 
 	/* Prepare the buffer to receive the new text.  If the new text fits in
@@ -391,7 +426,7 @@ void gap_buffer<Ch, Tr>::insert(size_type pos, Ch ch) {
 	}
 
 	// Insert the new text (pos now corresponds to the start of the gap)
-	buf_[pos] = ch;
+	data_[pos] = ch;
 
 	gap_start_ += length;
 	size_ += length;
@@ -401,12 +436,26 @@ void gap_buffer<Ch, Tr>::insert(size_type pos, Ch ch) {
  *
  */
 template <class Ch, class Tr>
-auto gap_buffer<Ch, Tr>::erase(size_type start, size_type end) noexcept -> size_type {
+auto gap_buffer<Ch, Tr>::erase(size_type start, size_type end) -> size_type {
 
 	assert(start <= size() && start >= 0);
 	assert(end <= size() && end >= 0);
 	assert(start <= end);
 
+	if (is_borrowed()) {
+		if (start == 0 && end == size()) {
+			// nothing of the borrowed text is left, so there is no need to copy it
+			buf_       = std::make_unique<Ch[]>(PreferredGapSize);
+			data_      = buf_.get();
+			gap_start_ = 0;
+			gap_end_   = PreferredGapSize;
+			size_      = 0;
+			return start;
+		}
+
+		detach();
+	}
+
 	delete_range(start, end);
 	return start;
 }
@@ -439,10 +488,56 @@ void gap_buffer<Ch, Tr>::assign(view_type str) {
  *
  */
 template <class Ch, class Tr>
-void gap_buffer<Ch, Tr>::clear() noexcept {
+void gap_buffer<Ch, Tr>::clear() {
 	erase(0, size());
 }
 
+/*
+** Make room for at least "new_capacity" characters, so that text can be added
+** up to that size without reallocating again. The new room is added to the
+** end of the buffer, where it's ready for appending.
+*/
+template <class Ch, class Tr>
+void gap_buffer<Ch, Tr>::reserve(size_type new_capacity) {
+	if (new_capacity > capacity()) {
+		reallocate_buffer(size(), new_capacity - size());
+	}
+}
+
+/*
+** Make the buffer's text "length" characters of memory which it doesn't own,
+** typically a file mapped into memory, instead of copying it. The memory has
+** to stay valid for as long as it's borrowed. Until the text is first
+** changed, which copies it into a buffer of its own, the memory is only read.
+*/
+template <class Ch, class Tr>
+void gap_buffer<Ch, Tr>::borrow(Ch *text, size_type length) noexcept {
+	buf_       = nullptr;
+	data_      = text;
+	gap_start_ = length;
+	gap_end_   = length;
+	size_      = length;
+}
+
+/**
+ * whether the text is still in memory lent to the buffer by borrow()
+ */
+template <class Ch, class Tr>
+bool gap_buffer<Ch, Tr>::is_borrowed() const noexcept {
+	return data_ != buf_.get();
+}
+
+/**
+ * copy borrowed text into a buffer of its own, after which the memory which
+ * was lent may be freed
+ */
+template <class Ch, class Tr>
+void gap_buffer<Ch, Tr>::detach() {
+	if (is_borrowed()) {
+		reallocate_buffer(gap_start_, PreferredGapSize);
+	}
+}
+
 /**
  *
  */
@@ -452,9 +547,9 @@ void gap_buffer<Ch, Tr>::move_gap(size_type pos) noexcept {
 	const size_type gap_length = gap_size();
 
 	if (pos > gap_start_) {
-		Tr::move(&buf_[gap_start_], &buf_[gap_end_], static_cast<size_t>(pos - gap_start_));
+		Tr::move(&data_[gap_start_], &data_[gap_end_], static_cast<size_t>(pos - gap_start_));
 	} else {
-		Tr::move(&buf_[pos + gap_length], &buf_[pos], static_cast<size_t>(gap_start_ - pos));
+		Tr::move(&data_[pos + gap_length], &data_[pos], static_cast<size_t>(gap_start_ - pos));
 	}
 
 	gap_end_ += (pos - gap_start_);
@@ -462,7 +557,7 @@ void gap_buffer<Ch, Tr>::move_gap(size_type pos) noexcept {
 }
 
 /*
-** Reallocate the text storage in "buf_" to have a gap starting at "new_gap_start"
+** Reallocate the text storage in "data_" to have a gap starting at "new_gap_start"
 ** and a gap size of "new_gap_size", preserving the buffer's current contents.
 */
 template <class Ch, class Tr>
@@ -473,21 +568,22 @@ void gap_buffer<Ch, Tr>::reallocate_buffer(size_type new_gap_start, size_type ne
 	const size_type new_gap_end = new_gap_start + new_gap_size;
 
 	if (new_gap_start <= gap_start_) {
-		Tr::copy(&new_buffer[0], &buf_[0], static_cast<size_t>(new_gap_start));
-		Tr::copy(&new_buffer[new_gap_end], &buf_[new_gap_start], static_cast<size_t>(gap_start_ - new_gap_start));
-		Tr::copy(&new_buffer[new_gap_end + gap_start_ - new_gap_start], &buf_[gap_end_], static_cast<size_t>(size() - gap_start_));
+		Tr::copy(&new_buffer[0], &data_[0], static_cast<size_t>(new_gap_start));
+		Tr::copy(&new_buffer[new_gap_end], &data_[new_gap_start], static_cast<size_t>(gap_start_ - new_gap_start));
+		Tr::copy(&new_buffer[new_gap_end + gap_start_ - new_gap_start], &data_[gap_end_], static_cast<size_t>(size() - gap_start_));
 	} else { // newGapStart > gap_start_
-		Tr::copy(&new_buffer[0], &buf_[0], static_cast<size_t>(gap_start_));
-		Tr::copy(&new_buffer[gap_start_], &buf_[gap_end_], static_cast<size_t>(new_gap_start - gap_start_));
-		Tr::copy(&new_buffer[new_gap_end], &buf_[gap_end_ + new_gap_start - gap_start_], static_cast<size_t>(size() - new_gap_start));
+		Tr::copy(&new_buffer[0], &data_[0], static_cast<size_t>(gap_start_));
+		Tr::copy(&new_buffer[gap_start_], &data_[gap_end_], static_cast<size_t>(new_gap_start - gap_start_));
+		Tr::copy(&new_buffer[new_gap_end], &data_[gap_end_ + new_gap_start - gap_start_], static_cast<size_t>(size() - new_gap_start));
 	}
 
 	buf_       = std::move(new_buffer);
+	data_      = buf_.get();
 	gap_start_ = new_gap_start;
 	gap_end_   = new_gap_end;
 
 #ifdef PURIFY
-	std::fill(&buf_[gap_start_], &buf_[gap_end_], Ch('.'));
+	std::fill(&data_[gap_start_], &data_[gap_end_], Ch('.'));
 #endif
 }
 
@@ -518,6 +614,7 @@ void gap_buffer<Ch, Tr>::swap(gap_buffer &other) noexcept {
 	using std::swap;
 
 	swap(buf_, other.buf_);
+	swap(data_, other.data_);
 	swap(gap_start_, other.gap_start_);
 	swap(gap_end_, other.gap_end_);
 	swap(size_, other.size_);
@@ -27,10 +27,12 @@
 
 #include <boost/optional.hpp>
 #include <fstream>
+#include <limits>
 #include <stack>
 
 #include <QClipboard>
 #include <QDialogButtonBox>
+#include <QHash>
 #include <QFileDialog>
 #include <QMimeData>
 
@@ -44,6 +46,12 @@ struct SubRoutine {
 	LibraryRoutine function;
 };
 
+/* Programs compiled by compileMacroCached, keyed by their source text. They
+ * are shared with the macros executing them, so clearing the cache never
+ * pulls a program out from under a running macro */
+constexpr int MaxCachedMacros = 64;
+QHash<QString, std::shared_ptr<Program>> CompiledMacroCache;
+
 enum class MacroErrorCode {
 	Success = 0,
 	ArrayFull,
@@ -53,6 +61,7 @@ enum class MacroErrorCode {
 	TooManyArguments,
 	UnknownObject,
 	NotAnInteger,
+	IntegerOutOfRange,
 	NotAString,
 	InvalidContext,
 	NeedsArguments,
@@ -111,6 +120,8 @@ std::string MacroErrorCategory::message(int ev) const {
 		return "%s called with unknown object";
 	case MacroErrorCode::NotAnInteger:
 		return "%s called with non-integer argument";
+	case MacroErrorCode::IntegerOutOfRange:
+		return "%s called with an integer argument which is out of range";
 	case MacroErrorCode::NotAString:
 		return "%s not called with a string parameter";
 	case MacroErrorCode::InvalidContext:
@@ -303,7 +314,13 @@ std::error_code readArgument(const DataValue &dv, int64_t *result) {
 std::error_code readArgument(const DataValue &dv, int *result) {
 
 	if (is_integer(dv)) {
-		*result = to_integer(dv);
+		// macro integers are 64-bit, but this argument is not
+		const int64_t value = to_integer(dv);
+		if (value < std::numeric_limits<int>::min() || value > std::numeric_limits<int>::max()) {
+			return MacroErrorCode::IntegerOutOfRange;
+		}
+
+		*result = static_cast<int>(value);
 		return MacroErrorCode::Success;
 	}
 
@@ -343,6 +360,31 @@ std::error_code readArgument(const DataValue &dv, std::string *result) {
 	return MacroErrorCode::UnknownObject;
 }
 
+/**
+ * @brief readArgument - Get a view of a string value from a DataValue
+ * structure without copying it. Integers are converted into "storage", which
+ * the resulting view then refers to.
+ * @param dv
+ * @param result
+ * @param storage
+ * @return
+ */
+std::error_code readArgument(const DataValue &dv, view::string_view *result, std::string *storage) {
+
+	if (is_string(dv)) {
+		*result = to_string_view(dv);
+		return MacroErrorCode::Success;
+	}
+
+	if (is_integer(dv)) {
+		*storage = std::to_string(to_integer(dv));
+		*result  = *storage;
+		return MacroErrorCode::Success;
+	}
+
+	return MacroErrorCode::UnknownObject;
+}
+
 /**
  * @brief readArgument - Get an string value from a DataValue structure.
  * @param dv
@@ -1373,12 +1415,29 @@ std::error_code lengthMS(DocumentWidget *document, Arguments arguments, DataValu
 
 	Q_UNUSED(document)
 
-	QString string;
-	if (std::error_code ec = readArguments(arguments, 0, &string)) {
+	if (arguments.size() != 1) {
+		return MacroErrorCode::WrongNumberOfArguments;
+	}
+
+	std::string storage;
+	view::string_view string;
+	if (std::error_code ec = readArgument(arguments[0], &string, &storage)) {
 		return ec;
 	}
 
-	*result = make_value(string.size());
+	// the length is measured in UTF-16 code units, which for plain ASCII text
+	// is simply the number of bytes, so we only pay for a conversion when the
+	// string actually contains something else
+	const bool isAscii = std::all_of(string.begin(), string.end(), [](char ch) {
+		return static_cast<unsigned char>(ch) < 0x80;
+	});
+
+	if (isAscii) {
+		*result = make_value(static_cast<int64_t>(string.size()));
+	} else {
+		*result = make_value(QString::fromUtf8(string.data(), static_cast<int>(string.size())).size());
+	}
+
 	return MacroErrorCode::Success;
 }
 
@@ -1393,13 +1452,13 @@ std::error_code minMS(DocumentWidget *document, Arguments arguments, DataValue *
 		return MacroErrorCode::TooFewArguments;
 	}
 
-	int minVal;
+	int64_t minVal;
 	if (std::error_code ec = readArgument(arguments[0], &minVal)) {
 		return ec;
 	}
 
 	for (const DataValue &dv : arguments) {
-		int value;
+		int64_t value;
 		if (std::error_code ec = readArgument(dv, &value)) {
 			return ec;
 		}
@@ -1419,13 +1478,13 @@ std::error_code maxMS(DocumentWidget *document, Arguments arguments, DataValue *
 		return MacroErrorCode::TooFewArguments;
 	}
 
-	int maxVal;
+	int64_t maxVal;
 	if (std::error_code ec = readArgument(arguments[0], &maxVal)) {
 		return ec;
 	}
 
 	for (const DataValue &dv : arguments) {
-		int value;
+		int64_t value;
 		if (std::error_code ec = readArgument(dv, &value)) {
 			return ec;
 		}
@@ -1498,6 +1557,9 @@ std::error_code focusWindowMS(DocumentWidget *document, Arguments arguments, Dat
 	// Change the focused window to the requested one
 	SetMacroFocusDocument(target);
 
+	// read the file if that was put off, or bring it back from hibernation
+	target->makeResident();
+
 	// turn on syntax highlight that might have been deferred
 	if (target->highlightSyntax_ && !target->highlightData_) {
 		target->startHighlighting(Verbosity::Silent);
@@ -1530,9 +1592,7 @@ std::error_code getRangeMS(DocumentWidget *document, Arguments arguments, DataVa
 		std::swap(from, to);
 	}
 
-	std::string rangeText = buf->BufGetRange(TextCursor(from), TextCursor(to));
-
-	*result = make_value(rangeText);
+	*result = make_value(buf->BufGetRange(TextCursor(from), TextCursor(to)));
 	return MacroErrorCode::Success;
 }
 
@@ -1553,9 +1613,7 @@ std::error_code getCharacterMS(DocumentWidget *document, Arguments arguments, Da
 	pos = qBound<int64_t>(0, pos, buf->length());
 
 	// Return the character in a pre-allocated string)
-	std::string str(1, buf->BufGetCharacter(TextCursor(pos)));
-
-	*result = make_value(str);
+	*result = make_value(std::string(1, buf->BufGetCharacter(TextCursor(pos))));
 	return MacroErrorCode::Success;
 }
 
@@ -1896,6 +1954,75 @@ std::error_code writeOrAppendFile(bool append, DocumentWidget *document, Argumen
 	return MacroErrorCode::Success;
 }
 
+/*
+** Built-in macro subroutine for controlling the macro profiler. Called as
+** macro_profile("start") to discard any collected statistics and begin
+** profiling, or macro_profile("stop") to stop. Returns the previous state.
+*/
+std::error_code macroProfileMS(DocumentWidget *document, Arguments arguments, DataValue *result) {
+
+	Q_UNUSED(document)
+
+	std::string action;
+	if (std::error_code ec = readArguments(arguments, 0, &action)) {
+		return ec;
+	}
+
+	const bool wasEnabled = MacroProfilingEnabled();
+
+	if (action == "start") {
+		StartMacroProfiling();
+	} else if (action == "stop") {
+		StopMacroProfiling();
+	} else {
+		return MacroErrorCode::UnrecognizedArgument;
+	}
+
+	*result = make_value(wasEnabled);
+	return MacroErrorCode::Success;
+}
+
+/*
+** Built-in macro subroutine for retrieving the statistics collected by the
+** macro profiler. Called as macro_profile_report() it returns the report as a
+** string, called as macro_profile_report(filename) it writes the report to
+** the named file and returns 1 on success and 0 on failure.
+*/
+std::error_code macroProfileReportMS(DocumentWidget *document, Arguments arguments, DataValue *result) {
+
+	Q_UNUSED(document)
+
+	if (arguments.size() > 1) {
+		return MacroErrorCode::WrongNumberOfArguments;
+	}
+
+	std::string report = MacroProfileReport();
+
+	if (arguments.empty()) {
+		*result = make_value(std::move(report));
+		return MacroErrorCode::Success;
+	}
+
+	std::string name;
+	if (std::error_code ec = readArgument(arguments[0], &name)) {
+		return ec;
+	}
+
+	std::ofstream file(name, std::ios::out);
+	if (!file) {
+		*result = make_value(false);
+		return MacroErrorCode::Success;
+	}
+
+	if (!file.write(report.data(), static_cast<std::streamsize>(report.size()))) {
+		*result = make_value(false);
+		return MacroErrorCode::Success;
+	}
+
+	*result = make_value(true);
+	return MacroErrorCode::Success;
+}
+
 std::error_code writeFileMS(DocumentWidget *document, Arguments arguments, DataValue *result) {
 	return writeOrAppendFile(false, document, arguments, result);
 }
@@ -1922,7 +2049,8 @@ std::error_code searchStringMS(DocumentWidget *document, Arguments arguments, Da
 	SearchType type;
 	QString searchStr;
 	Direction direction;
-	std::string string;
+	view::string_view string;
+	std::string storage;
 
 	bool found      = false;
 	bool skipSearch = false;
@@ -1932,7 +2060,13 @@ std::error_code searchStringMS(DocumentWidget *document, Arguments arguments, Da
 		return MacroErrorCode::TooFewArguments;
 	}
 
-	if (std::error_code ec = readArguments(arguments, 0, &string, &searchStr, &beginPos)) {
+	// the string being searched may be an entire document (see searchMS), so
+	// it is never copied
+	if (std::error_code ec = readArgument(arguments[0], &string, &storage)) {
+		return ec;
+	}
+
+	if (std::error_code ec = readArguments(arguments, 1, &searchStr, &beginPos)) {
 		return ec;
 	}
 
@@ -1940,7 +2074,7 @@ std::error_code searchStringMS(DocumentWidget *document, Arguments arguments, Da
 		return ec;
 	}
 
-	auto len = static_cast<int64_t>(to_string(arguments[0]).size());
+	auto len = static_cast<int64_t>(string.size());
 	if (beginPos > len) {
 		if (direction == Direction::Forward) {
 			if (wrap == WrapMode::Wrap) {
@@ -2005,12 +2139,10 @@ std::error_code searchMS(DocumentWidget *document, Arguments arguments, DataValu
 	if (arguments.size() > 8)
 		return MacroErrorCode::WrongNumberOfArguments;
 
-	// NOTE(eteran): the original version of this code was copy-free
-	// in the interest of making the macro code simpler
-	// we just make a copy here. If we duplicate the code in searchStringMS
-	// here and thus don't have to pass things in a DataValue, we can once again
-	// make it copy free
-	newArgList[0] = make_value(document->buffer()->BufAsString());
+	/* The buffer is passed by view, so no copy of the document is made. This
+	 * is safe because searchStringMS does not modify the buffer and the view
+	 * does not outlive this call */
+	newArgList[0] = make_view_value(document->buffer()->BufAsString());
 
 	// copy other arguments to the new argument list
 	std::copy(arguments.begin(), arguments.end(), &newArgList[1]);
@@ -2103,7 +2235,7 @@ std::error_code replaceInStringMS(DocumentWidget *document, Arguments arguments,
 }
 
 std::error_code setCursorPosMS(DocumentWidget *document, Arguments arguments, DataValue *result) {
-	int pos;
+	int64_t pos;
 
 	// Get argument and convert to int
 	if (std::error_code ec = readArguments(arguments, 0, &pos)) {
@@ -2577,6 +2709,30 @@ std::error_code replaceAllMS(DocumentWidget *document, Arguments arguments, Data
 	return MacroErrorCode::Success;
 }
 
+std::error_code markAllMS(DocumentWidget *document, Arguments arguments, DataValue *result) {
+
+	// mark_all( search-string [, search-type] )
+
+	// ensure that we are dealing with the document which currently has the focus
+	document = MacroRunDocument();
+
+	if (arguments.size() < 1 || arguments.size() > 2) {
+		return MacroErrorCode::WrongNumberOfArguments;
+	}
+
+	QString searchString;
+	if (std::error_code ec = readArgument(arguments[0], &searchString)) {
+		return ec;
+	}
+
+	SearchType type = searchType(arguments, 1);
+
+	// unlike the menu item, this returns the rangeset holding the matches so
+	// that the caller can go on to work with them
+	*result = make_value(document->markAll(searchString, type));
+	return MacroErrorCode::Success;
+}
+
 /*
 **  filename_dialog([title[, mode[, defaultPath[, filter[, defaultName]]]]])
 **
@@ -4576,6 +4732,7 @@ const SubRoutine MenuMacroSubrNames[] = {
 	{"mark_dialog", menuEventU<&MainWindow::action_Mark>},
 	{"goto_mark", gotoMarkMS},
 	{"goto_mark_dialog", gotoMarkDialogMS},
+	{"mark_all", markAllMS},
 	{"goto_matching", menuEventU<&MainWindow::action_Goto_Matching>},
 	{"select_to_matching", menuEventU<&MainWindow::action_Shift_Goto_Matching>},
 	{"find_definition", findDefinitionMS},
@@ -4664,6 +4821,8 @@ const SubRoutine MacroSubrs[] = {
 #if defined(ENABLE_BACKLIGHT_STRING)
 	{"set_backlight_string", setBacklightStringMS},
 #endif
+	{"macro_profile", macroProfileMS},
+	{"macro_profile_report", macroProfileReportMS},
 	{"rangeset_create", rangesetCreateMS},
 	{"rangeset_destroy", rangesetDestroyMS},
 	{"rangeset_add", rangesetAddMS},
@@ -4874,6 +5033,11 @@ bool readCheckMacroString(QWidget *dialogParent, const QString &string, Document
 			}
 
 			if (runDocument) {
+
+				/* the parser resolves names at compile time, so previously
+				   compiled macros may refer to what this name used to be */
+				clearCompiledMacroCache();
+
 				if (Symbol *const sym = LookupSymbolEx(routineName)) {
 
 					if (sym->type == MACRO_FUNCTION_SYM) {
@@ -4917,7 +5081,7 @@ bool readCheckMacroString(QWidget *dialogParent, const QString &string, Document
 			if (runDocument) {
 
 				if (!runDocument->macroCmdData_) {
-					runDocument->runMacro(prog);
+					runDocument->runMacro(std::shared_ptr<Program>(prog));
 				} else {
 					/*  If we come here this means that the string was parsed
 						from within another macro via load_macro_file(). In
@@ -4942,12 +5106,54 @@ bool readCheckMacroString(QWidget *dialogParent, const QString &string, Document
 		Program *const prog = progStack.top();
 		progStack.pop();
 
-		RunMacroAsSubrCall(prog);
-
-		// TODO(eteran): OK, I'm pretty sure this is a memory leak. We CAN'T delete prog quite yet,
-		// because despite the name, "RunMacroAsSubrCall" doesn't run anything, it just sets up the
-		// code for execution... but no one is tracking this pointer anymore :-/.
+		// despite the name, "RunMacroAsSubrCall" doesn't run anything, it just
+		// sets up the code for execution, so the running macro takes ownership
+		// of prog until it completes
+		runDocument->runMacro(std::shared_ptr<Program>(prog));
 	}
 
 	return true;
 }
+
+/*
+** Compile a macro, reusing the program from a previous compilation of the
+** same source text when possible, so that frequently run macros (repeat,
+** replay, menu items and -do commands) are only parsed once. Returns nullptr
+** on failure, in which case "message" and "stoppedAt" are set as they are for
+** compileMacro.
+*/
+std::shared_ptr<Program> compileMacroCached(const QString &expr, QString *message, int *stoppedAt) {
+
+	auto it = CompiledMacroCache.find(expr);
+	if (it != CompiledMacroCache.end()) {
+		*message   = QString();
+		*stoppedAt = expr.size();
+		return *it;
+	}
+
+	std::shared_ptr<Program> prog(compileMacro(expr, message, stoppedAt));
+	if (!prog) {
+		return nullptr;
+	}
+
+	/* only a complete parse is worth keeping, a partial one will be handled
+	   differently by each caller */
+	if (*stoppedAt == expr.size()) {
+		if (CompiledMacroCache.size() >= MaxCachedMacros) {
+			CompiledMacroCache.clear();
+		}
+
+		CompiledMacroCache.insert(expr, prog);
+	}
+
+	return prog;
+}
+
+/*
+** Discard all cached compiled macros, this must be done whenever the meaning
+** of a name used by a macro may have changed (such as when a macro function
+** is (re)defined), or when the set of macros in use changes
+*/
+void clearCompiledMacroCache() {
+	CompiledMacroCache.clear();
+}
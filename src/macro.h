@@ -4,6 +4,7 @@
 
 #include <QTimer>
 #include <memory>
+#include <vector>
 
 class DocumentWidget;
 class MainWindow;
@@ -20,6 +21,8 @@ enum RepeatMethod {
 
 bool CheckMacroString(QWidget *dialogParent, const QString &string, const QString &errIn, int *errPos);
 bool readCheckMacroString(QWidget *dialogParent, const QString &string, DocumentWidget *runDocument, const QString &errIn, int *errPos);
+std::shared_ptr<Program> compileMacroCached(const QString &expr, QString *message, int *stoppedAt);
+void clearCompiledMacroCache();
 
 void RegisterMacroSubroutines();
 void returnShellCommandOutput(DocumentWidget *document, const QString &outText, int status);
@@ -32,7 +35,8 @@ struct MacroCommandData {
 	bool bannerIsUp        = false;
 	bool closeOnCompletion = false;
 	std::shared_ptr<MacroContext> context;
-	std::unique_ptr<Program> program;
+	std::shared_ptr<Program> program;
+	std::vector<std::shared_ptr<Program>> subPrograms; // programs run as subroutines of this one, kept alive until it completes
 };
 
 #endif